@@ -0,0 +1,65 @@
+/* The allocator of hw3: the global operator new and delete, replaced to feed the allocation
+ * counters of Stats.hpp and, with FANC_MEMSTATS, the categories of Memory.hpp. Replacing them
+ * swaps the allocator of the whole program, so this file is linked into hw3 only and is not part
+ * of libfanc.a (LIB_SOURCES in the Makefile): a program embedding the library keeps its own,
+ * and its --stats allocation counters stay at 0.
+ */
+#include "Stats.hpp"
+#include <cstdlib>
+#include <new>
+
+#if defined(FANC_STATS) || defined(FANC_MEMSTATS)
+#ifdef FANC_MEMSTATS
+// In front of every block, 16 bytes keep the alignment malloc gives
+struct alignas(16) BlockHeader {
+    long size;
+    int category;
+};
+#endif
+
+// Counts every allocation of the thread, the memory itself still comes from malloc
+void *operator new(size_t size) {
+    STATS_COUNT(allocations);
+    STATS_ADD(allocated_bytes, size);
+#ifdef FANC_MEMSTATS
+    if (auto *header = (BlockHeader *) malloc(sizeof(BlockHeader) + size)) {
+        header->size = (long) size;
+        header->category = memory::current;
+        memory::allocated(header->category, header->size);
+        return header + 1;
+    }
+#else
+    if (void *memory = malloc(size == 0 ? 1 : size))
+        return memory;
+#endif
+    throw std::bad_alloc();
+}
+
+void *operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void *block) noexcept {
+#ifdef FANC_MEMSTATS
+    if (block == nullptr)
+        return;
+    auto *header = (BlockHeader *) block - 1;
+    memory::freed(header->category, header->size);
+    free(header);
+#else
+    free(block);
+#endif
+}
+
+void operator delete[](void *block) noexcept {
+    operator delete(block);
+}
+
+void operator delete(void *block, size_t) noexcept {
+    operator delete(block);
+}
+
+void operator delete[](void *block, size_t) noexcept {
+    operator delete(block);
+}
+#endif
@@ -0,0 +1,234 @@
+#include "AnalysisCache.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+
+static const char *CACHE_HEADER = "fanc-analysis-cache 1";
+
+static std::string hashToString(const std::string &text) {
+    // 64-bit FNV-1a
+    uint64_t hash = 14695981039346656037ULL;
+    for (unsigned char c : text) {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    std::ostringstream os;
+    os << std::hex << std::setw(16) << std::setfill('0') << hash;
+    return os.str();
+}
+
+namespace {
+    // A piece of a key still to be written, the pieces are written from the back of the stack
+    struct KeyWork {
+        enum Kind { EXP, STATEMENT, SYMBOLS, TEXT } kind;
+        const ast::Node *node;
+        const char *text;
+    };
+}
+
+/* Writes the key of a function body. Like the analyzer, it keeps a work stack instead of
+ * recursing, so the key of a deeply nested body is bounded by the heap and not by the stack.
+ */
+static void serializeBody(const ast::Statement *body, const literals::Pool &literals, std::string &out) {
+    std::vector<KeyWork> work = {{KeyWork::STATEMENT, body, nullptr}};
+    // Pushed in reverse, so the first piece is on top
+    auto push = [&work](std::initializer_list<KeyWork> pieces) {
+        work.insert(work.end(), std::rbegin(pieces), std::rend(pieces));
+    };
+    auto exp = [](const ast::Node *node) { return KeyWork{KeyWork::EXP, node, nullptr}; };
+    auto statement = [](const ast::Node *node) { return KeyWork{KeyWork::STATEMENT, node, nullptr}; };
+    auto text = [](const char *text) { return KeyWork{KeyWork::TEXT, nullptr, text}; };
+    while (!work.empty()) {
+        KeyWork piece = work.back();
+        work.pop_back();
+        if (piece.kind == KeyWork::TEXT) {
+            out += piece.text;
+            continue;
+        }
+        if (piece.kind == KeyWork::SYMBOLS) {
+            // If and while scopes are checked against the symbols of their condition
+            out += "[";
+            for (auto &symbol : static_cast<const ast::Exp *>(piece.node)->exp_symbols)
+                out += symbol + ",";
+            out += "]";
+            continue;
+        }
+        if (piece.node == nullptr) {
+            out += "_";
+            continue;
+        }
+        if (piece.kind == KeyWork::EXP) {
+            const ast::Exp *node = static_cast<const ast::Exp *>(piece.node);
+            if (auto num = ast::cast<const ast::Num>(node)) {
+                out += "n" + std::to_string(num->value);
+            } else if (auto num_b = ast::cast<const ast::NumB>(node)) {
+                out += "b" + std::to_string(num_b->value);
+            } else if (auto str = ast::cast<const ast::String>(node)) {
+                const std::string &literal = literals.text(str->literal);
+                out += "s" + std::to_string(literal.size()) + ":" + literal;
+            } else if (auto boolean = ast::cast<const ast::Bool>(node)) {
+                out += boolean->value ? "T" : "F";
+            } else if (auto id = ast::cast<const ast::ID>(node)) {
+                out += "i" + id->value + ";";
+            } else if (auto bin_op = ast::cast<const ast::BinOp>(node)) {
+                out += "(" + std::string(1, "+-*/"[bin_op->op]);
+                push({exp(bin_op->left.get()), exp(bin_op->right.get()), text(")")});
+            } else if (auto rel_op = ast::cast<const ast::RelOp>(node)) {
+                out += "(r" + std::to_string(rel_op->op);
+                push({exp(rel_op->left.get()), exp(rel_op->right.get()), text(")")});
+            } else if (auto not_op = ast::cast<const ast::Not>(node)) {
+                out += "(!";
+                push({exp(not_op->exp.get()), text(")")});
+            } else if (auto and_op = ast::cast<const ast::And>(node)) {
+                out += "(&";
+                push({exp(and_op->left.get()), exp(and_op->right.get()), text(")")});
+            } else if (auto or_op = ast::cast<const ast::Or>(node)) {
+                out += "(|";
+                push({exp(or_op->left.get()), exp(or_op->right.get()), text(")")});
+            } else if (auto cast = ast::cast<const ast::Cast>(node)) {
+                out += "(c" + std::to_string(cast->target_type->type);
+                push({exp(cast->exp.get()), text(")")});
+            } else if (auto call = ast::cast<const ast::Call>(node)) {
+                out += "(C" + call->func_id->value + ";";
+                work.push_back(text(")"));
+                auto &args = call->args->exps;
+                for (auto arg = args.rbegin(); arg != args.rend(); ++arg)
+                    work.push_back(exp(arg->get()));
+            }
+            continue;
+        }
+        const ast::Statement *node = static_cast<const ast::Statement *>(piece.node);
+        if (auto statements = ast::cast<const ast::Statements>(node)) {
+            out += node->is_scope ? "{" : "<";
+            work.push_back(text(node->is_scope ? "}" : ">"));
+            auto &inner = statements->statements;
+            for (auto it = inner.rbegin(); it != inner.rend(); ++it)
+                work.push_back(statement(it->get()));
+        } else if (auto call = ast::cast<const ast::Call>(node)) {
+            push({exp(call), text(";")});
+        } else if (ast::cast<const ast::Break>(node)) {
+            out += "B";
+        } else if (ast::cast<const ast::Continue>(node)) {
+            out += "K";
+        } else if (auto ret = ast::cast<const ast::Return>(node)) {
+            out += "R";
+            push({exp(ret->exp.get())});
+        } else if (auto if_node = ast::cast<const ast::If>(node)) {
+            out += "I";
+            push({exp(if_node->condition.get()), {KeyWork::SYMBOLS, if_node->condition.get(), nullptr},
+                  statement(if_node->then.get()), statement(if_node->otherwise.get())});
+        } else if (auto while_node = ast::cast<const ast::While>(node)) {
+            out += "W";
+            push({exp(while_node->condition.get()), {KeyWork::SYMBOLS, while_node->condition.get(), nullptr},
+                  statement(while_node->body.get())});
+        } else if (auto var_decl = ast::cast<const ast::VarDecl>(node)) {
+            out += "V" + std::to_string(var_decl->type->type) + var_decl->id->value + ";";
+            push({exp(var_decl->init_exp.get())});
+        } else if (auto assign = ast::cast<const ast::Assign>(node)) {
+            out += "A" + assign->id->value + ";";
+            push({exp(assign->exp.get())});
+        }
+    }
+}
+
+AnalysisCache::AnalysisCache(const std::string &path)
+        : path(path), hits(0), misses(0), saved_micros(0), analysed_micros(0) {}
+
+void AnalysisCache::load() {
+    std::ifstream in(path, std::ios::binary);
+    std::string header;
+    if (!in || !std::getline(in, header) || header != CACHE_HEADER)
+        return;
+    std::string key;
+    long long micros;
+    size_t length;
+    while (in >> key >> micros >> length) {
+        in.get();
+        std::string block(length, '\0');
+        if (!in.read(&block[0], (std::streamsize) length))
+            break;
+        entries[key] = {block, micros, false};
+    }
+}
+
+void AnalysisCache::save() const {
+    std::vector<std::string> keys;
+    for (auto &entry : entries)
+        if (entry.second.used)
+            keys.push_back(entry.first);
+    std::sort(keys.begin(), keys.end());
+
+    // Written next to the cache and renamed over it, so a crash never leaves a torn file
+    std::string temp = path + ".tmp";
+    {
+        std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+        if (!out)
+            return;
+        out << CACHE_HEADER << "\n";
+        for (auto &key : keys) {
+            const Entry &entry = entries.at(key);
+            out << key << " " << entry.micros << " " << entry.block.size() << "\n" << entry.block;
+        }
+    }
+    std::rename(temp.c_str(), path.c_str());
+}
+
+std::string AnalysisCache::signatureKey(const std::unordered_map<std::string, Symbol> &functions) {
+    std::vector<std::string> signatures;
+    for (auto &function : functions) {
+        std::string signature = function.first + ":" + std::to_string(function.second.type);
+        for (auto type : function.second.params->types)
+            signature += "," + std::to_string(type);
+        signatures.push_back(signature);
+    }
+    std::sort(signatures.begin(), signatures.end());
+    std::string text;
+    for (auto &signature : signatures)
+        text += signature + ";";
+    return hashToString(text);
+}
+
+std::string AnalysisCache::functionKey(ast::FuncDecl &func, const std::string &signature_key,
+                                      const literals::Pool &literals) {
+    std::string text = signature_key + "|" + func.id->value + ":" + std::to_string(func.return_type->type) + "(";
+    for (auto &formal : func.formals->formals)
+        text += std::to_string(formal->type->type) + formal->id->value + ",";
+    text += ")";
+    serializeBody(func.body.get(), literals, text);
+    return hashToString(text);
+}
+
+bool AnalysisCache::lookup(const std::string &key, std::string &block) {
+    auto it = entries.find(key);
+    if (it == entries.end()) {
+        misses++;
+        return false;
+    }
+    hits++;
+    it->second.used = true;
+    saved_micros += it->second.micros;
+    block = it->second.block;
+    return true;
+}
+
+void AnalysisCache::store(const std::string &key, const std::string &block, long long micros) {
+    entries[key] = {block, micros, true};
+    analysed_micros += micros;
+}
+
+void AnalysisCache::replayed(long long micros) {
+    saved_micros -= micros;
+}
+
+void AnalysisCache::printStats(std::ostream &os) const {
+    int total = hits + misses;
+    os << "---analysis cache---" << std::endl;
+    os << "functions: " << hits << " cached, " << misses << " analysed (" << std::fixed << std::setprecision(1)
+       << (total == 0 ? 0.0 : 100.0 * hits / total) << "% hit rate)" << std::endl;
+    os << "analysis time: " << std::setprecision(3) << analysed_micros / 1000.0 << " ms, saved "
+       << std::max(0LL, saved_micros) / 1000.0 << " ms" << std::endl;
+}
@@ -0,0 +1,59 @@
+#ifndef ANALYSIS_CACHE_HPP
+#define ANALYSIS_CACHE_HPP
+
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include "nodes.hpp"
+#include "SymbolTable.hpp"
+
+/* On-disk cache of the semantic analysis of single functions.
+ * The analysis of a FuncDecl only depends on the function itself and on the signatures of all
+ * functions, so the key hashes a canonical form of the function's AST (without line numbers)
+ * together with the signature set. The value is the block the function adds to the scope
+ * printer. Analysis errors end the run before anything is stored, so a function with an error
+ * is analysed again on every run and reports the same error.
+ * The whole cache lives in one file that is read on start and rewritten on save with the
+ * entries used by this run.
+ */
+class AnalysisCache {
+public:
+    explicit AnalysisCache(const std::string &path);
+
+    void load();
+
+    void save() const;
+
+    // Key of the signature set, computed once per run before functions are analysed
+    static std::string signatureKey(const std::unordered_map<std::string, Symbol> &functions);
+
+    static std::string functionKey(ast::FuncDecl &func, const std::string &signature_key,
+                                   const literals::Pool &literals);
+
+    // Returns true and sets block if key is cached
+    bool lookup(const std::string &key, std::string &block);
+
+    // Stores the block of an analysed function and how long analysing it took
+    void store(const std::string &key, const std::string &block, long long micros);
+
+    // Accounts the time spent replaying a cached block
+    void replayed(long long micros);
+
+    void printStats(std::ostream &os) const;
+
+private:
+    struct Entry {
+        std::string block;
+        long long micros;
+        bool used;
+    };
+
+    std::string path;
+    std::unordered_map<std::string, Entry> entries;
+    int hits;
+    int misses;
+    long long saved_micros;
+    long long analysed_micros;
+};
+
+#endif //ANALYSIS_CACHE_HPP
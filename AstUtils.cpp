@@ -0,0 +1,371 @@
+#include "AstUtils.hpp"
+#include <string>
+#include <vector>
+
+namespace ast {
+
+    static std::string rename(const std::string &name, const RenameMap &renames) {
+        auto it = renames.find(name);
+        if (it != renames.end())
+            return it->second;
+        return name;
+    }
+
+    // Copies the bookkeeping shared by every expression (offset and free symbols)
+    template<typename T>
+    static std::shared_ptr<T> finishExp(std::shared_ptr<T> copy, const Exp &original, const RenameMap &renames) {
+        copy->offset = original.offset;
+        copy->exp_symbols.clear();
+        for (auto &symbol : original.exp_symbols)
+            copy->exp_symbols.insert(rename(symbol, renames));
+        return copy;
+    }
+
+    std::shared_ptr<ID> makeId(const std::string &name, source::Offset offset) {
+        auto id = std::make_shared<ID>(name.c_str());
+        id->offset = offset;
+        return id;
+    }
+
+    std::shared_ptr<Num> makeNum(int value, source::Offset offset) {
+        auto num = std::make_shared<Num>(std::to_string(value).c_str());
+        num->offset = offset;
+        return num;
+    }
+
+    std::shared_ptr<Type> makeType(BuiltInType type, source::Offset offset) {
+        auto type_node = std::make_shared<Type>(type);
+        type_node->offset = offset;
+        return type_node;
+    }
+
+    static std::shared_ptr<Call> cloneCall(const Call &call, const RenameMap &renames) {
+        auto args = std::make_shared<ExpList>();
+        args->offset = call.args->offset;
+        for (auto &arg : call.args->exps)
+            args->push_back(cloneExp(arg, renames));
+        // Function names are never shadowed by variables, so the callee is kept as is
+        auto func_id = makeId(call.func_id->value, call.func_id->offset);
+        auto copy = std::make_shared<Call>(func_id, args);
+        copy->is_scope = call.is_scope;
+        return finishExp(copy, call, renames);
+    }
+
+    std::shared_ptr<Exp> cloneExp(const std::shared_ptr<Exp> &exp, const RenameMap &renames) {
+        if (exp == nullptr)
+            return nullptr;
+        if (auto num = ast::cast<Num>(exp))
+            return finishExp(std::make_shared<Num>(std::to_string(num->value).c_str()), *num, renames);
+        if (auto num_b = ast::cast<NumB>(exp))
+            return finishExp(std::make_shared<NumB>(std::to_string(num_b->value).c_str()), *num_b, renames);
+        if (auto str = ast::cast<String>(exp))
+            return finishExp(std::make_shared<String>(str->literal), *str, renames);
+        if (auto boolean = ast::cast<Bool>(exp))
+            return finishExp(std::make_shared<Bool>(boolean->value), *boolean, renames);
+        if (auto id = ast::cast<ID>(exp))
+            return finishExp(std::make_shared<ID>(rename(id->value, renames).c_str()), *id, renames);
+        if (auto bin_op = ast::cast<BinOp>(exp))
+            return finishExp(std::make_shared<BinOp>(cloneExp(bin_op->left, renames),
+                                                     cloneExp(bin_op->right, renames), bin_op->op), *bin_op, renames);
+        if (auto rel_op = ast::cast<RelOp>(exp))
+            return finishExp(std::make_shared<RelOp>(cloneExp(rel_op->left, renames),
+                                                     cloneExp(rel_op->right, renames), rel_op->op), *rel_op, renames);
+        if (auto not_op = ast::cast<Not>(exp))
+            return finishExp(std::make_shared<Not>(cloneExp(not_op->exp, renames)), *not_op, renames);
+        if (auto and_op = ast::cast<And>(exp))
+            return finishExp(std::make_shared<And>(cloneExp(and_op->left, renames),
+                                                   cloneExp(and_op->right, renames)), *and_op, renames);
+        if (auto or_op = ast::cast<Or>(exp))
+            return finishExp(std::make_shared<Or>(cloneExp(or_op->left, renames),
+                                                  cloneExp(or_op->right, renames)), *or_op, renames);
+        if (auto cast = ast::cast<Cast>(exp))
+            return finishExp(std::make_shared<Cast>(cloneExp(cast->exp, renames),
+                                                    makeType(cast->target_type->type, cast->target_type->offset)),
+                             *cast, renames);
+        if (auto call = ast::cast<Call>(exp))
+            return cloneCall(*call, renames);
+        return nullptr;
+    }
+
+    std::shared_ptr<Statement> cloneStatement(const std::shared_ptr<Statement> &statement, const RenameMap &renames) {
+        if (statement == nullptr)
+            return nullptr;
+        std::shared_ptr<Statement> copy;
+        if (auto statements = ast::cast<Statements>(statement)) {
+            auto block = std::make_shared<Statements>();
+            for (auto &inner : statements->statements)
+                block->push_back(cloneStatement(inner, renames));
+            copy = block;
+        } else if (auto call = ast::cast<Call>(statement)) {
+            copy = cloneCall(*call, renames);
+        } else if (ast::cast<Break>(statement)) {
+            copy = std::make_shared<Break>();
+        } else if (ast::cast<Continue>(statement)) {
+            copy = std::make_shared<Continue>();
+        } else if (auto ret = ast::cast<Return>(statement)) {
+            copy = std::make_shared<Return>(cloneExp(ret->exp, renames));
+        } else if (auto if_node = ast::cast<If>(statement)) {
+            copy = std::make_shared<If>(cloneExp(if_node->condition, renames),
+                                        cloneStatement(if_node->then, renames),
+                                        cloneStatement(if_node->otherwise, renames));
+        } else if (auto while_node = ast::cast<While>(statement)) {
+            copy = std::make_shared<While>(cloneExp(while_node->condition, renames),
+                                           cloneStatement(while_node->body, renames));
+        } else if (auto var_decl = ast::cast<VarDecl>(statement)) {
+            copy = std::make_shared<VarDecl>(makeId(rename(var_decl->id->value, renames), var_decl->id->offset),
+                                             makeType(var_decl->type->type, var_decl->type->offset),
+                                             cloneExp(var_decl->init_exp, renames));
+        } else if (auto assign = ast::cast<Assign>(statement)) {
+            copy = std::make_shared<Assign>(makeId(rename(assign->id->value, renames), assign->id->offset),
+                                            cloneExp(assign->exp, renames));
+        } else {
+            return nullptr;
+        }
+        copy->offset = statement->offset;
+        copy->is_scope = statement->is_scope;
+        return copy;
+    }
+
+    // Visits the direct children of a node in source order
+    static void forEachChild(const std::shared_ptr<Node> &node, const std::function<void(const std::shared_ptr<Node> &)> &fn) {
+        if (auto call = ast::cast<Call>(node)) {
+            for (auto &arg : call->args->exps)
+                fn(arg);
+        } else if (auto bin_op = ast::cast<BinOp>(node)) {
+            fn(bin_op->left);
+            fn(bin_op->right);
+        } else if (auto rel_op = ast::cast<RelOp>(node)) {
+            fn(rel_op->left);
+            fn(rel_op->right);
+        } else if (auto not_op = ast::cast<Not>(node)) {
+            fn(not_op->exp);
+        } else if (auto and_op = ast::cast<And>(node)) {
+            fn(and_op->left);
+            fn(and_op->right);
+        } else if (auto or_op = ast::cast<Or>(node)) {
+            fn(or_op->left);
+            fn(or_op->right);
+        } else if (auto cast = ast::cast<Cast>(node)) {
+            fn(cast->exp);
+        } else if (auto statements = ast::cast<Statements>(node)) {
+            for (auto &statement : statements->statements)
+                fn(statement);
+        } else if (auto ret = ast::cast<Return>(node)) {
+            if (ret->exp != nullptr)
+                fn(ret->exp);
+        } else if (auto if_node = ast::cast<If>(node)) {
+            fn(if_node->condition);
+            fn(if_node->then);
+            if (if_node->otherwise != nullptr)
+                fn(if_node->otherwise);
+        } else if (auto while_node = ast::cast<While>(node)) {
+            fn(while_node->condition);
+            fn(while_node->body);
+        } else if (auto var_decl = ast::cast<VarDecl>(node)) {
+            if (var_decl->init_exp != nullptr)
+                fn(var_decl->init_exp);
+        } else if (auto assign = ast::cast<Assign>(node)) {
+            fn(assign->exp);
+        } else if (auto func = ast::cast<FuncDecl>(node)) {
+            fn(func->body);
+        } else if (auto funcs = ast::cast<Funcs>(node)) {
+            for (auto &func : funcs->funcs)
+                fn(func);
+        }
+    }
+
+    int countNodes(const std::shared_ptr<Node> &node) {
+        if (node == nullptr)
+            return 0;
+        int count = 1;
+        forEachChild(node, [&count](const std::shared_ptr<Node> &child) { count += countNodes(child); });
+        return count;
+    }
+
+    void forEachCall(const std::shared_ptr<Node> &node, const std::function<void(Call &)> &fn) {
+        if (node == nullptr)
+            return;
+        // Arguments are evaluated before the call itself
+        forEachChild(node, [&fn](const std::shared_ptr<Node> &child) { forEachCall(child, fn); });
+        if (auto call = ast::cast<Call>(node))
+            fn(*call);
+    }
+
+    void forEachVarDecl(const std::shared_ptr<Node> &node, const std::function<void(VarDecl &)> &fn) {
+        if (node == nullptr)
+            return;
+        if (auto var_decl = ast::cast<VarDecl>(node))
+            fn(*var_decl);
+        forEachChild(node, [&fn](const std::shared_ptr<Node> &child) { forEachVarDecl(child, fn); });
+    }
+
+    void forEachAssign(const std::shared_ptr<Node> &node, const std::function<void(Assign &)> &fn) {
+        if (node == nullptr)
+            return;
+        if (auto assign = ast::cast<Assign>(node))
+            fn(*assign);
+        forEachChild(node, [&fn](const std::shared_ptr<Node> &child) { forEachAssign(child, fn); });
+    }
+
+    void forEachNode(const std::shared_ptr<Node> &node, const std::function<void(Node &)> &fn) {
+        // An explicit stack instead of recursion, whole files go through here (shiftOffsets)
+        std::vector<std::shared_ptr<Node>> pending = {node};
+        std::vector<std::shared_ptr<Node>> children;
+        while (!pending.empty()) {
+            std::shared_ptr<Node> current = std::move(pending.back());
+            pending.pop_back();
+            if (current == nullptr)
+                continue;
+            fn(*current);
+            children.clear();
+            // Leaves that forEachChild does not visit
+            if (auto call = ast::cast<Call>(current)) {
+                children.push_back(call->func_id);
+                children.push_back(call->args);
+            } else if (auto cast = ast::cast<Cast>(current)) {
+                children.push_back(cast->target_type);
+            } else if (auto var_decl = ast::cast<VarDecl>(current)) {
+                children.push_back(var_decl->id);
+                children.push_back(var_decl->type);
+            } else if (auto assign = ast::cast<Assign>(current)) {
+                children.push_back(assign->id);
+            } else if (auto func = ast::cast<FuncDecl>(current)) {
+                children.push_back(func->id);
+                children.push_back(func->return_type);
+                children.push_back(func->formals);
+            } else if (auto formals = ast::cast<Formals>(current)) {
+                children.insert(children.end(), formals->formals.begin(), formals->formals.end());
+            } else if (auto formal = ast::cast<Formal>(current)) {
+                children.push_back(formal->id);
+                children.push_back(formal->type);
+            }
+            forEachChild(current, [&children](const std::shared_ptr<Node> &child) { children.push_back(child); });
+            // Last child first, so they are visited in source order
+            pending.insert(pending.end(), children.rbegin(), children.rend());
+        }
+    }
+
+    void destroyTree(std::shared_ptr<Node> node) {
+        std::vector<std::shared_ptr<Node>> pending;
+        pending.push_back(std::move(node));
+        while (!pending.empty()) {
+            std::shared_ptr<Node> current = std::move(pending.back());
+            pending.pop_back();
+            // Subtrees someone else still holds are not destroyed here
+            if (current == nullptr || current.use_count() > 1)
+                continue;
+            // Moving the children out leaves a node that is freed without recursing
+            switch (current->kind) {
+                case NodeKind::BinOp: {
+                    auto &bin_op = static_cast<BinOp &>(*current);
+                    pending.push_back(std::move(bin_op.left));
+                    pending.push_back(std::move(bin_op.right));
+                    break;
+                }
+                case NodeKind::RelOp: {
+                    auto &rel_op = static_cast<RelOp &>(*current);
+                    pending.push_back(std::move(rel_op.left));
+                    pending.push_back(std::move(rel_op.right));
+                    break;
+                }
+                case NodeKind::And: {
+                    auto &and_op = static_cast<And &>(*current);
+                    pending.push_back(std::move(and_op.left));
+                    pending.push_back(std::move(and_op.right));
+                    break;
+                }
+                case NodeKind::Or: {
+                    auto &or_op = static_cast<Or &>(*current);
+                    pending.push_back(std::move(or_op.left));
+                    pending.push_back(std::move(or_op.right));
+                    break;
+                }
+                case NodeKind::Not:
+                    pending.push_back(std::move(static_cast<Not &>(*current).exp));
+                    break;
+                case NodeKind::Cast:
+                    pending.push_back(std::move(static_cast<Cast &>(*current).exp));
+                    break;
+                case NodeKind::Call:
+                    pending.push_back(std::move(static_cast<Call &>(*current).args));
+                    break;
+                case NodeKind::ExpList:
+                    for (auto &exp : static_cast<ExpList &>(*current).exps)
+                        pending.push_back(std::move(exp));
+                    break;
+                case NodeKind::Statements:
+                    for (auto &statement : static_cast<Statements &>(*current).statements)
+                        pending.push_back(std::move(statement));
+                    break;
+                case NodeKind::Return:
+                    pending.push_back(std::move(static_cast<Return &>(*current).exp));
+                    break;
+                case NodeKind::If: {
+                    auto &if_node = static_cast<If &>(*current);
+                    pending.push_back(std::move(if_node.condition));
+                    pending.push_back(std::move(if_node.then));
+                    pending.push_back(std::move(if_node.otherwise));
+                    break;
+                }
+                case NodeKind::While: {
+                    auto &while_node = static_cast<While &>(*current);
+                    pending.push_back(std::move(while_node.condition));
+                    pending.push_back(std::move(while_node.body));
+                    break;
+                }
+                case NodeKind::VarDecl:
+                    pending.push_back(std::move(static_cast<VarDecl &>(*current).init_exp));
+                    break;
+                case NodeKind::Assign:
+                    pending.push_back(std::move(static_cast<Assign &>(*current).exp));
+                    break;
+                case NodeKind::FuncDecl:
+                    pending.push_back(std::move(static_cast<FuncDecl &>(*current).body));
+                    break;
+                case NodeKind::Funcs:
+                    for (auto &func : static_cast<Funcs &>(*current).funcs)
+                        pending.push_back(std::move(func));
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+
+    void shiftOffsets(const std::shared_ptr<Node> &node, long delta) {
+        forEachNode(node, [delta](Node &inner) { inner.offset = (source::Offset) (inner.offset + delta); });
+    }
+
+    const char *kindName(Node &node) {
+        switch (node.kind) {
+            case NodeKind::Num: return "Num";
+            case NodeKind::NumB: return "NumB";
+            case NodeKind::String: return "String";
+            case NodeKind::Bool: return "Bool";
+            case NodeKind::ID: return "ID";
+            case NodeKind::BinOp: return "BinOp";
+            case NodeKind::RelOp: return "RelOp";
+            case NodeKind::Not: return "Not";
+            case NodeKind::And: return "And";
+            case NodeKind::Or: return "Or";
+            case NodeKind::Cast: return "Cast";
+            case NodeKind::Call: return "Call";
+            case NodeKind::Statements: return "Statements";
+            case NodeKind::Break: return "Break";
+            case NodeKind::Continue: return "Continue";
+            case NodeKind::Return: return "Return";
+            case NodeKind::If: return "If";
+            case NodeKind::While: return "While";
+            case NodeKind::VarDecl: return "VarDecl";
+            case NodeKind::Assign: return "Assign";
+            case NodeKind::Type: return "Type";
+            case NodeKind::ExpList: return "ExpList";
+            case NodeKind::Formal: return "Formal";
+            case NodeKind::Formals: return "Formals";
+            case NodeKind::FuncDecl: return "FuncDecl";
+            case NodeKind::Funcs: return "Funcs";
+        }
+        return "Node";
+    }
+
+}
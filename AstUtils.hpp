@@ -0,0 +1,59 @@
+#ifndef AST_UTILS_HPP
+#define AST_UTILS_HPP
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include "nodes.hpp"
+
+/* Helpers for passes that rewrite the AST after semantic analysis.
+ * Nodes built here are not created by the parser, so their offset is set explicitly
+ * instead of being taken from source::node_start.
+ */
+namespace ast {
+
+    // Maps identifier names to the names they should be replaced with while cloning
+    typedef std::unordered_map<std::string, std::string> RenameMap;
+
+    std::shared_ptr<ID> makeId(const std::string &name, source::Offset offset);
+
+    std::shared_ptr<Num> makeNum(int value, source::Offset offset);
+
+    std::shared_ptr<Type> makeType(BuiltInType type, source::Offset offset);
+
+    // Deep copy of an expression, renaming variables found in renames
+    std::shared_ptr<Exp> cloneExp(const std::shared_ptr<Exp> &exp, const RenameMap &renames);
+
+    // Deep copy of a statement, renaming variables (uses and declarations) found in renames
+    std::shared_ptr<Statement> cloneStatement(const std::shared_ptr<Statement> &statement, const RenameMap &renames);
+
+    // Number of AST nodes in the subtree, used as the size metric of optimization passes
+    int countNodes(const std::shared_ptr<Node> &node);
+
+    /* Frees a tree without recursing, so a deeply nested one does not overflow the stack
+     * the way the nodes' own destructors would. Subtrees shared with another owner are kept.
+     */
+    void destroyTree(std::shared_ptr<Node> node);
+
+    // Calls fn for every function call in the subtree, in evaluation order
+    void forEachCall(const std::shared_ptr<Node> &node, const std::function<void(Call &)> &fn);
+
+    // Calls fn for every variable declaration in the subtree
+    void forEachVarDecl(const std::shared_ptr<Node> &node, const std::function<void(VarDecl &)> &fn);
+
+    // Calls fn for every assignment in the subtree
+    void forEachAssign(const std::shared_ptr<Node> &node, const std::function<void(Assign &)> &fn);
+
+    // Calls fn for every node in the subtree, identifiers, types and formals included
+    void forEachNode(const std::shared_ptr<Node> &node, const std::function<void(Node &)> &fn);
+
+    // Moves every node of the subtree by delta bytes, identifiers and types included
+    void shiftOffsets(const std::shared_ptr<Node> &node, long delta);
+
+    // Name of the node's class, e.g. "VarDecl"
+    const char *kindName(Node &node);
+
+}
+
+#endif //AST_UTILS_HPP
@@ -0,0 +1,164 @@
+#include "Batch.hpp"
+#include "Compiler.hpp"
+#include "Trace.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+
+static const size_t SLOWEST_SHOWN = 5;
+
+BatchCompiler::BatchCompiler(const std::vector<std::string> &files, int jobs, const std::string &out_dir)
+        : files(files), jobs(jobs > 0 ? jobs : 1), out_dir(out_dir), wall_micros(0) {}
+
+bool BatchCompiler::readManifest(const std::string &path, std::vector<std::string> &files) {
+    std::ifstream in(path);
+    if (!in)
+        return false;
+    std::string line;
+    while (std::getline(in, line)) {
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        if (!line.empty() && line[0] != '#')
+            files.push_back(line);
+    }
+    return true;
+}
+
+std::string BatchCompiler::outputPath(size_t index) const {
+    std::string name = files[index];
+    size_t start = name.find_first_not_of('/');
+    name = start == std::string::npos ? "" : name.substr(start);
+    std::replace(name.begin(), name.end(), '/', '_');
+    return out_dir + "/" + name + ".out";
+}
+
+void BatchCompiler::compileFile(size_t index) {
+    trace::Span span("file", files[index]);
+    Job &job = results[index];
+    std::ifstream in(files[index], std::ios::binary);
+    if (!in) {
+        job.io_error = true;
+        job.output = "hw3: cannot read " + files[index] + "\n";
+        return;
+    }
+    std::stringstream text;
+    text << in.rdbuf();
+    std::string source = text.str();
+    job.bytes = source.size();
+
+    auto start = std::chrono::steady_clock::now();
+    fanc::Result result = fanc::compile(source.data(), source.size());
+    job.micros = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    job.compile_error = !result.ok();
+    job.output = result.ok() ? result.scopes + "\n" : result.diagnostics.front().message + "\n";
+
+    if (!out_dir.empty()) {
+        std::ofstream out(outputPath(index), std::ios::binary | std::ios::trunc);
+        if (!(out << job.output)) {
+            job.io_error = true;
+            job.output = "hw3: cannot write " + outputPath(index) + "\n";
+            return;
+        }
+        job.output.clear();
+    }
+}
+
+int BatchCompiler::run() {
+    // Two inputs writing the same output would leave whichever finished last
+    if (!out_dir.empty()) {
+        std::unordered_map<std::string, size_t> writers;
+        for (size_t index = 0; index < files.size(); index++) {
+            auto inserted = writers.emplace(outputPath(index), index);
+            if (!inserted.second) {
+                std::cerr << "hw3: " << files[inserted.first->second] << " and " << files[index]
+                          << " would both be written to " << outputPath(index) << std::endl;
+                return 1;
+            }
+        }
+    }
+    results.assign(files.size(), {"", false, false, false, 0, 0});
+    std::atomic<size_t> next(0);
+    std::mutex done_mutex;
+    std::condition_variable done_ready;
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> workers;
+    for (int i = 0; i < jobs; i++) {
+        workers.emplace_back([&, i] {
+            trace::nameThread("batch worker " + std::to_string(i + 1));
+            for (size_t index = next++; index < files.size(); index = next++) {
+                compileFile(index);
+                std::lock_guard<std::mutex> lock(done_mutex);
+                results[index].done = true;
+                done_ready.notify_all();
+            }
+        });
+    }
+
+    // Outputs are written in input order as soon as each file and all files before it are done
+    for (size_t index = 0; index < files.size(); index++) {
+        {
+            std::unique_lock<std::mutex> lock(done_mutex);
+            done_ready.wait(lock, [&] { return results[index].done; });
+        }
+        Job &job = results[index];
+        if (job.io_error)
+            std::cerr << job.output;
+        else if (out_dir.empty())
+            std::cout << "==> " << files[index] << " <==\n" << job.output;
+        job.output.clear();
+    }
+    std::cout.flush();
+    for (auto &worker : workers)
+        worker.join();
+    wall_micros = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+    for (auto &job : results)
+        if (job.io_error)
+            return 1;
+    return 0;
+}
+
+void BatchCompiler::printSummary(std::ostream &os) const {
+    // Nothing ran, the files were rejected before compiling
+    if (results.empty())
+        return;
+    int errors = 0, unreadable = 0;
+    double compile_micros = 0;
+    size_t bytes = 0;
+    std::vector<size_t> order;
+    for (size_t i = 0; i < results.size(); i++) {
+        // A file that could not be read or written counts as failed, even if it also had errors
+        errors += results[i].compile_error && !results[i].io_error;
+        unreadable += results[i].io_error;
+        compile_micros += results[i].micros;
+        bytes += results[i].bytes;
+        order.push_back(i);
+    }
+    // Ties broken by input order, so the list is stable
+    std::stable_sort(order.begin(), order.end(), [this](size_t a, size_t b) {
+        return results[a].micros > results[b].micros;
+    });
+    double seconds = wall_micros / 1e6;
+
+    os << "---batch summary---" << std::endl;
+    os << "files: " << results.size() << " (" << results.size() - errors - unreadable << " ok, " << errors
+       << " with errors, " << unreadable << " failed)" << std::endl;
+    os << std::fixed << std::setprecision(3);
+    os << "jobs: " << jobs << ", wall time: " << wall_micros / 1000 << " ms, compile time: "
+       << compile_micros / 1000 << " ms" << std::endl;
+    os << std::setprecision(1);
+    os << "throughput: " << (seconds > 0 ? results.size() / seconds : 0.0) << " files/s, "
+       << (seconds > 0 ? bytes / seconds / (1 << 20) : 0.0) << " MiB/s" << std::endl;
+    os << "slowest:" << std::endl;
+    os << std::setprecision(3);
+    for (size_t i = 0; i < std::min(SLOWEST_SHOWN, order.size()); i++)
+        os << "  " << std::setw(10) << results[order[i]].micros / 1000 << " ms  " << files[order[i]] << std::endl;
+}
@@ -0,0 +1,51 @@
+#ifndef BATCH_HPP
+#define BATCH_HPP
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+/* Compiles many files in one process, behind hw3 --batch.
+ * Worker threads take the files in order and compile each one with fanc::compile. The output
+ * of a file is what hw3 prints for it alone. It is written to out_dir, one file per input, or
+ * to stdout in input order, each preceded by a "==> path <==" line, so the output does not
+ * depend on the number of jobs.
+ */
+class BatchCompiler {
+public:
+    BatchCompiler(const std::vector<std::string> &files, int jobs, const std::string &out_dir);
+
+    /* Returns the process exit code, 1 if an input or output file could not be accessed or two
+     * inputs map to the same file of out_dir (see outputPath), which is checked before compiling
+     */
+    int run();
+
+    // Total and per-file times, the slowest files and the throughput, nothing when no file was compiled
+    void printSummary(std::ostream &os) const;
+
+    // Reads one path per line, empty lines and lines starting with # are skipped
+    static bool readManifest(const std::string &path, std::vector<std::string> &files);
+
+private:
+    struct Job {
+        std::string output;
+        bool done;
+        bool io_error;
+        bool compile_error;
+        size_t bytes;
+        double micros;
+    };
+
+    std::vector<std::string> files;
+    int jobs;
+    std::string out_dir;
+    std::vector<Job> results;
+    double wall_micros;
+
+    void compileFile(size_t index);
+
+    // Where the output of files[index] goes in out_dir, the path with '/' replaced
+    std::string outputPath(size_t index) const;
+};
+
+#endif //BATCH_HPP
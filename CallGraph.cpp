@@ -0,0 +1,169 @@
+#include "CallGraph.hpp"
+#include "AstUtils.hpp"
+#include <algorithm>
+
+CallGraph::CallGraph(const ast::Funcs &program) {
+    names.reserve(program.funcs.size());
+    for (auto &func : program.funcs) {
+        numbers.emplace(func->id->value, (int) names.size());
+        names.push_back(func->id->value);
+    }
+
+    // The caller that last added an edge to each function, so every callee is listed once
+    std::vector<int> listed_by(names.size(), -1);
+    self_calls.assign(names.size(), false);
+    edge_starts.reserve(names.size() + 1);
+    for (int caller = 0; caller < size(); caller++) {
+        edge_starts.push_back((int) edges.size());
+        // forEachNode keeps its own stack, a call with 100k nested arguments is no deeper than one
+        ast::forEachNode(program.funcs[caller]->body, [&](ast::Node &node) {
+            if (node.kind != ast::NodeKind::Call)
+                return;
+            auto callee = numbers.find(static_cast<ast::Call &>(node).func_id->value);
+            if (callee == numbers.end() || listed_by[callee->second] == caller)
+                return;
+            listed_by[callee->second] = caller;
+            edges.push_back(callee->second);
+            if (callee->second == caller)
+                self_calls[caller] = true;
+        });
+    }
+    edge_starts.push_back((int) edges.size());
+    findComponents();
+}
+
+int CallGraph::find(const std::string &name) const {
+    auto found = numbers.find(name);
+    return found == numbers.end() ? -1 : found->second;
+}
+
+CallGraph::Range CallGraph::callees(int function) const {
+    return {edges.data() + edge_starts[function], edges.data() + edge_starts[function + 1]};
+}
+
+CallGraph::Range CallGraph::members(int component) const {
+    return {order.data() + component_starts[component], order.data() + component_starts[component + 1]};
+}
+
+CallGraph::Range CallGraph::bottomUp() const {
+    return {order.data(), order.data() + order.size()};
+}
+
+bool CallGraph::recursive(int function) const {
+    return self_calls[function] || members(components[function]).size() > 1;
+}
+
+/* Tarjan's algorithm with the recursion kept in frames. A component is complete when the search
+ * leaves its root, after every component it calls, so components come out numbered bottom-up.
+ */
+void CallGraph::findComponents() {
+    struct Frame {
+        int function;
+        int next_edge;
+    };
+
+    int count = size();
+    std::vector<int> visit_index(count, -1);
+    std::vector<int> low_link(count, 0);
+    std::vector<bool> on_stack(count, false);
+    std::vector<int> stack;
+    std::vector<Frame> frames;
+    int visited = 0;
+
+    components.assign(count, -1);
+    order.reserve(count);
+    component_starts.assign(1, 0);
+    auto enter = [&](int function) {
+        visit_index[function] = low_link[function] = visited++;
+        stack.push_back(function);
+        on_stack[function] = true;
+        frames.push_back({function, edge_starts[function]});
+    };
+
+    for (int root = 0; root < count; root++) {
+        if (visit_index[root] != -1)
+            continue;
+        enter(root);
+        while (!frames.empty()) {
+            int function = frames.back().function;
+            if (frames.back().next_edge < edge_starts[function + 1]) {
+                int callee = edges[frames.back().next_edge++];
+                if (visit_index[callee] == -1)
+                    enter(callee);
+                else if (on_stack[callee])
+                    low_link[function] = std::min(low_link[function], visit_index[callee]);
+                continue;
+            }
+            frames.pop_back();
+            if (!frames.empty()) {
+                int caller = frames.back().function;
+                low_link[caller] = std::min(low_link[caller], low_link[function]);
+            }
+            if (low_link[function] != visit_index[function])
+                continue;
+            int component = (int) component_starts.size() - 1;
+            int member;
+            do {
+                member = stack.back();
+                stack.pop_back();
+                on_stack[member] = false;
+                components[member] = component;
+                order.push_back(member);
+            } while (member != function);
+            component_starts.push_back((int) order.size());
+        }
+    }
+}
+
+std::vector<int> CallGraph::unreachable(const std::string &root) const {
+    std::vector<bool> reached(size(), false);
+    std::vector<int> pending;
+    int start = find(root);
+    if (start != -1) {
+        reached[start] = true;
+        pending.push_back(start);
+    }
+    while (!pending.empty()) {
+        int function = pending.back();
+        pending.pop_back();
+        for (int callee : callees(function)) {
+            if (!reached[callee]) {
+                reached[callee] = true;
+                pending.push_back(callee);
+            }
+        }
+    }
+    std::vector<int> unreached;
+    for (int function = 0; function < size(); function++)
+        if (!reached[function])
+            unreached.push_back(function);
+    return unreached;
+}
+
+void CallGraph::print(std::ostream &os) const {
+    os << "---call graph (bottom-up)---" << std::endl;
+    int recursive_components = 0;
+    for (int component = 0; component < componentCount(); component++) {
+        for (int function : members(component)) {
+            os << component << " " << names[function] << " ->";
+            const char *separator = " ";
+            for (int callee : callees(function)) {
+                os << separator << names[callee];
+                separator = ", ";
+            }
+            if (recursive(function))
+                os << " [recursive]";
+            os << std::endl;
+        }
+        recursive_components += recursive(*members(component).begin());
+    }
+    os << size() << " function(s), " << edges.size() << " call edge(s), " << componentCount()
+       << " component(s), " << recursive_components << " recursive" << std::endl;
+    std::vector<int> unreached = unreachable();
+    os << "unreachable from main:";
+    if (unreached.empty())
+        os << " none";
+    for (size_t i = 0; i < unreached.size(); i++)
+        os << (i ? ", " : " ") << names[unreached[i]];
+    os << std::endl;
+}
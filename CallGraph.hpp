@@ -0,0 +1,77 @@
+#ifndef CALL_GRAPH_HPP
+#define CALL_GRAPH_HPP
+
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "nodes.hpp"
+
+/* Which function of the program calls which, from the Call nodes of every FuncDecl body.
+ * Functions are numbered in program order. The graph keeps an edge per distinct callee, calls to
+ * the library (print, printi) are not edges. The strongly connected components, functions that
+ * call each other, are found with Tarjan's algorithm. Both the walk over the bodies and the search
+ * keep explicit stacks, so neither 100k nested calls nor 100k-term expressions exhaust the stack. Building the graph and its components is linear in functions and calls.
+ */
+class CallGraph {
+public:
+    // The functions at [begin, end) of a list of the graph
+    struct Range {
+        const int *first;
+        const int *last;
+
+        const int *begin() const { return first; }
+
+        const int *end() const { return last; }
+
+        size_t size() const { return last - first; }
+    };
+
+    explicit CallGraph(const ast::Funcs &program);
+
+    int size() const { return (int) names.size(); }
+
+    const std::string &name(int function) const { return names[function]; }
+
+    // The number of the function called name, -1 when the program does not define it
+    int find(const std::string &name) const;
+
+    // Distinct functions called by function, in the source order of their first call
+    Range callees(int function) const;
+
+    int componentCount() const { return (int) component_starts.size() - 1; }
+
+    // Components are numbered bottom-up: a component calls only itself and lower components
+    int component(int function) const { return components[function]; }
+
+    Range members(int component) const;
+
+    // True when function can call itself, directly or through other functions
+    bool recursive(int function) const;
+
+    /* Every function after the functions it calls, except within a recursive component whose
+     * members come together. Work scheduled in this order finds its callees finished.
+     */
+    Range bottomUp() const;
+
+    // Functions that no chain of calls from root reaches, in program order
+    std::vector<int> unreachable(const std::string &root = "main") const;
+
+    void print(std::ostream &os) const;
+
+private:
+    std::vector<std::string> names;
+    std::unordered_map<std::string, int> numbers;
+    // Callees of function f are edges[edge_starts[f]..edge_starts[f + 1])
+    std::vector<int> edge_starts;
+    std::vector<int> edges;
+    std::vector<int> components;
+    // Members of component c are order[component_starts[c]..component_starts[c + 1])
+    std::vector<int> component_starts;
+    std::vector<int> order;
+    std::vector<bool> self_calls;
+
+    void findComponents();
+};
+
+#endif //CALL_GRAPH_HPP
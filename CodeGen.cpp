@@ -0,0 +1,400 @@
+#include "CodeGen.hpp"
+#include "TypeRules.hpp"
+#include <unordered_set>
+
+static std::vector<int> merge(const std::vector<int> &first, const std::vector<int> &second) {
+    std::vector<int> result = first;
+    result.insert(result.end(), second.begin(), second.end());
+    return result;
+}
+
+CodeGen::CodeGen(const std::unordered_map<std::string, Symbol> &functions, bool jump_lists)
+        : functions(functions), jump_lists(jump_lists), func(nullptr) {}
+
+ir::Module CodeGen::run(ast::Funcs &program) {
+    ir::Module module;
+    for (auto &decl : program.funcs)
+        module.functions.push_back(lower(*decl));
+    return module;
+}
+
+ir::Function CodeGen::lower(ast::FuncDecl &decl) {
+    ir::Function result;
+    func = &result;
+    result.name = decl.id->value;
+    result.return_type = decl.return_type->type;
+    result.num_params = (int) decl.formals->formals.size();
+    scopes.clear();
+    scopes.emplace_back();
+    for (auto &formal : decl.formals->formals)
+        scopes.back()[formal->id->value] = result.newReg(formal->type->type, formal->id->value);
+
+    statement(decl.body);
+    if (result.code.empty() || result.code.back().op != ir::RET) {
+        // Falling off the end returns the default value of the return type
+        int default_value = -1;
+        if (decl.return_type->type != ast::BuiltInType::VOID)
+            default_value = emitConst(0, decl.offset);
+        emit(ir::RET, decl.offset).a = default_value;
+    }
+    cleanup();
+    func = nullptr;
+    return result;
+}
+
+ir::Instr &CodeGen::emit(ir::Opcode op, source::Offset offset) {
+    func->code.emplace_back(op, offset);
+    return func->code.back();
+}
+
+int CodeGen::emitConst(int value, source::Offset offset) {
+    int dst = func->newReg(ast::BuiltInType::INT);
+    ir::Instr &instr = emit(ir::CONST, offset);
+    instr.dst = dst;
+    instr.imm = value;
+    return dst;
+}
+
+int CodeGen::emitJump(source::Offset offset) {
+    emit(ir::JUMP, offset);
+    return (int) func->code.size() - 1;
+}
+
+int CodeGen::emitBranch(ast::RelOpType cmp, int a, int b, source::Offset offset) {
+    ir::Instr &instr = emit(ir::BRANCH, offset);
+    instr.cmp = cmp;
+    instr.a = a;
+    instr.b = b;
+    return (int) func->code.size() - 1;
+}
+
+int CodeGen::placeLabel(source::Offset offset) {
+    ir::Instr &instr = emit(ir::LABEL, offset);
+    instr.imm = func->newLabel();
+    return instr.imm;
+}
+
+void CodeGen::backpatch(const std::vector<int> &list, int label) {
+    for (int index : list)
+        func->code[index].target = label;
+}
+
+int CodeGen::lookup(const std::string &name) {
+    for (auto scope = scopes.rbegin(); scope != scopes.rend(); ++scope) {
+        auto it = scope->find(name);
+        if (it != scope->end())
+            return it->second;
+    }
+    return -1;
+}
+
+ast::BuiltInType CodeGen::typeOf(const std::shared_ptr<ast::Exp> &exp) {
+    if (ast::cast<ast::Num>(exp))
+        return ast::BuiltInType::INT;
+    if (ast::cast<ast::NumB>(exp))
+        return ast::BuiltInType::BYTE;
+    if (ast::cast<ast::String>(exp))
+        return ast::BuiltInType::STRING;
+    if (auto id = ast::cast<ast::ID>(exp))
+        return func->reg_types[lookup(id->value)];
+    if (auto bin_op = ast::cast<ast::BinOp>(exp))
+        return types::arithmetic(typeOf(bin_op->left), typeOf(bin_op->right));
+    if (auto cast = ast::cast<ast::Cast>(exp))
+        return cast->target_type->type;
+    if (auto call = ast::cast<ast::Call>(exp))
+        return functions.at(call->func_id->value).type;
+    return ast::BuiltInType::BOOL;
+}
+
+int CodeGen::value(const std::shared_ptr<ast::Exp> &exp) {
+    source::Offset offset = exp->offset;
+    if (auto num = ast::cast<ast::Num>(exp))
+        return emitConst(num->value, offset);
+    if (auto num_b = ast::cast<ast::NumB>(exp))
+        return emitConst(num_b->value, offset);
+    if (auto boolean = ast::cast<ast::Bool>(exp))
+        return emitConst(boolean->value, offset);
+    if (auto str = ast::cast<ast::String>(exp)) {
+        int dst = func->newReg(ast::BuiltInType::STRING);
+        ir::Instr &instr = emit(ir::STR, offset);
+        instr.dst = dst;
+        instr.imm = (int) str->literal;
+        return dst;
+    }
+    if (auto id = ast::cast<ast::ID>(exp))
+        return lookup(id->value);
+    if (auto bin_op = ast::cast<ast::BinOp>(exp)) {
+        ast::BuiltInType type = typeOf(exp);
+        int left = value(bin_op->left);
+        int right = value(bin_op->right);
+        if (bin_op->op == ast::BinOpType::DIV) {
+            ir::Instr &check = emit(ir::CHECK_DIV, offset);
+            check.a = right;
+        }
+        int dst = func->newReg(type);
+        ir::Instr &instr = emit((ir::Opcode) (ir::ADD + bin_op->op), offset);
+        instr.dst = dst;
+        instr.a = left;
+        instr.b = right;
+        // Byte arithmetic wraps around, a quotient of two bytes always fits
+        if (type == ast::BuiltInType::BYTE && bin_op->op != ast::BinOpType::DIV) {
+            ir::Instr &trunc = emit(ir::TRUNC, offset);
+            trunc.a = dst;
+            trunc.dst = dst;
+        }
+        return dst;
+    }
+    if (auto cast = ast::cast<ast::Cast>(exp))
+        return valueAs(cast->exp, cast->target_type->type);
+    if (auto call = ast::cast<ast::Call>(exp)) {
+        const Symbol &signature = functions.at(call->func_id->value);
+        std::vector<int> args;
+        for (size_t i = 0; i < call->args->exps.size(); i++)
+            args.push_back(valueAs(call->args->exps[i], signature.params->types[i]));
+        ir::Instr &instr = emit(ir::CALL, offset);
+        instr.text = call->func_id->value;
+        instr.args = args;
+        if (signature.type != ast::BuiltInType::VOID)
+            instr.dst = func->newReg(signature.type);
+        return instr.dst;
+    }
+    return jump_lists ? materialize(exp) : materializeNaive(exp);
+}
+
+// Value of exp converted to type, an int stored into a byte goes through the truncation guard
+int CodeGen::valueAs(const std::shared_ptr<ast::Exp> &exp, ast::BuiltInType type) {
+    int result = value(exp);
+    if (types::narrowing(type, typeOf(exp))) {
+        int dst = func->newReg(type);
+        ir::Instr &trunc = emit(ir::TRUNC, exp->offset);
+        trunc.a = result;
+        trunc.dst = dst;
+        trunc.imm = 1;
+        return dst;
+    }
+    return result;
+}
+
+int CodeGen::materialize(const std::shared_ptr<ast::Exp> &exp) {
+    source::Offset offset = exp->offset;
+    JumpLists lists = condition(exp);
+    int dst = func->newReg(ast::BuiltInType::BOOL);
+    backpatch(lists.true_list, placeLabel(offset));
+    ir::Instr &set_true = emit(ir::CONST, offset);
+    set_true.dst = dst;
+    set_true.imm = 1;
+    int done = emitJump(offset);
+    backpatch(lists.false_list, placeLabel(offset));
+    ir::Instr &set_false = emit(ir::CONST, offset);
+    set_false.dst = dst;
+    backpatch({done}, placeLabel(offset));
+    return dst;
+}
+
+// Baseline lowering: every boolean operator computes its own 0/1 result
+int CodeGen::materializeNaive(const std::shared_ptr<ast::Exp> &exp) {
+    source::Offset offset = exp->offset;
+    int dst = func->newReg(ast::BuiltInType::BOOL);
+    std::vector<int> to_true, to_false;
+    if (auto rel_op = ast::cast<ast::RelOp>(exp)) {
+        int left = value(rel_op->left);
+        int right = value(rel_op->right);
+        to_true.push_back(emitBranch(rel_op->op, left, right, offset));
+        to_false.push_back(emitJump(offset));
+    } else if (auto not_op = ast::cast<ast::Not>(exp)) {
+        int operand = value(not_op->exp);
+        to_true.push_back(emitBranch(ast::RelOpType::EQ, operand, emitConst(0, offset), offset));
+        to_false.push_back(emitJump(offset));
+    } else {
+        auto and_op = ast::cast<ast::And>(exp);
+        auto or_op = ast::cast<ast::Or>(exp);
+        int left = value(and_op ? and_op->left : or_op->left);
+        int zero = emitConst(0, offset);
+        // The right operand is only evaluated when the left one does not decide the result
+        int short_circuit = emitBranch(and_op ? ast::RelOpType::EQ : ast::RelOpType::NE, left, zero, offset);
+        int right = value(and_op ? and_op->right : or_op->right);
+        ir::Instr &copy = emit(ir::COPY, offset);
+        copy.dst = dst;
+        copy.a = right;
+        int done = emitJump(offset);
+        int short_label = placeLabel(offset);
+        backpatch({short_circuit}, short_label);
+        ir::Instr &set = emit(ir::CONST, offset);
+        set.dst = dst;
+        set.imm = and_op ? 0 : 1;
+        backpatch({done}, placeLabel(offset));
+        return dst;
+    }
+    backpatch(to_true, placeLabel(offset));
+    ir::Instr &set_true = emit(ir::CONST, offset);
+    set_true.dst = dst;
+    set_true.imm = 1;
+    int done = emitJump(offset);
+    backpatch(to_false, placeLabel(offset));
+    ir::Instr &set_false = emit(ir::CONST, offset);
+    set_false.dst = dst;
+    backpatch({done}, placeLabel(offset));
+    return dst;
+}
+
+CodeGen::JumpLists CodeGen::condition(const std::shared_ptr<ast::Exp> &exp) {
+    source::Offset offset = exp->offset;
+    JumpLists lists;
+    if (jump_lists) {
+        if (auto rel_op = ast::cast<ast::RelOp>(exp)) {
+            int left = value(rel_op->left);
+            int right = value(rel_op->right);
+            lists.true_list.push_back(emitBranch(rel_op->op, left, right, offset));
+            lists.false_list.push_back(emitJump(offset));
+            return lists;
+        }
+        if (auto not_op = ast::cast<ast::Not>(exp)) {
+            JumpLists inner = condition(not_op->exp);
+            lists.true_list = inner.false_list;
+            lists.false_list = inner.true_list;
+            return lists;
+        }
+        if (auto and_op = ast::cast<ast::And>(exp)) {
+            JumpLists left = condition(and_op->left);
+            backpatch(left.true_list, placeLabel(offset));
+            JumpLists right = condition(and_op->right);
+            lists.true_list = right.true_list;
+            lists.false_list = merge(left.false_list, right.false_list);
+            return lists;
+        }
+        if (auto or_op = ast::cast<ast::Or>(exp)) {
+            JumpLists left = condition(or_op->left);
+            backpatch(left.false_list, placeLabel(offset));
+            JumpLists right = condition(or_op->right);
+            lists.true_list = merge(left.true_list, right.true_list);
+            lists.false_list = right.false_list;
+            return lists;
+        }
+        if (auto boolean = ast::cast<ast::Bool>(exp)) {
+            (boolean->value ? lists.true_list : lists.false_list).push_back(emitJump(offset));
+            return lists;
+        }
+    }
+    // A bool that already lives in a register (variable, call result or naive value) is tested against 0
+    int result = value(exp);
+    lists.true_list.push_back(emitBranch(ast::RelOpType::NE, result, emitConst(0, offset), offset));
+    lists.false_list.push_back(emitJump(offset));
+    return lists;
+}
+
+void CodeGen::statement(const std::shared_ptr<ast::Statement> &statement) {
+    if (statement == nullptr)
+        return;
+    source::Offset offset = statement->offset;
+    if (auto block = ast::cast<ast::Statements>(statement)) {
+        scopes.emplace_back();
+        for (auto &inner : block->statements)
+            this->statement(inner);
+        scopes.pop_back();
+    } else if (auto call = ast::cast<ast::Call>(statement)) {
+        value(call);
+    } else if (ast::cast<ast::Break>(statement)) {
+        loops.back().breaks.push_back(emitJump(offset));
+    } else if (ast::cast<ast::Continue>(statement)) {
+        emit(ir::JUMP, offset).target = loops.back().head;
+    } else if (auto ret = ast::cast<ast::Return>(statement)) {
+        int result = ret->exp != nullptr ? valueAs(ret->exp, func->return_type) : -1;
+        emit(ir::RET, offset).a = result;
+    } else if (auto if_node = ast::cast<ast::If>(statement)) {
+        JumpLists lists = condition(if_node->condition);
+        backpatch(lists.true_list, placeLabel(offset));
+        scopes.emplace_back();
+        this->statement(if_node->then);
+        scopes.pop_back();
+        if (if_node->otherwise != nullptr) {
+            int skip_else = emitJump(offset);
+            backpatch(lists.false_list, placeLabel(offset));
+            scopes.emplace_back();
+            this->statement(if_node->otherwise);
+            scopes.pop_back();
+            backpatch({skip_else}, placeLabel(offset));
+        } else {
+            backpatch(lists.false_list, placeLabel(offset));
+        }
+    } else if (auto while_node = ast::cast<ast::While>(statement)) {
+        int head = placeLabel(offset);
+        JumpLists lists = condition(while_node->condition);
+        backpatch(lists.true_list, placeLabel(offset));
+        loops.push_back({head, {}});
+        scopes.emplace_back();
+        this->statement(while_node->body);
+        scopes.pop_back();
+        emit(ir::JUMP, offset).target = head;
+        int exit = placeLabel(offset);
+        backpatch(lists.false_list, exit);
+        backpatch(loops.back().breaks, exit);
+        loops.pop_back();
+    } else if (auto var_decl = ast::cast<ast::VarDecl>(statement)) {
+        ast::BuiltInType type = var_decl->type->type;
+        int init = var_decl->init_exp != nullptr ? valueAs(var_decl->init_exp, type) : emitConst(0, offset);
+        int dst = func->newReg(type, var_decl->id->value);
+        ir::Instr &copy = emit(ir::COPY, offset);
+        copy.dst = dst;
+        copy.a = init;
+        scopes.back()[var_decl->id->value] = dst;
+    } else if (auto assign = ast::cast<ast::Assign>(statement)) {
+        int dst = lookup(assign->id->value);
+        int result = valueAs(assign->exp, func->reg_types[dst]);
+        ir::Instr &copy = emit(ir::COPY, offset);
+        copy.dst = dst;
+        copy.a = result;
+    }
+}
+
+// Peephole pass over the finished function: inverts a branch over a jump, drops jumps to the
+// next instruction and code that can never be reached
+void CodeGen::cleanup() {
+    auto &code = func->code;
+    auto falls_into = [&code](size_t index, int label) {
+        for (size_t next = index + 1; next < code.size() && code[next].op == ir::LABEL; next++)
+            if (code[next].imm == label)
+                return true;
+        return false;
+    };
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        std::vector<ir::Instr> result;
+        for (size_t i = 0; i < code.size(); i++) {
+            ir::Instr &instr = code[i];
+            if (instr.op == ir::BRANCH && i + 1 < code.size() && code[i + 1].op == ir::JUMP &&
+                falls_into(i + 1, instr.target)) {
+                instr.cmp = ir::negate(instr.cmp);
+                instr.target = code[i + 1].target;
+                result.push_back(instr);
+                i++;
+                changed = true;
+                continue;
+            }
+            if (instr.isBranch() && falls_into(i, instr.target)) {
+                changed = true;
+                continue;
+            }
+            result.push_back(instr);
+            if (instr.op == ir::JUMP || instr.op == ir::RET) {
+                while (i + 1 < code.size() && code[i + 1].op != ir::LABEL) {
+                    i++;
+                    changed = true;
+                }
+            }
+        }
+        std::unordered_set<int> used;
+        for (auto &instr : result)
+            if (instr.isBranch())
+                used.insert(instr.target);
+        code.clear();
+        for (auto &instr : result) {
+            if (instr.op == ir::LABEL && !used.count(instr.imm)) {
+                changed = true;
+                continue;
+            }
+            code.push_back(instr);
+        }
+    }
+}
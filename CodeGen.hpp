@@ -0,0 +1,74 @@
+#ifndef CODEGEN_HPP
+#define CODEGEN_HPP
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "nodes.hpp"
+#include "IR.hpp"
+#include "SymbolTable.hpp"
+
+/* Lowers the checked AST to IR.
+ * Conditions of if/while are lowered with true/false jump lists that are backpatched once the
+ * targets are known: `and`/`or` become pure branches and `not` only swaps the two lists.
+ * A 0/1 value is materialised only where a bool is stored, passed or returned.
+ * With jump_lists disabled every boolean subexpression is materialised first and then tested,
+ * which is kept as the baseline that --branch-stats compares against.
+ */
+class CodeGen {
+public:
+    CodeGen(const std::unordered_map<std::string, Symbol> &functions, bool jump_lists = true);
+
+    ir::Module run(ast::Funcs &program);
+
+    ir::Function lower(ast::FuncDecl &func);
+
+private:
+    struct JumpLists {
+        std::vector<int> true_list;
+        std::vector<int> false_list;
+    };
+
+    struct Loop {
+        int head;
+        std::vector<int> breaks;
+    };
+
+    const std::unordered_map<std::string, Symbol> &functions;
+    bool jump_lists;
+    ir::Function *func;
+    std::vector<std::unordered_map<std::string, int>> scopes;
+    std::vector<Loop> loops;
+
+    ir::Instr &emit(ir::Opcode op, source::Offset offset);
+
+    int emitConst(int value, source::Offset offset);
+
+    int emitJump(source::Offset offset);
+
+    int emitBranch(ast::RelOpType cmp, int a, int b, source::Offset offset);
+
+    int placeLabel(source::Offset offset);
+
+    void backpatch(const std::vector<int> &list, int label);
+
+    int lookup(const std::string &name);
+
+    ast::BuiltInType typeOf(const std::shared_ptr<ast::Exp> &exp);
+
+    int value(const std::shared_ptr<ast::Exp> &exp);
+
+    int valueAs(const std::shared_ptr<ast::Exp> &exp, ast::BuiltInType type);
+
+    int materialize(const std::shared_ptr<ast::Exp> &exp);
+
+    int materializeNaive(const std::shared_ptr<ast::Exp> &exp);
+
+    JumpLists condition(const std::shared_ptr<ast::Exp> &exp);
+
+    void statement(const std::shared_ptr<ast::Statement> &statement);
+
+    void cleanup();
+};
+
+#endif //CODEGEN_HPP
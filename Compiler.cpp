@@ -0,0 +1,169 @@
+#include "Compiler.hpp"
+#include "SemanticAnalyzer.hpp"
+#include "AstUtils.hpp"
+#include "output.hpp"
+#include "Trace.hpp"
+#include "Pipeline.hpp"
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <sstream>
+
+// From the bison-generated parser and the flex-generated scanner
+extern int yyparse();
+extern int pushParse();
+extern std::shared_ptr<ast::Node> program;
+extern std::function<void(const std::shared_ptr<ast::FuncDecl> &)> function_parsed;
+extern YYSTYPE yylval;
+extern void setParserMaxDepth(long depth);
+extern void releaseParserStacks();
+extern void scanBuffer(const char *buf, size_t len, source::Offset offset, source::LineTable *lines,
+                       literals::Pool *pool);
+extern void scanStream(int fd, source::LineTable *lines, literals::Pool *pool);
+extern void endScanBuffer();
+
+namespace fanc {
+    std::mutex parse_mutex;
+
+    // Resets the scanner and parser globals after a parse, whether it succeeded or threw
+    static void endParse() {
+        endScanBuffer();
+        releaseParserStacks();
+        function_parsed = nullptr;
+        stats::current = nullptr;
+    }
+
+    /* Parses buf, or fd as it is read when fd is not -1, on this thread or on the threads of
+     * pipeline::parse, recording the line starts into lines and the string literals into pool. When sa is set, each function's
+     * signature is registered as soon as the function is reduced. An error found there is only
+     * reported once the whole input parsed, like the sequential analysis does, because a syntax
+     * error further down comes first.
+     */
+    static std::shared_ptr<ast::Funcs> parse(const char *buf, size_t len, int fd, const Options &options,
+                                             source::LineTable *lines, literals::Pool *pool, SemanticAnalyzer *sa,
+                                             stats::Report *report) {
+        std::lock_guard<std::mutex> lock(parse_mutex);
+        if (fd >= 0)
+            scanStream(fd, lines, pool);
+        else
+            scanBuffer(buf, len, 0, lines, pool);
+        setParserMaxDepth(options.max_parse_depth);
+        std::exception_ptr declaration_error;
+        std::function<void(const std::shared_ptr<ast::FuncDecl> &)> declare;
+        if (sa != nullptr) {
+            declare = [sa, &declaration_error](const std::shared_ptr<ast::FuncDecl> &func) {
+                if (declaration_error != nullptr)
+                    return;
+                try {
+                    sa->declare(*func);
+                } catch (const output::CompileError &) {
+                    declaration_error = std::current_exception();
+                }
+            };
+        }
+        try {
+            if (options.pipeline) {
+                pipeline::parse(declare, report);
+            } else {
+                function_parsed = declare;
+                stats::current = report;
+                stats::PhaseTimer timer(report, stats::PARSE);
+                trace::Span span("phase", "parse");
+                if (fd >= 0)
+                    pushParse();
+                else
+                    yyparse();
+            }
+        } catch (...) {
+            endParse();
+            ::program = nullptr;
+            yylval = nullptr;
+            throw;
+        }
+        endParse();
+        if (report != nullptr && !options.pipeline) {
+            // The scanner ran inside the parser, its time is accounted to the lex phase only
+            report->phases[stats::PARSE].wall_micros -= report->phases[stats::LEX].wall_micros;
+            report->phases[stats::PARSE].cpu_micros -= report->phases[stats::LEX].cpu_micros;
+        }
+        // The globals would otherwise keep the nodes alive until the next call
+        auto funcs = ast::cast<ast::Funcs>(::program);
+        ::program = nullptr;
+        yylval = nullptr;
+        if (declaration_error != nullptr) {
+            ast::destroyTree(std::move(funcs));
+            std::rethrow_exception(declaration_error);
+        }
+        return funcs;
+    }
+
+    // compile and compileStream, the input is fd unless it is -1
+    static Result compileInput(const char *buf, size_t len, int fd, const Options &options) {
+        Result result;
+        stats::Report *report = nullptr;
+        if (options.stats) {
+            report = &result.stats;
+            report->enabled = true;
+            stats::counters = stats::Counters();
+#ifdef FANC_MEMSTATS
+            memory::reset();
+#endif
+        }
+        try {
+            SemanticAnalyzer sa;
+            sa.cache = options.cache;
+            result.literals = std::make_shared<literals::Pool>();
+            sa.literals = result.literals.get();
+            // Streams and pipelined parses register the signatures while they parse
+            bool early = fd >= 0 || options.pipeline;
+            SemanticAnalyzer *declaring = early && options.analyze ? &sa : nullptr;
+            result.program = parse(buf, len, fd, options, &result.lines, result.literals.get(), declaring, report);
+            stats::snapshot(report, stats::PARSE);
+            if (options.analyze) {
+                {
+                    stats::PhaseTimer timer(report, stats::ANALYSIS);
+                    trace::Span span("phase", "analysis");
+                    if (declaring == nullptr) {
+                        sa.visit(*result.program);
+                    } else {
+                        sa.finishDeclarations(*result.program);
+                        sa.checkBodies(*result.program);
+                    }
+                }
+                stats::snapshot(report, stats::ANALYSIS);
+                stats::PhaseTimer timer(report, stats::PRINT);
+                trace::Span span("phase", "print");
+                {
+                    MEMORY_TAG(memory::OUTPUT);
+                    std::ostringstream scopes;
+                    scopes << sa.sym_table.global->scopePrinter;
+                    result.scopes = scopes.str();
+                }
+                result.functions = sa.sym_table.globalFunctionRegistry;
+                result.signatures = sa.sym_table.signatures;
+                stats::snapshot(report, stats::PRINT);
+            }
+        } catch (const output::CompileError &error) {
+            source::Position position = {0, 0};
+            if (error.offset != source::NOWHERE)
+                position = result.lines.position(error.offset);
+            result.diagnostics.push_back({position.line, position.column, error.format(result.lines)});
+            ast::destroyTree(std::move(result.program));
+        }
+        if (report != nullptr)
+            stats::finish(*report, result.program, result.literals.get());
+        return result;
+    }
+
+    Result::~Result() {
+        ast::destroyTree(std::move(program));
+    }
+
+    Result compile(const char *buf, size_t len, const Options &options) {
+        return compileInput(buf, len, -1, options);
+    }
+
+    Result compileStream(int fd, const Options &options) {
+        return compileInput(nullptr, 0, fd, options);
+    }
+}
@@ -0,0 +1,79 @@
+#ifndef COMPILER_HPP
+#define COMPILER_HPP
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "nodes.hpp"
+#include "Source.hpp"
+#include "SymbolTable.hpp"
+#include "AnalysisCache.hpp"
+#include "Stats.hpp"
+
+/* Library entry point of the compiler (libfanc).
+ * compile() parses and checks a program held in memory and returns everything the command line
+ * tool would print, instead of printing it and ending the process. Nothing of one call is left
+ * behind for the next one. compile() can be called from several threads: the scanner and parser
+ * are global state, so parsing is serialised by a lock, the analysis of the parsed programs runs
+ * in parallel. A cache in Options must not be shared between concurrent calls.
+ */
+namespace fanc {
+    struct Options {
+        bool analyze;           // false stops after parsing
+        bool stats;             // fills Result::stats
+        AnalysisCache *cache;   // replays cached function analyses when set, not owned
+        long max_parse_depth;   // entries of the parser stacks before a syntax error, 0 for YYMAXDEPTH
+        bool pipeline;          // lexes, parses and registers signatures on three threads, see Pipeline.hpp
+
+        Options() : analyze(true), stats(false), cache(nullptr), max_parse_depth(0), pipeline(false) {};
+    };
+
+    struct Diagnostic {
+        int line;               // 0 when the error is about the whole program
+        int column;             // in bytes from 1, 0 with line
+        std::string message;    // as printed by hw3, e.g. "line 3: type mismatch"
+    };
+
+    struct Result {
+        // The first error, compilation stops at it like the command line tool does
+        std::vector<Diagnostic> diagnostics;
+        // The scope and symbol listing hw3 prints for a correct program
+        std::string scopes;
+        // Signatures of all functions, including print and printi
+        std::unordered_map<std::string, Symbol> functions;
+        // Owns the parameter lists the Symbols of functions point to
+        std::shared_ptr<signatures::Interner> signatures;
+        std::shared_ptr<ast::Funcs> program;
+        // Where the lines of the source start, for the line and column of the offsets in program
+        source::LineTable lines;
+        // The string literals of program, ast::String and ir::STR hold indexes into it
+        std::shared_ptr<literals::Pool> literals;
+        // Phase times and counters, when Options::stats is set
+        stats::Report stats;
+
+        bool ok() const { return diagnostics.empty(); }
+
+        Result() = default;
+        Result(Result &&) = default;
+        Result &operator=(Result &&) = default;
+        // Frees the AST without recursing, see ast::destroyTree
+        ~Result();
+    };
+
+    Result compile(const char *buf, size_t len, const Options &options = Options());
+
+    // Guards the scanner and parser globals, held by every parse: compile, compileStream and IncrementalParser
+    extern std::mutex parse_mutex;
+
+    /* Same as compile, for a program read from fd (a pipe) as it is written. Parsing runs while the
+     * writer is still producing, and the signature of every function is registered as soon as the
+     * function is parsed, so only the function bodies are left to check at the end of the input.
+     * A syntax error is reported when it is reached, without waiting for the rest.
+     */
+    Result compileStream(int fd, const Options &options = Options());
+}
+
+#endif //COMPILER_HPP
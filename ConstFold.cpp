@@ -0,0 +1,253 @@
+#include "ConstFold.hpp"
+#include <cstdint>
+#include "AstUtils.hpp"
+
+/* True when evaluating exp can do more than produce its value: a call, or a division the IR
+ * guards with CHECK_DIV because its divisor is not a nonzero literal. Such an operand of and/or
+ * must still run, even when the other operand decides the result.
+ */
+static bool hasEffect(const std::shared_ptr<ast::Exp> &exp) {
+    bool found = false;
+    ast::forEachNode(exp, [&found](ast::Node &node) {
+        if (node.kind == ast::NodeKind::Call) {
+            found = true;
+        } else if (auto bin_op = ast::cast<ast::BinOp>(&node)) {
+            found |= bin_op->op == ast::BinOpType::DIV &&
+                     !(ConstantFolder::isLiteral(bin_op->right) && ConstantFolder::literalValue(bin_op->right) != 0);
+        }
+    });
+    return found;
+}
+
+// Wraps a statement taken out of an if or while so it keeps its own scope
+static std::shared_ptr<ast::Statement> asScope(const std::shared_ptr<ast::Statement> &statement, source::Offset offset) {
+    auto block = ast::cast<ast::Statements>(statement);
+    if (block == nullptr) {
+        block = std::make_shared<ast::Statements>();
+        if (statement != nullptr)
+            block->push_back(statement);
+    }
+    block->offset = offset;
+    block->is_scope = true;
+    return block;
+}
+
+bool ConstantFolder::isLiteral(const std::shared_ptr<ast::Exp> &exp) {
+    return ast::cast<ast::Num>(exp) || ast::cast<ast::NumB>(exp) ||
+           ast::cast<ast::Bool>(exp);
+}
+
+int ConstantFolder::literalValue(const std::shared_ptr<ast::Exp> &exp) {
+    if (auto num = ast::cast<ast::Num>(exp))
+        return num->value;
+    if (auto num_b = ast::cast<ast::NumB>(exp))
+        return num_b->value;
+    return ast::cast<ast::Bool>(exp)->value;
+}
+
+std::shared_ptr<ast::Exp> ConstantFolder::makeLiteral(ast::BuiltInType type, int value, source::Offset offset) {
+    std::shared_ptr<ast::Exp> literal;
+    if (type == ast::BuiltInType::BOOL)
+        literal = std::make_shared<ast::Bool>(value != 0);
+    else if (type == ast::BuiltInType::BYTE)
+        literal = std::make_shared<ast::NumB>(std::to_string(value & 0xff).c_str());
+    else
+        literal = ast::makeNum(value, offset);
+    literal->offset = offset;
+    return literal;
+}
+
+void ConstantFolder::run(ast::FuncDecl &func, const std::unordered_map<std::string, std::shared_ptr<ast::Exp>> &initial) {
+    assigned.clear();
+    ast::forEachAssign(func.body, [this](ast::Assign &assign) { assigned.insert(assign.id->value); });
+    // Variables that are assigned somewhere do not keep their initial value
+    constants.clear();
+    for (auto &constant : initial)
+        if (!assigned.count(constant.first))
+            constants.insert(constant);
+    for (auto &statement : func.body->statements)
+        statement = fold(statement);
+}
+
+std::shared_ptr<ast::Exp> ConstantFolder::fold(const std::shared_ptr<ast::Exp> &exp) {
+    if (auto id = ast::cast<ast::ID>(exp)) {
+        auto it = constants.find(id->value);
+        if (it == constants.end())
+            return exp;
+        auto literal = ast::cloneExp(it->second, {});
+        literal->offset = id->offset;
+        return literal;
+    }
+    if (auto bin_op = ast::cast<ast::BinOp>(exp)) {
+        bin_op->left = fold(bin_op->left);
+        bin_op->right = fold(bin_op->right);
+        if (!isLiteral(bin_op->left) || !isLiteral(bin_op->right))
+            return exp;
+        int64_t left = literalValue(bin_op->left), right = literalValue(bin_op->right);
+        int64_t result;
+        switch (bin_op->op) {
+            case ast::BinOpType::ADD:
+                result = left + right;
+                break;
+            case ast::BinOpType::SUB:
+                result = left - right;
+                break;
+            case ast::BinOpType::MUL:
+                result = left * right;
+                break;
+            default:
+                // Division by zero has to fail at runtime
+                if (right == 0)
+                    return exp;
+                result = left / right;
+                break;
+        }
+        bool is_byte = ast::cast<ast::NumB>(bin_op->left) &&
+                       ast::cast<ast::NumB>(bin_op->right);
+        folded_exps++;
+        return makeLiteral(is_byte ? ast::BuiltInType::BYTE : ast::BuiltInType::INT, (int32_t) (uint32_t) result,
+                           exp->offset);
+    }
+    if (auto rel_op = ast::cast<ast::RelOp>(exp)) {
+        rel_op->left = fold(rel_op->left);
+        rel_op->right = fold(rel_op->right);
+        if (!isLiteral(rel_op->left) || !isLiteral(rel_op->right))
+            return exp;
+        int left = literalValue(rel_op->left), right = literalValue(rel_op->right);
+        bool result = false;
+        switch (rel_op->op) {
+            case ast::RelOpType::EQ:
+                result = left == right;
+                break;
+            case ast::RelOpType::NE:
+                result = left != right;
+                break;
+            case ast::RelOpType::LT:
+                result = left < right;
+                break;
+            case ast::RelOpType::GT:
+                result = left > right;
+                break;
+            case ast::RelOpType::LE:
+                result = left <= right;
+                break;
+            case ast::RelOpType::GE:
+                result = left >= right;
+                break;
+        }
+        folded_exps++;
+        return makeLiteral(ast::BuiltInType::BOOL, result, exp->offset);
+    }
+    if (auto not_op = ast::cast<ast::Not>(exp)) {
+        not_op->exp = fold(not_op->exp);
+        if (!isLiteral(not_op->exp))
+            return exp;
+        folded_exps++;
+        return makeLiteral(ast::BuiltInType::BOOL, !literalValue(not_op->exp), exp->offset);
+    }
+    if (auto and_op = ast::cast<ast::And>(exp)) {
+        and_op->left = fold(and_op->left);
+        and_op->right = fold(and_op->right);
+        // The left operand is only dropped when skipping it cannot skip a call or a division guard
+        if (isLiteral(and_op->left)) {
+            folded_exps++;
+            return literalValue(and_op->left) ? and_op->right : and_op->left;
+        }
+        if (isLiteral(and_op->right) && literalValue(and_op->right)) {
+            folded_exps++;
+            return and_op->left;
+        }
+        if (isLiteral(and_op->right) && !hasEffect(and_op->left)) {
+            folded_exps++;
+            return and_op->right;
+        }
+        return exp;
+    }
+    if (auto or_op = ast::cast<ast::Or>(exp)) {
+        or_op->left = fold(or_op->left);
+        or_op->right = fold(or_op->right);
+        if (isLiteral(or_op->left)) {
+            folded_exps++;
+            return literalValue(or_op->left) ? or_op->left : or_op->right;
+        }
+        if (isLiteral(or_op->right) && !literalValue(or_op->right)) {
+            folded_exps++;
+            return or_op->left;
+        }
+        if (isLiteral(or_op->right) && !hasEffect(or_op->left)) {
+            folded_exps++;
+            return or_op->right;
+        }
+        return exp;
+    }
+    if (auto cast = ast::cast<ast::Cast>(exp)) {
+        cast->exp = fold(cast->exp);
+        if (!isLiteral(cast->exp))
+            return exp;
+        folded_exps++;
+        return makeLiteral(cast->target_type->type, literalValue(cast->exp), exp->offset);
+    }
+    if (auto call = ast::cast<ast::Call>(exp)) {
+        std::shared_ptr<ast::Exp> result;
+        if (foldCall(*call, result) && result != nullptr) {
+            result->offset = exp->offset;
+            return result;
+        }
+    }
+    return exp;
+}
+
+bool ConstantFolder::foldCall(ast::Call &call, std::shared_ptr<ast::Exp> &result) {
+    bool constant_args = true;
+    for (auto &arg : call.args->exps) {
+        arg = fold(arg);
+        constant_args = constant_args && isLiteral(arg);
+    }
+    if (!evaluate || !constant_args || !evaluate(call, result))
+        return false;
+    folded_calls++;
+    return true;
+}
+
+std::shared_ptr<ast::Statement> ConstantFolder::fold(const std::shared_ptr<ast::Statement> &statement) {
+    if (statement == nullptr)
+        return nullptr;
+    if (auto statements = ast::cast<ast::Statements>(statement)) {
+        for (auto &inner : statements->statements)
+            inner = fold(inner);
+    } else if (auto call = ast::cast<ast::Call>(statement)) {
+        // A call that could be evaluated has no effect besides its result
+        std::shared_ptr<ast::Exp> result;
+        if (foldCall(*call, result))
+            return asScope(nullptr, statement->offset);
+    } else if (auto ret = ast::cast<ast::Return>(statement)) {
+        if (ret->exp != nullptr)
+            ret->exp = fold(ret->exp);
+    } else if (auto var_decl = ast::cast<ast::VarDecl>(statement)) {
+        if (var_decl->init_exp != nullptr)
+            var_decl->init_exp = fold(var_decl->init_exp);
+        const std::string &name = var_decl->id->value;
+        if (var_decl->init_exp != nullptr && isLiteral(var_decl->init_exp) && !assigned.count(name))
+            constants[name] = makeLiteral(var_decl->type->type, literalValue(var_decl->init_exp), var_decl->offset);
+        else
+            constants.erase(name);
+    } else if (auto assign = ast::cast<ast::Assign>(statement)) {
+        assign->exp = fold(assign->exp);
+    } else if (auto if_node = ast::cast<ast::If>(statement)) {
+        if_node->condition = fold(if_node->condition);
+        if_node->then = fold(if_node->then);
+        if_node->otherwise = fold(if_node->otherwise);
+        if (isLiteral(if_node->condition)) {
+            folded_branches++;
+            return asScope(literalValue(if_node->condition) ? if_node->then : if_node->otherwise, statement->offset);
+        }
+    } else if (auto while_node = ast::cast<ast::While>(statement)) {
+        while_node->condition = fold(while_node->condition);
+        while_node->body = fold(while_node->body);
+        if (isLiteral(while_node->condition) && !literalValue(while_node->condition)) {
+            folded_branches++;
+            return asScope(nullptr, statement->offset);
+        }
+    }
+    return statement;
+}
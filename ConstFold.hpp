@@ -0,0 +1,52 @@
+#ifndef CONST_FOLD_HPP
+#define CONST_FOLD_HPP
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include "nodes.hpp"
+
+/* Folds constant expressions and branches of a function body.
+ * Variables that are initialised with a literal and never assigned afterwards are replaced by
+ * that literal, so folding carries through local declarations. Arithmetic follows the runtime:
+ * int wraps at 32 bits, byte results wrap at 8 bits and division by a literal zero is left in
+ * place for the runtime error. An if or while whose condition folds to a literal is replaced by
+ * the branch that is taken.
+ * When evaluate is set, calls whose arguments are all literals are offered to it. It returns
+ * true if it could run the call at compile time and sets the result (nullptr for void calls),
+ * the call is then replaced by that literal or dropped when it is a statement.
+ */
+class ConstantFolder {
+public:
+    int folded_branches;
+    int folded_exps;
+    int folded_calls;
+    std::function<bool(ast::Call &, std::shared_ptr<ast::Exp> &)> evaluate;
+
+    ConstantFolder() : folded_branches(0), folded_exps(0), folded_calls(0) {};
+
+    // Folds the body of func, constants maps variables known to hold a literal to that literal
+    void run(ast::FuncDecl &func, const std::unordered_map<std::string, std::shared_ptr<ast::Exp>> &constants = {});
+
+    static bool isLiteral(const std::shared_ptr<ast::Exp> &exp);
+
+    // Literal of the given type, wrapping value the way a conversion at runtime would
+    static std::shared_ptr<ast::Exp> makeLiteral(ast::BuiltInType type, int value, source::Offset offset);
+
+    // Value of an int, byte or bool literal
+    static int literalValue(const std::shared_ptr<ast::Exp> &exp);
+
+    std::shared_ptr<ast::Exp> fold(const std::shared_ptr<ast::Exp> &exp);
+
+private:
+    std::unordered_map<std::string, std::shared_ptr<ast::Exp>> constants;
+    std::unordered_set<std::string> assigned;
+
+    std::shared_ptr<ast::Statement> fold(const std::shared_ptr<ast::Statement> &statement);
+
+    bool foldCall(ast::Call &call, std::shared_ptr<ast::Exp> &result);
+};
+
+#endif //CONST_FOLD_HPP
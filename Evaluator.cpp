@@ -0,0 +1,316 @@
+#include "Evaluator.hpp"
+#include "AstUtils.hpp"
+#include "ConstFold.hpp"
+#include "TypeRules.hpp"
+#include <cstdint>
+
+// Converts a value the way storing it into a variable of the given type does at runtime
+static int convert(int value, ast::BuiltInType from, ast::BuiltInType to) {
+    if (types::narrowing(to, from))
+        return value & 0xff;
+    return value;
+}
+
+static std::string callToString(const std::string &name, const std::vector<std::shared_ptr<ast::Exp>> &args) {
+    std::string text = name + "(";
+    for (size_t i = 0; i < args.size(); i++)
+        text += (i ? ", " : "") + std::to_string(ConstantFolder::literalValue(args[i]));
+    return text + ")";
+}
+
+CompileTimeEvaluator::CompileTimeEvaluator(const std::unordered_map<std::string, Symbol> &functions,
+                                           const EvalOptions &options)
+        : functions(functions), options(options), steps(0), total_steps(0), branches_folded(0), exps_folded(0) {}
+
+void CompileTimeEvaluator::run(ast::Funcs &program) {
+    for (auto &func : program.funcs)
+        bodies[func->id->value] = func;
+    findPure(program);
+
+    ConstantFolder folder;
+    folder.evaluate = [this](ast::Call &call, std::shared_ptr<ast::Exp> &result) { return evaluate(call, result); };
+    for (auto &func : program.funcs)
+        folder.run(*func);
+    branches_folded = folder.folded_branches;
+    exps_folded = folder.folded_exps;
+}
+
+void CompileTimeEvaluator::findPure(ast::Funcs &program) {
+    std::unordered_map<std::string, std::unordered_set<std::string>> callees;
+    for (auto &func : program.funcs) {
+        auto &called = callees[func->id->value];
+        ast::forEachCall(func->body, [&called](ast::Call &call) { called.insert(call.func_id->value); });
+        pure.insert(func->id->value);
+    }
+    // print and printi have no body, so they are never pure and impurity spreads to every caller
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (auto &func : program.funcs) {
+            const std::string &name = func->id->value;
+            if (!pure.count(name))
+                continue;
+            for (auto &callee : callees[name]) {
+                if (!pure.count(callee)) {
+                    pure.erase(name);
+                    changed = true;
+                    break;
+                }
+            }
+        }
+    }
+}
+
+bool CompileTimeEvaluator::evaluate(ast::Call &call, std::shared_ptr<ast::Exp> &result) {
+    const std::string &name = call.func_id->value;
+    if (!pure.count(name))
+        return false;
+    const Symbol &signature = functions.at(name);
+    std::string text = callToString(name, call.args->exps);
+    // A call that hit a limit once would only burn the same steps again
+    auto failed = failures.find(text);
+    if (failed != failures.end()) {
+        decisions.push_back({call.offset, text, false, failed->second});
+        return false;
+    }
+    std::vector<Value> args;
+    for (size_t i = 0; i < call.args->exps.size(); i++) {
+        auto &arg = call.args->exps[i];
+        ast::BuiltInType type = ast::cast<ast::NumB>(arg) ? ast::BuiltInType::BYTE :
+                                ast::cast<ast::Bool>(arg) ? ast::BuiltInType::BOOL :
+                                ast::BuiltInType::INT;
+        args.push_back({ConstantFolder::literalValue(arg), type});
+    }
+
+    steps = 0;
+    failure.clear();
+    frames.clear();
+    Value value = this->call(name, args);
+    total_steps += steps;
+    if (!failure.empty()) {
+        failures[text] = failure;
+        decisions.push_back({call.offset, text, false, failure});
+        return false;
+    }
+    result = nullptr;
+    if (signature.type != ast::BuiltInType::VOID)
+        result = ConstantFolder::makeLiteral(signature.type, value.value, call.offset);
+    std::string shown = signature.type == ast::BuiltInType::VOID ? "removed" :
+                        signature.type == ast::BuiltInType::BOOL ? (value.value ? "true" : "false") :
+                        std::to_string(value.value);
+    decisions.push_back({call.offset, text, true, shown});
+    return true;
+}
+
+bool CompileTimeEvaluator::step() {
+    if (!failure.empty())
+        return false;
+    if (++steps > options.max_steps) {
+        failure = "step limit of " + std::to_string(options.max_steps) + " reached";
+        return false;
+    }
+    return true;
+}
+
+CompileTimeEvaluator::Value CompileTimeEvaluator::call(const std::string &name, const std::vector<Value> &args) {
+    const Symbol &signature = functions.at(name);
+    Value result = {0, signature.type};
+    if ((int) frames.size() >= options.max_depth) {
+        failure = "call depth limit of " + std::to_string(options.max_depth) + " reached";
+        return result;
+    }
+    // Pure functions always return the same value for the same arguments
+    std::string key = name;
+    for (auto &arg : args)
+        key += " " + std::to_string(arg.value);
+    auto it = memo.find(key);
+    if (it != memo.end())
+        return it->second;
+
+    const auto &func = bodies.at(name);
+    frames.push_back({{{}}, result});
+    for (size_t i = 0; i < args.size(); i++) {
+        ast::BuiltInType type = signature.params->types[i];
+        frames.back().scopes.back()[func->formals->formals[i]->id->value] = {convert(args[i].value, args[i].type, type),
+                                                                             type};
+    }
+    exec(func->body);
+    result = frames.back().result;
+    frames.pop_back();
+    if (failure.empty())
+        memo[key] = result;
+    return result;
+}
+
+CompileTimeEvaluator::Value &CompileTimeEvaluator::lookup(const std::string &name) {
+    auto &scopes = frames.back().scopes;
+    for (auto scope = scopes.rbegin(); scope != scopes.rend(); ++scope) {
+        auto it = scope->find(name);
+        if (it != scope->end())
+            return it->second;
+    }
+    // The program passed semantic analysis, every name is declared
+    return scopes.front()[name];
+}
+
+CompileTimeEvaluator::Value CompileTimeEvaluator::eval(const std::shared_ptr<ast::Exp> &exp) {
+    Value none = {0, ast::BuiltInType::INT};
+    if (!step())
+        return none;
+    if (auto num = ast::cast<ast::Num>(exp))
+        return {num->value, ast::BuiltInType::INT};
+    if (auto num_b = ast::cast<ast::NumB>(exp))
+        return {num_b->value, ast::BuiltInType::BYTE};
+    if (auto boolean = ast::cast<ast::Bool>(exp))
+        return {boolean->value, ast::BuiltInType::BOOL};
+    if (auto id = ast::cast<ast::ID>(exp))
+        return lookup(id->value);
+    if (auto bin_op = ast::cast<ast::BinOp>(exp)) {
+        Value left = eval(bin_op->left);
+        Value right = eval(bin_op->right);
+        int64_t result;
+        switch (bin_op->op) {
+            case ast::BinOpType::ADD:
+                result = (int64_t) left.value + right.value;
+                break;
+            case ast::BinOpType::SUB:
+                result = (int64_t) left.value - right.value;
+                break;
+            case ast::BinOpType::MUL:
+                result = (int64_t) left.value * right.value;
+                break;
+            default:
+                if (right.value == 0) {
+                    if (failure.empty())
+                        failure = "division by zero";
+                    return none;
+                }
+                result = (int64_t) left.value / right.value;
+                break;
+        }
+        if (types::arithmetic(left.type, right.type) == ast::BuiltInType::BYTE)
+            return {(int) (result & 0xff), ast::BuiltInType::BYTE};
+        return {(int32_t) (uint32_t) result, ast::BuiltInType::INT};
+    }
+    if (auto rel_op = ast::cast<ast::RelOp>(exp)) {
+        int left = eval(rel_op->left).value;
+        int right = eval(rel_op->right).value;
+        bool result = false;
+        switch (rel_op->op) {
+            case ast::RelOpType::EQ:
+                result = left == right;
+                break;
+            case ast::RelOpType::NE:
+                result = left != right;
+                break;
+            case ast::RelOpType::LT:
+                result = left < right;
+                break;
+            case ast::RelOpType::GT:
+                result = left > right;
+                break;
+            case ast::RelOpType::LE:
+                result = left <= right;
+                break;
+            case ast::RelOpType::GE:
+                result = left >= right;
+                break;
+        }
+        return {result, ast::BuiltInType::BOOL};
+    }
+    if (auto not_op = ast::cast<ast::Not>(exp))
+        return {!eval(not_op->exp).value, ast::BuiltInType::BOOL};
+    if (auto and_op = ast::cast<ast::And>(exp))
+        return {eval(and_op->left).value && eval(and_op->right).value, ast::BuiltInType::BOOL};
+    if (auto or_op = ast::cast<ast::Or>(exp))
+        return {eval(or_op->left).value || eval(or_op->right).value, ast::BuiltInType::BOOL};
+    if (auto cast = ast::cast<ast::Cast>(exp)) {
+        Value value = eval(cast->exp);
+        return {convert(value.value, value.type, cast->target_type->type), cast->target_type->type};
+    }
+    if (auto call_exp = ast::cast<ast::Call>(exp)) {
+        const Symbol &signature = functions.at(call_exp->func_id->value);
+        std::vector<Value> args;
+        for (auto &arg : call_exp->args->exps)
+            args.push_back(eval(arg));
+        if (!failure.empty())
+            return none;
+        Value result = call(call_exp->func_id->value, args);
+        return {convert(result.value, result.type, signature.type), signature.type};
+    }
+    return none;
+}
+
+CompileTimeEvaluator::Flow CompileTimeEvaluator::exec(const std::shared_ptr<ast::Statement> &statement) {
+    if (statement == nullptr)
+        return NEXT;
+    if (!step())
+        return RETURN;
+    if (auto statements = ast::cast<ast::Statements>(statement)) {
+        frames.back().scopes.emplace_back();
+        Flow flow = NEXT;
+        for (auto &inner : statements->statements) {
+            flow = exec(inner);
+            if (flow != NEXT)
+                break;
+        }
+        frames.back().scopes.pop_back();
+        return flow;
+    }
+    if (auto call_statement = ast::cast<ast::Call>(statement)) {
+        eval(call_statement);
+    } else if (ast::cast<ast::Break>(statement)) {
+        return BREAK;
+    } else if (ast::cast<ast::Continue>(statement)) {
+        return CONTINUE;
+    } else if (auto ret = ast::cast<ast::Return>(statement)) {
+        if (ret->exp != nullptr) {
+            Value value = eval(ret->exp);
+            frames.back().result.value = convert(value.value, value.type, frames.back().result.type);
+        }
+        return RETURN;
+    } else if (auto if_node = ast::cast<ast::If>(statement)) {
+        // Branches get their own scope even when they are a single declaration
+        bool condition = eval(if_node->condition).value;
+        frames.back().scopes.emplace_back();
+        Flow flow = exec(condition ? if_node->then : if_node->otherwise);
+        frames.back().scopes.pop_back();
+        return flow;
+    } else if (auto while_node = ast::cast<ast::While>(statement)) {
+        while (eval(while_node->condition).value && failure.empty()) {
+            frames.back().scopes.emplace_back();
+            Flow flow = exec(while_node->body);
+            frames.back().scopes.pop_back();
+            if (flow == BREAK)
+                break;
+            if (flow == RETURN)
+                return RETURN;
+        }
+    } else if (auto var_decl = ast::cast<ast::VarDecl>(statement)) {
+        ast::BuiltInType type = var_decl->type->type;
+        Value value = {0, type};
+        if (var_decl->init_exp != nullptr) {
+            Value init = eval(var_decl->init_exp);
+            value.value = convert(init.value, init.type, type);
+        }
+        frames.back().scopes.back()[var_decl->id->value] = value;
+    } else if (auto assign = ast::cast<ast::Assign>(statement)) {
+        Value value = eval(assign->exp);
+        Value &target = lookup(assign->id->value);
+        target.value = convert(value.value, value.type, target.type);
+    }
+    return failure.empty() ? NEXT : RETURN;
+}
+
+void CompileTimeEvaluator::printReport(std::ostream &os, const source::LineTable &lines) const {
+    os << "---compile-time evaluation report---" << std::endl;
+    for (auto &decision : decisions)
+        os << "line " << lines.line(decision.offset) << ": " << decision.call << (decision.evaluated ? " = " : " kept, ")
+           << decision.result << std::endl;
+    int evaluated = 0;
+    for (auto &decision : decisions)
+        evaluated += decision.evaluated;
+    os << pure.size() << " pure functions, " << evaluated << " of " << decisions.size()
+       << " constant calls evaluated in " << total_steps << " steps, " << branches_folded << " branches and "
+       << exps_folded << " expressions folded" << std::endl;
+}
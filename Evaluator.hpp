@@ -0,0 +1,92 @@
+#ifndef EVALUATOR_HPP
+#define EVALUATOR_HPP
+
+#include <iostream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "nodes.hpp"
+#include "SymbolTable.hpp"
+
+// Limits of the compile-time evaluator, set from the command line
+struct EvalOptions {
+    bool enabled;
+    int max_steps;  // statements and expressions evaluated per call site
+    int max_depth;  // nested calls during one evaluation
+
+    EvalOptions() : enabled(false), max_steps(100000), max_depth(200) {};
+};
+
+/* Evaluates calls to pure functions with constant arguments at compile time.
+ * A function is pure when neither it nor anything it calls, directly or transitively, prints.
+ * Such calls are run by an interpreter of the checked AST and replaced by their result, while
+ * the rest of the program is constant folded so results feed further folding. Evaluation gives
+ * up on a division by zero (which has to fail at runtime) or when it exceeds the step or depth
+ * limit, the call is then left as it is.
+ */
+class CompileTimeEvaluator {
+public:
+    CompileTimeEvaluator(const std::unordered_map<std::string, Symbol> &functions, const EvalOptions &options);
+
+    void run(ast::Funcs &program);
+
+    // lines locates the calls, see fanc::Result::lines
+    void printReport(std::ostream &os, const source::LineTable &lines) const;
+
+private:
+    struct Value {
+        int value;
+        ast::BuiltInType type;
+    };
+
+    enum Flow {
+        NEXT,
+        BREAK,
+        CONTINUE,
+        RETURN
+    };
+
+    struct Frame {
+        std::vector<std::unordered_map<std::string, Value>> scopes;
+        Value result;
+    };
+
+    struct Decision {
+        source::Offset offset;
+        std::string call;
+        bool evaluated;
+        std::string result;     // the value, or why the call was kept
+    };
+
+    const std::unordered_map<std::string, Symbol> &functions;
+    EvalOptions options;
+    std::unordered_map<std::string, std::shared_ptr<ast::FuncDecl>> bodies;
+    std::unordered_set<std::string> pure;
+    std::unordered_map<std::string, Value> memo;
+    std::unordered_map<std::string, std::string> failures;
+    std::vector<Decision> decisions;
+    std::vector<Frame> frames;
+    std::string failure;
+    int steps;
+    int total_steps;
+    int branches_folded;
+    int exps_folded;
+
+    void findPure(ast::Funcs &program);
+
+    bool evaluate(ast::Call &call, std::shared_ptr<ast::Exp> &result);
+
+    bool step();
+
+    Value call(const std::string &name, const std::vector<Value> &args);
+
+    Value eval(const std::shared_ptr<ast::Exp> &exp);
+
+    Flow exec(const std::shared_ptr<ast::Statement> &statement);
+
+    Value &lookup(const std::string &name);
+};
+
+#endif //EVALUATOR_HPP
@@ -0,0 +1,164 @@
+#include "IR.hpp"
+#include "Literals.hpp"
+
+namespace ir {
+
+    static const char *relOpToString(ast::RelOpType op) {
+        switch (op) {
+            case ast::RelOpType::EQ:
+                return "==";
+            case ast::RelOpType::NE:
+                return "!=";
+            case ast::RelOpType::LT:
+                return "<";
+            case ast::RelOpType::GT:
+                return ">";
+            case ast::RelOpType::LE:
+                return "<=";
+            case ast::RelOpType::GE:
+                return ">=";
+        }
+        return "?";
+    }
+
+    static std::string reg(const Function &func, int r) {
+        std::string result = "%" + std::to_string(r);
+        if (r >= 0 && r < (int) func.reg_names.size() && !func.reg_names[r].empty())
+            result += "(" + func.reg_names[r] + ")";
+        return result;
+    }
+
+    std::vector<int> Instr::uses() const {
+        std::vector<int> result;
+        switch (op) {
+            case COPY:
+            case CHECK_DIV:
+            case TRUNC:
+                result.push_back(a);
+                break;
+            case ADD:
+            case SUB:
+            case MUL:
+            case DIV:
+            case BRANCH:
+                result.push_back(a);
+                result.push_back(b);
+                break;
+            case CALL:
+                result = args;
+                break;
+            case RET:
+                if (a >= 0)
+                    result.push_back(a);
+                break;
+            default:
+                break;
+        }
+        return result;
+    }
+
+    int Function::newReg(ast::BuiltInType type, const std::string &name) {
+        reg_types.push_back(type);
+        reg_names.push_back(name);
+        return (int) reg_types.size() - 1;
+    }
+
+    ast::RelOpType negate(ast::RelOpType op) {
+        switch (op) {
+            case ast::RelOpType::EQ:
+                return ast::RelOpType::NE;
+            case ast::RelOpType::NE:
+                return ast::RelOpType::EQ;
+            case ast::RelOpType::LT:
+                return ast::RelOpType::GE;
+            case ast::RelOpType::GT:
+                return ast::RelOpType::LE;
+            case ast::RelOpType::LE:
+                return ast::RelOpType::GT;
+            case ast::RelOpType::GE:
+                return ast::RelOpType::LT;
+        }
+        return op;
+    }
+
+    CodeStats countCode(const Function &func) {
+        CodeStats stats;
+        for (auto &instr : func.code) {
+            if (instr.op == LABEL)
+                continue;
+            stats.instructions++;
+            if (instr.op == BRANCH)
+                stats.branches++;
+            else if (instr.op == JUMP)
+                stats.jumps++;
+            else if (instr.op == CHECK_DIV || instr.op == TRUNC)
+                stats.guards++;
+        }
+        return stats;
+    }
+
+    void print(const Function &func, const literals::Pool &literals, std::ostream &os) {
+        os << "function " << func.name << "(" << func.num_params << " params, " << func.reg_types.size()
+           << " registers)" << std::endl;
+        for (auto &instr : func.code) {
+            if (instr.op == LABEL) {
+                os << "L" << instr.imm << ":" << std::endl;
+                continue;
+            }
+            os << "    ";
+            switch (instr.op) {
+                case CONST:
+                    os << reg(func, instr.dst) << " = " << instr.imm;
+                    break;
+                case STR:
+                    os << reg(func, instr.dst) << " = " << literals.quoted(instr.imm);
+                    break;
+                case COPY:
+                    os << reg(func, instr.dst) << " = " << reg(func, instr.a);
+                    break;
+                case ADD:
+                case SUB:
+                case MUL:
+                case DIV:
+                    os << reg(func, instr.dst) << " = " << reg(func, instr.a) << " " << "+-*/"[instr.op - ADD]
+                       << " " << reg(func, instr.b);
+                    break;
+                case CHECK_DIV:
+                    os << "check_div " << reg(func, instr.a);
+                    break;
+                case TRUNC:
+                    os << reg(func, instr.dst) << " = trunc " << reg(func, instr.a);
+                    break;
+                case BRANCH:
+                    os << "if " << reg(func, instr.a) << " " << relOpToString(instr.cmp) << " "
+                       << reg(func, instr.b) << " goto L" << instr.target;
+                    break;
+                case JUMP:
+                    os << "goto L" << instr.target;
+                    break;
+                case CALL:
+                    if (instr.dst >= 0)
+                        os << reg(func, instr.dst) << " = ";
+                    os << "call " << instr.text << "(";
+                    for (size_t i = 0; i < instr.args.size(); i++)
+                        os << (i ? ", " : "") << reg(func, instr.args[i]);
+                    os << ")";
+                    break;
+                case RET:
+                    os << "ret";
+                    if (instr.a >= 0)
+                        os << " " << reg(func, instr.a);
+                    break;
+                default:
+                    break;
+            }
+            os << std::endl;
+        }
+    }
+
+    void print(const Module &module, const literals::Pool &literals, std::ostream &os) {
+        for (auto &func : module.functions)
+            print(func, literals, os);
+    }
+
+}
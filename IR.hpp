@@ -0,0 +1,99 @@
+#ifndef IR_HPP
+#define IR_HPP
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include "nodes.hpp"
+
+/* Three-address intermediate representation produced by CodeGen.
+ * Every value lives in a virtual register. Parameters arrive in registers 0..num_params-1,
+ * locals and temporaries get the following registers. Control flow is expressed with labels,
+ * conditional branches and jumps, so a backend only has to map registers and emit instructions.
+ */
+namespace ir {
+
+    enum Opcode {
+        CONST,      // dst = imm
+        STR,        // dst = address of the string literal imm, an index of the literal pool
+        COPY,       // dst = a
+        ADD,        // dst = a + b
+        SUB,        // dst = a - b
+        MUL,        // dst = a * b
+        DIV,        // dst = a / b
+        CHECK_DIV,  // runtime guard, aborts with a division by zero error if a == 0
+        TRUNC,      // runtime guard, dst = a truncated to the byte range, imm is 1 for int to byte conversions
+        BRANCH,     // if (a cmp b) goto target
+        JUMP,       // goto target
+        LABEL,      // jump target with id imm
+        CALL,       // dst = text(args...), dst is -1 when the result is not used
+        RET         // return a, a is -1 in void functions
+    };
+
+    class Instr {
+    public:
+        Opcode op;
+        int dst;
+        int a;
+        int b;
+        int imm;
+        ast::RelOpType cmp;
+        int target;     // label id of BRANCH and JUMP, -1 while still on a jump list
+        std::string text;
+        std::vector<int> args;
+        source::Offset offset;  // of the node the instruction comes from
+
+        Instr(Opcode op, source::Offset offset) : op(op), dst(-1), a(-1), b(-1), imm(0), cmp(ast::RelOpType::EQ),
+                                                  target(-1), offset(offset) {};
+
+        bool isBranch() const { return op == BRANCH || op == JUMP; }
+
+        // Registers read by the instruction
+        std::vector<int> uses() const;
+    };
+
+    class Function {
+    public:
+        std::string name;
+        ast::BuiltInType return_type;
+        int num_params;
+        int num_labels;
+        std::vector<ast::BuiltInType> reg_types;
+        std::vector<std::string> reg_names;     // variable name of each register, empty for temporaries
+        std::vector<Instr> code;
+
+        Function() : return_type(ast::BuiltInType::VOID), num_params(0), num_labels(0) {};
+
+        int newReg(ast::BuiltInType type, const std::string &name = "");
+
+        int newLabel() { return num_labels++; }
+    };
+
+    class Module {
+    public:
+        std::vector<Function> functions;
+    };
+
+    // Static instruction counts of a function, labels are not instructions
+    struct CodeStats {
+        int instructions;
+        int branches;
+        int jumps;
+        int guards;
+
+        CodeStats() : instructions(0), branches(0), jumps(0), guards(0) {};
+    };
+
+    CodeStats countCode(const Function &func);
+
+    // The comparison that holds exactly when op does not
+    ast::RelOpType negate(ast::RelOpType op);
+
+    // literals has the texts of the STR instructions, see fanc::Result::literals
+    void print(const Function &func, const literals::Pool &literals, std::ostream &os);
+
+    void print(const Module &module, const literals::Pool &literals, std::ostream &os);
+
+}
+
+#endif //IR_HPP
@@ -0,0 +1,187 @@
+#include "IncrementalCheck.hpp"
+#include "IncrementalParser.hpp"
+#include "AstUtils.hpp"
+#include "output.hpp"
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <random>
+#include <vector>
+
+namespace incremental {
+    // Every node of the program in visiting order, with its offset and value
+    static std::string fingerprint(IncrementalParser &parser) {
+        std::string text;
+        const literals::Pool &literals = parser.literals();
+        for (auto &func : parser.program()->funcs) {
+            ast::forEachNode(func, [&text, &literals](ast::Node &node) {
+                text += ast::kindName(node);
+                text += "@" + std::to_string(node.offset);
+                if (auto id = ast::cast<ast::ID>(&node))
+                    text += "=" + id->value;
+                else if (auto num = ast::cast<ast::Num>(&node))
+                    text += "=" + std::to_string(num->value);
+                else if (auto num_b = ast::cast<ast::NumB>(&node))
+                    text += "=" + std::to_string(num_b->value);
+                else if (auto str = ast::cast<ast::String>(&node))
+                    text += "=" + literals.quoted(str->literal);
+                else if (auto boolean = ast::cast<ast::Bool>(&node))
+                    text += boolean->value ? "=T" : "=F";
+                else if (auto bin_op = ast::cast<ast::BinOp>(&node))
+                    text += "=" + std::to_string(bin_op->op);
+                else if (auto rel_op = ast::cast<ast::RelOp>(&node))
+                    text += "=" + std::to_string(rel_op->op);
+                else if (auto type = ast::cast<ast::Type>(&node))
+                    text += "=" + std::to_string(type->type);
+                else if (auto statement = ast::cast<ast::Statement>(&node))
+                    text += statement->is_scope ? "{" : "";
+                text += " ";
+            });
+            text += "\n";
+        }
+        return text;
+    }
+
+    struct Edit {
+        size_t offset;
+        size_t length;
+        std::string text;
+    };
+
+    class EditMaker {
+    public:
+        explicit EditMaker(unsigned seed) : rng(seed), added(0) {}
+
+        Edit make(const std::string &source) {
+            size_t at = pick(source.size() + 1);
+            switch (pick(7)) {
+                case 0:
+                    return {at, 0, pick(2) ? " " : "\n"};
+                case 1:
+                    return {lineStart(source, at), 0, "// edited\n"};
+                case 2: {
+                    // Another digit, the program keeps its shape
+                    size_t digit = source.find_first_of("0123456789", at);
+                    if (digit == std::string::npos)
+                        break;
+                    return {digit, 1, std::string(1, (char) ('1' + pick(9)))};
+                }
+                case 3:
+                    return {at, std::min(source.size() - at, 1 + pick(4)), ""};
+                case 4: {
+                    size_t begin = lineStart(source, at);
+                    size_t end = source.find('\n', begin);
+                    end = end == std::string::npos ? source.size() : end + 1;
+                    return {begin, 0, source.substr(begin, end - begin)};
+                }
+                case 5: {
+                    // A new function in front of one that starts a line
+                    size_t func = functionStart(source, at);
+                    std::string name = "added" + std::to_string(added++);
+                    return {func, 0, "int " + name + "(int x) {\n    return x * " + std::to_string(pick(100)) + ";\n}\n"};
+                }
+                case 6: {
+                    size_t func = functionStart(source, at);
+                    size_t end = source.find("\n}\n", func);
+                    if (end == std::string::npos)
+                        break;
+                    return {func, end + 3 - func, ""};
+                }
+            }
+            return {at, 0, " "};
+        }
+
+    private:
+        std::mt19937 rng;
+        int added;
+
+        size_t pick(size_t n) {
+            return n == 0 ? 0 : rng() % n;
+        }
+
+        static size_t lineStart(const std::string &source, size_t at) {
+            if (at == 0)
+                return 0;
+            size_t newline = source.rfind('\n', at - 1);
+            return newline == std::string::npos ? 0 : newline + 1;
+        }
+
+        // The closest function start at or before at, 0 when there is none
+        static size_t functionStart(const std::string &source, size_t at) {
+            size_t end = source.rfind("\n}\n", at);
+            return end == std::string::npos ? 0 : end + 3;
+        }
+    };
+
+    static double median(std::vector<double> values) {
+        if (values.empty())
+            return 0;
+        std::sort(values.begin(), values.end());
+        return values[values.size() / 2];
+    }
+
+    // The AST of a full parse of text, false when it does not parse
+    static bool parseFully(const std::string &text, std::string &ast, std::vector<double> &full_ms) {
+        auto start = std::chrono::steady_clock::now();
+        try {
+            IncrementalParser fresh(text);
+            full_ms.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+            ast = fingerprint(fresh);
+            return true;
+        } catch (const output::CompileError &) {
+            return false;
+        }
+    }
+
+    int check(const std::string &text, int edits, unsigned seed, std::ostream &os) {
+        EditMaker maker(seed);
+        IncrementalParser parser(text);
+        std::vector<double> edit_ms, full_ms;
+        int mismatches = 0, errors = 0, full_reparses = 0;
+        bool broken = false;
+        Edit undo = {0, 0, ""};
+        for (int i = 0; i < edits; i++) {
+            Edit edit = broken ? undo : maker.make(parser.text());
+            undo = {edit.offset, edit.text.size(), parser.text().substr(edit.offset, edit.length)};
+            std::string before = parser.text();
+            bool edit_failed = false;
+            auto start = std::chrono::steady_clock::now();
+            try {
+                parser.edit(edit.offset, edit.length, edit.text);
+            } catch (const output::CompileError &) {
+                edit_failed = true;
+            }
+            edit_ms.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+            full_reparses += !edit_failed && parser.lastEdit().full_reparse;
+
+            std::string full;
+            bool full_failed = !parseFully(parser.text(), full, full_ms);
+            errors += full_failed;
+            // Once broken, the next edit puts the text back
+            broken = full_failed && !broken;
+            // Only every third edit looks at program(), so offset shifts pile up in between
+            if (!edit_failed && !full_failed && i % 3 != 2)
+                continue;
+
+            std::string incremental = fingerprint(parser);
+            const char *problem = nullptr;
+            if (edit_failed != full_failed)
+                problem = edit_failed ? "failed where the full parse did not" : "parsed where the full parse failed";
+            else if (!edit_failed && incremental != full)
+                problem = "gives another AST than the full parse";
+            else if (edit_failed && parseFully(before, full, full_ms) && incremental != full)
+                problem = "failed and did not keep the AST from before it";
+            if (problem != nullptr) {
+                mismatches++;
+                os << "edit " << i << ": replacing " << edit.length << " byte(s) at " << edit.offset << " with \""
+                   << edit.text << "\" " << problem << std::endl;
+            }
+        }
+        os << "---incremental parse check---" << std::endl;
+        os << edits << " edit(s), " << mismatches << " mismatch(es), " << errors << " syntax error(s), "
+           << full_reparses << " full reparse(s)" << std::endl;
+        os << std::fixed << std::setprecision(3) << "median edit " << median(edit_ms) << " ms, median full parse "
+           << median(full_ms) << " ms" << std::endl;
+        return mismatches;
+    }
+}
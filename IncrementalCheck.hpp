@@ -0,0 +1,21 @@
+#ifndef INCREMENTAL_CHECK_HPP
+#define INCREMENTAL_CHECK_HPP
+
+#include <iostream>
+#include <string>
+
+/* Randomised test of IncrementalParser, behind hw3 --incremental-check=N (make check).
+ * Applies N random edits to a program: spaces, comments, digits, deleted and duplicated lines,
+ * and functions added and removed. After each one, program() must equal the AST of a fresh
+ * IncrementalParser of the edited text, node for node with offsets and values. The edited text
+ * must fail to parse in both or in neither, and when it fails program() must still give the AST
+ * from before the edit. An edit that breaks the program is undone by the
+ * next one, so the parser is also checked on the way back from an error. The latency of the
+ * edits and of the full parses is reported next to each other.
+ */
+namespace incremental {
+    // Number of edits whose result differs from the full parse, each one is described on os
+    int check(const std::string &text, int edits, unsigned seed, std::ostream &os);
+}
+
+#endif //INCREMENTAL_CHECK_HPP
@@ -0,0 +1,164 @@
+#include "IncrementalParser.hpp"
+#include "AstUtils.hpp"
+#include "Compiler.hpp"
+#include "output.hpp"
+#include <algorithm>
+#include <cctype>
+
+// From the bison-generated parser and the flex-generated scanner
+extern int yyparse();
+extern std::shared_ptr<ast::Node> program;
+extern void scanBuffer(const char *buf, size_t len, source::Offset offset, source::LineTable *lines,
+                       literals::Pool *pool);
+extern void endScanBuffer();
+extern void releaseParserStacks();
+extern void setParserMaxDepth(long depth);
+
+IncrementalParser::IncrementalParser(const std::string &text) : source(text), last_edit({0, 0, false}) {
+    reparseAll();
+}
+
+bool IncrementalParser::split(size_t begin, size_t end, std::vector<Span> &out) const {
+    int depth = 0;
+    bool in_func = false;
+    Span span = {0, 0, 0};
+    size_t i = begin;
+    while (i < end) {
+        char c = source[i];
+        if (c == '/' && i + 1 < end && source[i + 1] == '/') {
+            while (i < end && source[i] != '\n' && source[i] != '\r')
+                i++;
+            continue;
+        }
+        if (isspace((unsigned char) c)) {
+            i++;
+            continue;
+        }
+        if (!in_func) {
+            in_func = true;
+            span.begin = i;
+        }
+        if (c == '"') {
+            // Braces inside string literals do not count, strings never span lines
+            for (i++; i < end && source[i] != '"' && source[i] != '\n'; i++)
+                if (source[i] == '\\')
+                    i++;
+            if (i >= end || source[i] != '"')
+                return false;
+        } else if (c == '{') {
+            depth++;
+        } else if (c == '}') {
+            if (--depth < 0)
+                return false;
+            if (depth == 0) {
+                span.end = i + 1;
+                out.push_back(span);
+                in_func = false;
+            }
+        }
+        i++;
+    }
+    return !in_func;
+}
+
+std::shared_ptr<ast::Funcs> IncrementalParser::parse(size_t begin, size_t end) {
+    // The scanner and parser are shared with fanc::compile, which batch and server workers call
+    std::lock_guard<std::mutex> lock(fanc::parse_mutex);
+    scanBuffer(source.data() + begin, end - begin, (source::Offset) begin, nullptr, &pool);
+    setParserMaxDepth(0);
+    try {
+        yyparse();
+    } catch (const output::CompileError &) {
+        endScanBuffer();
+        releaseParserStacks();
+        // The spans no longer describe the AST, the next edit parses the whole text. The AST
+        // from before the edit stays, located in the text it was parsed from
+        applyShifts();
+        spans.clear();
+        throw;
+    }
+    endScanBuffer();
+    releaseParserStacks();
+    auto parsed = ast::cast<ast::Funcs>(::program);
+    ::program = nullptr;
+    return parsed;
+}
+
+void IncrementalParser::reparseAll() {
+    // Until the new AST is there the old one is kept, with the shifts it is owed
+    applyShifts();
+    std::vector<Span> fresh;
+    bool balanced = split(0, source.size(), fresh);
+    funcs = parse(0, source.size());
+    // Without a span per function the next edit parses everything again
+    if (balanced && funcs->funcs.size() == fresh.size())
+        spans = std::move(fresh);
+    else
+        spans.clear();
+    last_edit = {(int) funcs->funcs.size(), source.size(), true};
+}
+
+void IncrementalParser::edit(size_t offset, size_t length, const std::string &text) {
+    size_t old_size = source.size();
+    long delta = (long) text.size() - (long) length;
+    source.replace(offset, length, text);
+    if (spans.empty() && !funcs->funcs.empty()) {
+        reparseAll();
+        return;
+    }
+
+    // Functions the edit touches, an edit right next to a function belongs to it
+    size_t first = 0;
+    while (first < spans.size() && spans[first].end < offset)
+        first++;
+    size_t last = first;
+    while (last < spans.size() && spans[last].begin <= offset + length)
+        last++;
+    // The region reaches from the previous untouched function to the next one, so it also covers edits between functions
+    size_t region_begin = first > 0 ? spans[first - 1].end : 0;
+    size_t region_end = last < spans.size() ? spans[last].begin : old_size;
+
+    std::vector<Span> fresh;
+    while (!split(region_begin, region_end + delta, fresh)) {
+        fresh.clear();
+        if (last == spans.size()) {
+            reparseAll();
+            return;
+        }
+        last++;
+        region_end = last < spans.size() ? spans[last].begin : old_size;
+    }
+    region_end += delta;
+    std::shared_ptr<ast::Funcs> parsed = std::make_shared<ast::Funcs>();
+    if (!fresh.empty())
+        parsed = parse(region_begin, region_end);
+    if (parsed->funcs.size() != fresh.size()) {
+        reparseAll();
+        return;
+    }
+
+    funcs->funcs.erase(funcs->funcs.begin() + first, funcs->funcs.begin() + last);
+    funcs->funcs.insert(funcs->funcs.begin() + first, parsed->funcs.begin(), parsed->funcs.end());
+    spans.erase(spans.begin() + first, spans.begin() + last);
+    spans.insert(spans.begin() + first, fresh.begin(), fresh.end());
+    for (size_t i = first + fresh.size(); i < spans.size(); i++) {
+        spans[i].begin += delta;
+        spans[i].end += delta;
+        spans[i].pending_shift += delta;
+    }
+    last_edit = {(int) fresh.size(), region_end - region_begin, false};
+}
+
+void IncrementalParser::applyShifts() {
+    for (size_t i = 0; i < spans.size(); i++) {
+        if (spans[i].pending_shift != 0) {
+            ast::shiftOffsets(funcs->funcs[i], spans[i].pending_shift);
+            spans[i].pending_shift = 0;
+        }
+    }
+}
+
+std::shared_ptr<ast::Funcs> IncrementalParser::program() {
+    applyShifts();
+    return funcs;
+}
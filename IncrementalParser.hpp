@@ -0,0 +1,72 @@
+#ifndef INCREMENTAL_PARSER_HPP
+#define INCREMENTAL_PARSER_HPP
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "nodes.hpp"
+#include "Source.hpp"
+
+/* Keeps the AST of a source text up to date while the text is edited.
+ * A program is a sequence of function declarations, so the text is split into the byte ranges
+ * of its top-level functions by matching braces (outside strings and comments). An edit only
+ * reparses the functions whose range it touches and splices the result into ast::Funcs. When
+ * the edited text no longer balances its braces, the range grows over the following functions
+ * until it does, or the whole text is reparsed.
+ * Functions after the edit keep their nodes, their offsets are shifted lazily: the shift is
+ * recorded per function and applied to the nodes the next time program() is called.
+ * A lexical or syntax error in the reparsed text is thrown as output::CompileError, program()
+ * keeps returning the AST from before the edit and the next edit reparses the whole text.
+ * The error and the nodes are located in the whole text, lines() gives their line and column.
+ * Parses take fanc::parse_mutex, the scanner and parser are shared with fanc::compile.
+ * hw3 --incremental-check (make check) compares its results with full parses, see IncrementalCheck.hpp.
+ */
+class IncrementalParser {
+public:
+    struct EditStats {
+        int reparsed_functions;
+        size_t reparsed_bytes;
+        bool full_reparse;
+    };
+
+    explicit IncrementalParser(const std::string &text);
+
+    // Replaces length bytes at offset with text and reparses the affected functions, throws output::CompileError
+    void edit(size_t offset, size_t length, const std::string &text);
+
+    std::shared_ptr<ast::Funcs> program();
+
+    const std::string &text() const { return source; }
+
+    source::LineTable lines() const { return source::LineTable::of(source); }
+
+    const EditStats &lastEdit() const { return last_edit; }
+
+    // The string literals of program(), kept across edits
+    const literals::Pool &literals() const { return pool; }
+
+private:
+    struct Span {
+        size_t begin;
+        size_t end;
+        long pending_shift; // bytes not yet applied to the nodes of the function
+    };
+
+    std::string source;
+    std::shared_ptr<ast::Funcs> funcs;
+    literals::Pool pool;
+    std::vector<Span> spans;
+    EditStats last_edit;
+
+    // Splits [begin, end) into top-level function spans, false if the braces do not balance
+    bool split(size_t begin, size_t end, std::vector<Span> &out) const;
+
+    std::shared_ptr<ast::Funcs> parse(size_t begin, size_t end);
+
+    void reparseAll();
+
+    // Moves the nodes of every function by the shift recorded in its span
+    void applyShifts();
+};
+
+#endif //INCREMENTAL_PARSER_HPP
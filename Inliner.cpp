@@ -0,0 +1,310 @@
+#include "Inliner.hpp"
+#include "AstUtils.hpp"
+#include <iomanip>
+
+// Returns true if a return statement appears anywhere below a while loop
+static bool hasReturnInLoop(const std::shared_ptr<ast::Statement> &statement, bool in_loop) {
+    if (statement == nullptr)
+        return false;
+    if (ast::cast<ast::Return>(statement))
+        return in_loop;
+    if (auto block = ast::cast<ast::Statements>(statement)) {
+        for (auto &inner : block->statements)
+            if (hasReturnInLoop(inner, in_loop))
+                return true;
+    } else if (auto if_node = ast::cast<ast::If>(statement)) {
+        return hasReturnInLoop(if_node->then, in_loop) || hasReturnInLoop(if_node->otherwise, in_loop);
+    } else if (auto while_node = ast::cast<ast::While>(statement)) {
+        return hasReturnInLoop(while_node->body, true);
+    }
+    return false;
+}
+
+// Returns true if the body returns anywhere other than in its last top-level statement
+static bool hasEarlyReturn(const std::shared_ptr<ast::Statement> &statement, bool is_last) {
+    if (statement == nullptr)
+        return false;
+    if (ast::cast<ast::Return>(statement))
+        return !is_last;
+    if (auto block = ast::cast<ast::Statements>(statement)) {
+        for (size_t i = 0; i < block->statements.size(); i++)
+            if (hasEarlyReturn(block->statements[i], is_last && i + 1 == block->statements.size()))
+                return true;
+    } else if (auto if_node = ast::cast<ast::If>(statement)) {
+        return hasEarlyReturn(if_node->then, false) || hasEarlyReturn(if_node->otherwise, false);
+    } else if (auto while_node = ast::cast<ast::While>(statement)) {
+        return hasEarlyReturn(while_node->body, false);
+    }
+    return false;
+}
+
+// Replaces every return of an inlined body by an assignment to target followed by a break
+// (or by the assignment alone for the final return when there are no early returns)
+static std::shared_ptr<ast::Statement> lowerReturns(const std::shared_ptr<ast::Statement> &statement,
+                                                    const std::string &target, bool with_break) {
+    if (statement == nullptr)
+        return nullptr;
+    if (auto ret = ast::cast<ast::Return>(statement)) {
+        auto block = std::make_shared<ast::Statements>();
+        block->offset = ret->offset;
+        if (ret->exp != nullptr) {
+            auto assign = std::make_shared<ast::Assign>(ast::makeId(target, ret->offset), ret->exp);
+            assign->offset = ret->offset;
+            block->push_back(assign);
+        }
+        if (with_break) {
+            auto brk = std::make_shared<ast::Break>();
+            brk->offset = ret->offset;
+            block->push_back(brk);
+        }
+        return block;
+    }
+    if (auto block = ast::cast<ast::Statements>(statement)) {
+        for (auto &inner : block->statements)
+            inner = lowerReturns(inner, target, with_break);
+    } else if (auto if_node = ast::cast<ast::If>(statement)) {
+        if_node->then = lowerReturns(if_node->then, target, with_break);
+        if_node->otherwise = lowerReturns(if_node->otherwise, target, with_break);
+    }
+    return statement;
+}
+
+Inliner::Inliner(const std::unordered_map<std::string, Symbol> &functions, const InlineOptions &options)
+        : functions(functions), options(options), size_before(0), size_current(0), size_limit(0), inline_count(0) {}
+
+void Inliner::run(ast::Funcs &program) {
+    for (auto &func : program.funcs) {
+        bodies[func->id->value] = func;
+        callee_sizes[func->id->value] = ast::countNodes(func->body);
+        ast::forEachCall(func->body, [this](ast::Call &call) { call_sites[call.func_id->value]++; });
+    }
+    for (auto &func : program.funcs)
+        size_before += ast::countNodes(func);
+    size_current = size_before;
+    size_limit = size_before + size_before * options.max_growth_percent / 100;
+
+    for (auto &func : program.funcs) {
+        caller = func->id->value;
+        int inlined_before = inline_count;
+        rewriteBlock(*func->body);
+        // Later callers copy the rewritten body, so its size has to include what was inlined into it
+        if (inline_count != inlined_before)
+            callee_sizes[caller] = ast::countNodes(func->body);
+    }
+
+    // Functions whose every call site was inlined are no longer needed
+    std::unordered_map<std::string, int> remaining;
+    for (auto &func : program.funcs)
+        ast::forEachCall(func->body, [&remaining](ast::Call &call) { remaining[call.func_id->value]++; });
+    std::vector<std::shared_ptr<ast::FuncDecl>> kept;
+    for (auto &func : program.funcs) {
+        const std::string &name = func->id->value;
+        if (name != "main" && call_sites[name] > 0 && remaining[name] == 0) {
+            removed.push_back(name);
+            size_current -= ast::countNodes(func);
+        } else {
+            kept.push_back(func);
+        }
+    }
+    program.funcs = kept;
+}
+
+void Inliner::rewriteBlock(ast::Statements &block) {
+    std::vector<std::shared_ptr<ast::Statement>> rewritten;
+    for (auto &statement : block.statements) {
+        if (ast::cast<ast::Statements>(statement) || ast::cast<ast::If>(statement) ||
+            ast::cast<ast::While>(statement))
+            rewritten.push_back(rewriteNested(statement));
+        else if (!expandStatement(statement, rewritten))
+            rewritten.push_back(statement);
+    }
+    block.statements = rewritten;
+}
+
+// Rewrites call sites below a statement that did not get expanded itself
+std::shared_ptr<ast::Statement> Inliner::rewriteNested(const std::shared_ptr<ast::Statement> &statement) {
+    if (auto block = ast::cast<ast::Statements>(statement)) {
+        rewriteBlock(*block);
+    } else if (auto if_node = ast::cast<ast::If>(statement)) {
+        skipCallsIn(if_node->condition, "call inside a condition");
+        if_node->then = rewriteNested(if_node->then);
+        if (if_node->otherwise != nullptr)
+            if_node->otherwise = rewriteNested(if_node->otherwise);
+    } else if (auto while_node = ast::cast<ast::While>(statement)) {
+        skipCallsIn(while_node->condition, "call inside a condition");
+        while_node->body = rewriteNested(while_node->body);
+    } else {
+        // The statement stands alone below an if/while, so a multi-statement expansion gets its own scope
+        std::vector<std::shared_ptr<ast::Statement>> expansion;
+        if (expandStatement(statement, expansion)) {
+            auto block = std::make_shared<ast::Statements>();
+            block->offset = statement->offset;
+            block->is_scope = true;
+            block->statements = expansion;
+            return block;
+        }
+    }
+    return statement;
+}
+
+bool Inliner::expandStatement(const std::shared_ptr<ast::Statement> &statement,
+                              std::vector<std::shared_ptr<ast::Statement>> &expansion) {
+    std::shared_ptr<ast::Call> call = ast::cast<ast::Call>(statement);
+    std::string target;
+    std::shared_ptr<ast::VarDecl> var_decl = ast::cast<ast::VarDecl>(statement);
+    std::shared_ptr<ast::Assign> assign = ast::cast<ast::Assign>(statement);
+    std::shared_ptr<ast::Return> ret = ast::cast<ast::Return>(statement);
+
+    if (var_decl != nullptr) {
+        call = ast::cast<ast::Call>(var_decl->init_exp);
+        target = var_decl->id->value;
+    } else if (assign != nullptr) {
+        call = ast::cast<ast::Call>(assign->exp);
+        target = assign->id->value;
+    } else if (ret != nullptr) {
+        call = ast::cast<ast::Call>(ret->exp);
+        target = "inl" + std::to_string(inline_count) + "$result";
+    }
+    if (call == nullptr) {
+        skipCallsIn(statement, "call inside an expression");
+        return false;
+    }
+
+    for (auto &arg : call->args->exps)
+        skipCallsIn(arg, "call inside an expression");
+    if (!canInline(*call))
+        return false;
+
+    if (var_decl) {
+        auto declaration = std::make_shared<ast::VarDecl>(var_decl->id, var_decl->type);
+        declaration->offset = var_decl->offset;
+        expansion.push_back(declaration);
+    } else if (ret) {
+        auto result_type = functions.at(call->func_id->value).type;
+        auto declaration = std::make_shared<ast::VarDecl>(ast::makeId(target, ret->offset),
+                                                          ast::makeType(result_type, ret->offset));
+        declaration->offset = ret->offset;
+        expansion.push_back(declaration);
+    }
+    expandCall(*call, target, expansion);
+    if (ret) {
+        auto new_ret = std::make_shared<ast::Return>(ast::makeId(target, ret->offset));
+        new_ret->offset = ret->offset;
+        expansion.push_back(new_ret);
+    }
+    return true;
+}
+
+bool Inliner::canInline(ast::Call &call) {
+    const std::string &callee = call.func_id->value;
+    auto body = bodies.find(callee);
+    if (body == bodies.end())
+        return false;   // print and printi are implemented by the runtime
+    if (callee == "main") {
+        record(call, false, "main is never inlined");
+        return false;
+    }
+    if (callee == caller) {
+        record(call, false, "recursive call");
+        return false;
+    }
+    bool self_recursive = false;
+    ast::forEachCall(body->second->body, [&](ast::Call &inner) { self_recursive |= inner.func_id->value == callee; });
+    if (self_recursive) {
+        record(call, false, "callee is recursive");
+        return false;
+    }
+    if (hasReturnInLoop(body->second->body, false)) {
+        record(call, false, "callee returns from inside a loop");
+        return false;
+    }
+    int size = callee_sizes[callee];
+    bool small = size <= options.max_callee_size;
+    bool single = options.single_call_site && call_sites[callee] == 1;
+    if (!small && !single) {
+        record(call, false, "callee too large (" + std::to_string(size) + " > " +
+                            std::to_string(options.max_callee_size) + " nodes)");
+        return false;
+    }
+    if (size_current + size > size_limit) {
+        record(call, false, "growth budget exhausted");
+        return false;
+    }
+    size_current += size;
+    record(call, true, small ? "small callee (" + std::to_string(size) + " nodes)" : "single call site");
+    return true;
+}
+
+void Inliner::expandCall(ast::Call &call, const std::string &target, std::vector<std::shared_ptr<ast::Statement>> &out) {
+    auto &callee = bodies[call.func_id->value];
+    const Symbol &signature = functions.at(call.func_id->value);
+    std::string prefix = "inl" + std::to_string(inline_count++) + "$";
+    source::Offset offset = call.offset;
+
+    // Parameter slots of the callee become fresh locals of the caller, all callee locals are renamed
+    ast::RenameMap renames;
+    for (auto &formal : callee->formals->formals)
+        renames[formal->id->value] = prefix + formal->id->value;
+    ast::forEachVarDecl(callee->body, [&](ast::VarDecl &decl) { renames[decl.id->value] = prefix + decl.id->value; });
+
+    for (size_t i = 0; i < callee->formals->formals.size(); i++) {
+        auto &formal = callee->formals->formals[i];
+        auto param = std::make_shared<ast::VarDecl>(ast::makeId(renames[formal->id->value], offset),
+                                                    ast::makeType(signature.params->types[i], offset),
+                                                    call.args->exps[i]);
+        param->offset = offset;
+        out.push_back(param);
+    }
+
+    std::string result = target;
+    if (result.empty() && signature.type != ast::BuiltInType::VOID) {
+        // The returned value is discarded, but its expression may still have side effects
+        result = prefix + "result";
+        auto declaration = std::make_shared<ast::VarDecl>(ast::makeId(result, offset), ast::makeType(signature.type, offset));
+        declaration->offset = offset;
+        out.push_back(declaration);
+    }
+
+    auto body = ast::cast<ast::Statements>(ast::cloneStatement(callee->body, renames));
+    if (hasEarlyReturn(body, true)) {
+        auto brk = std::make_shared<ast::Break>();
+        brk->offset = offset;
+        body = ast::cast<ast::Statements>(lowerReturns(body, result, true));
+        body->push_back(brk);
+        body->is_scope = true;
+        auto condition = std::make_shared<ast::Bool>(true);
+        condition->offset = offset;
+        auto once = std::make_shared<ast::While>(condition, body);
+        once->offset = offset;
+        out.push_back(once);
+    } else {
+        body = ast::cast<ast::Statements>(lowerReturns(body, result, false));
+        for (auto &statement : body->statements)
+            out.push_back(statement);
+    }
+}
+
+void Inliner::skipCallsIn(const std::shared_ptr<ast::Node> &node, const std::string &reason) {
+    ast::forEachCall(node, [&](ast::Call &call) {
+        if (bodies.count(call.func_id->value))
+            record(call, false, reason);
+    });
+}
+
+void Inliner::record(ast::Call &call, bool inlined, const std::string &reason) {
+    decisions.push_back({caller, call.func_id->value, call.offset, inlined, reason});
+}
+
+void Inliner::printReport(std::ostream &os, const source::LineTable &lines) const {
+    os << "---inline report---" << std::endl;
+    for (auto &decision : decisions) {
+        os << "line " << lines.line(decision.offset) << ": " << decision.callee << " into " << decision.caller << ": "
+           << (decision.inlined ? "inlined, " : "kept, ") << decision.reason << std::endl;
+    }
+    for (auto &name : removed)
+        os << "removed " << name << ": every call site was inlined" << std::endl;
+    double growth = size_before == 0 ? 0 : 100.0 * (size_current - size_before) / size_before;
+    os << inline_count << " of " << decisions.size() << " call sites inlined, size " << size_before << " -> "
+       << size_current << " nodes (" << std::showpos << std::fixed << std::setprecision(1) << growth << "%)"
+       << std::noshowpos << std::endl;
+}
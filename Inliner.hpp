@@ -0,0 +1,75 @@
+#ifndef INLINER_HPP
+#define INLINER_HPP
+
+#include <iostream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "nodes.hpp"
+#include "SymbolTable.hpp"
+
+// Cost thresholds of the inliner, set from the command line
+struct InlineOptions {
+    bool enabled;
+    int max_callee_size;     // callees with at most this many AST nodes are always inlined
+    bool single_call_site;   // callees called from exactly one place are inlined regardless of size
+    int max_growth_percent;  // the program may grow at most this much over its original size
+
+    InlineOptions() : enabled(false), max_callee_size(16), single_call_site(true), max_growth_percent(50) {};
+};
+
+/* Inlines small and single-call-site functions into their callers.
+ * Runs on the AST after semantic analysis, so the program is known to be well typed.
+ * Call sites are inlined when the call is a whole statement: `f(...);`, `T x = f(...);`,
+ * `x = f(...);` or `return f(...);`. Parameters become fresh locals of the caller and
+ * early returns become a break out of a one-iteration while loop.
+ */
+class Inliner {
+public:
+    Inliner(const std::unordered_map<std::string, Symbol> &functions, const InlineOptions &options);
+
+    void run(ast::Funcs &program);
+
+    // lines locates the calls, see fanc::Result::lines
+    void printReport(std::ostream &os, const source::LineTable &lines) const;
+
+private:
+    struct Decision {
+        std::string caller;
+        std::string callee;
+        source::Offset offset;
+        bool inlined;
+        std::string reason;
+    };
+
+    const std::unordered_map<std::string, Symbol> &functions;
+    InlineOptions options;
+    std::unordered_map<std::string, std::shared_ptr<ast::FuncDecl>> bodies;
+    std::unordered_map<std::string, int> call_sites;
+    std::unordered_map<std::string, int> callee_sizes;
+    std::vector<Decision> decisions;
+    std::vector<std::string> removed;
+    std::string caller;
+    int size_before;
+    int size_current;
+    int size_limit;
+    int inline_count;
+
+    void rewriteBlock(ast::Statements &block);
+
+    std::shared_ptr<ast::Statement> rewriteNested(const std::shared_ptr<ast::Statement> &statement);
+
+    bool expandStatement(const std::shared_ptr<ast::Statement> &statement,
+                         std::vector<std::shared_ptr<ast::Statement>> &expansion);
+
+    bool canInline(ast::Call &call);
+
+    void expandCall(ast::Call &call, const std::string &target, std::vector<std::shared_ptr<ast::Statement>> &out);
+
+    void skipCallsIn(const std::shared_ptr<ast::Node> &node, const std::string &reason);
+
+    void record(ast::Call &call, bool inlined, const std::string &reason);
+};
+
+#endif //INLINER_HPP
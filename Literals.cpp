@@ -0,0 +1,81 @@
+#include "Literals.hpp"
+#include "Memory.hpp"
+
+namespace literals {
+    static int hexDigit(char c) {
+        if (c >= '0' && c <= '9')
+            return c - '0';
+        if (c >= 'a' && c <= 'f')
+            return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F')
+            return c - 'A' + 10;
+        return -1;
+    }
+
+    std::string decode(const char *text, size_t length) {
+        std::string decoded;
+        decoded.reserve(length);
+        for (size_t i = 0; i < length; i++) {
+            if (text[i] != '\\' || i + 1 == length) {
+                decoded += text[i];
+                continue;
+            }
+            switch (text[i + 1]) {
+                case '\\': decoded += '\\'; break;
+                case '"': decoded += '"'; break;
+                case 'n': decoded += '\n'; break;
+                case 'r': decoded += '\r'; break;
+                case 't': decoded += '\t'; break;
+                case '0': decoded += '\0'; break;
+                case 'x':
+                    if (i + 3 < length && hexDigit(text[i + 2]) >= 0 && hexDigit(text[i + 3]) >= 0) {
+                        decoded += (char) (hexDigit(text[i + 2]) * 16 + hexDigit(text[i + 3]));
+                        i += 2;
+                        break;
+                    }
+                    // Not a hex escape, kept as it is
+                default:
+                    decoded += '\\';
+                    decoded += text[i + 1];
+            }
+            i++;
+        }
+        return decoded;
+    }
+
+    Index Pool::intern(const std::string &text) {
+        MEMORY_TAG(memory::category("literals"));
+        auto found = indexes.find(text);
+        if (found != indexes.end())
+            return found->second;
+        Index index = count();
+        texts.push_back(text);
+        indexes.emplace(std::string_view(texts.back()), index);
+        text_bytes += text.size();
+        return index;
+    }
+
+    std::string Pool::quoted(Index index) const {
+        static const char *HEX = "0123456789abcdef";
+        std::string out = "\"";
+        for (unsigned char c : text(index)) {
+            switch (c) {
+                case '\\': out += "\\\\"; break;
+                case '"': out += "\\\""; break;
+                case '\n': out += "\\n"; break;
+                case '\r': out += "\\r"; break;
+                case '\t': out += "\\t"; break;
+                case '\0': out += "\\0"; break;
+                default:
+                    if (c >= 0x20 && c < 0x7f) {
+                        out += (char) c;
+                    } else {
+                        out += "\\x";
+                        out += HEX[c >> 4];
+                        out += HEX[c & 0xf];
+                    }
+            }
+        }
+        return out + "\"";
+    }
+}
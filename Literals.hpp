@@ -0,0 +1,55 @@
+#ifndef LITERALS_HPP
+#define LITERALS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+/* The string literals of a program, each stored once.
+ * The scanner decodes the escapes of a STRING token and interns the text in the pool of the
+ * compile (fanc::Result::literals), ast::String keeps the index it gets. Equal literals get the
+ * same index however often they appear, so a backend emits every index once as read-only data
+ * and refers to it from each use (ir::STR). A pool lives as long as the program it belongs to,
+ * a server or batch run does not accumulate the literals of earlier requests. Like the rest of a
+ * compile, a pool is used by one thread at a time.
+ */
+namespace literals {
+    typedef uint32_t Index;
+
+    // Text of a literal without its quotes, with \\ \" \n \r \t \0 and \xHH decoded. Any other
+    // backslash is kept as it is
+    std::string decode(const char *text, size_t length);
+
+    class Pool {
+    public:
+        Pool() : text_bytes(0) {};
+
+        Pool(const Pool &) = delete;
+        Pool &operator=(const Pool &) = delete;
+
+        Index intern(const std::string &text);
+
+        // The decoded text of index
+        const std::string &text(Index index) const { return texts[index]; }
+
+        // Number of distinct literals, they are 0..count()-1
+        Index count() const { return (Index) texts.size(); }
+
+        // Bytes of their texts
+        size_t bytes() const { return text_bytes; }
+
+        // text(index) between quotes, escaped again so it prints on one line
+        std::string quoted(Index index) const;
+
+    private:
+        // A deque never moves its elements, the views of indexes point into it
+        std::deque<std::string> texts;
+        std::unordered_map<std::string_view, Index> indexes;
+        size_t text_bytes;
+    };
+}
+
+#endif //LITERALS_HPP
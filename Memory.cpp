@@ -0,0 +1,75 @@
+#include "Memory.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <cxxabi.h>
+#include <mutex>
+
+namespace memory {
+    static const size_t NAME_SIZE = 48;
+
+    // Fixed storage, registering a category must not allocate while operator new counts
+    static char names[MAX_CATEGORIES][NAME_SIZE] = {"other", "free variables", "scopes", "output"};
+    static std::atomic<int> registered(FIXED_CATEGORIES);
+    static std::mutex registry_mutex;
+
+    thread_local int current = OTHER;
+    static thread_local Usage usages[MAX_CATEGORIES];
+
+    int category(const char *name) {
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        int count = registered.load(std::memory_order_relaxed);
+        for (int i = 0; i < count; i++)
+            if (strncmp(names[i], name, NAME_SIZE - 1) == 0)
+                return i;
+        if (count == MAX_CATEGORIES)
+            return OTHER;
+        strncpy(names[count], name, NAME_SIZE - 1);
+        registered.store(count + 1, std::memory_order_release);
+        return count;
+    }
+
+    int category(const std::type_info &type) {
+        int status;
+        // __cxa_demangle uses malloc, not operator new
+        char *demangled = abi::__cxa_demangle(type.name(), nullptr, nullptr, &status);
+        int id = category(status == 0 ? demangled : type.name());
+        free(demangled);
+        return id;
+    }
+
+    const char *name(int category) {
+        return category >= 0 && category < registered.load(std::memory_order_acquire) ? names[category] : "?";
+    }
+
+    std::vector<Usage> usage() {
+        Usage copy[MAX_CATEGORIES];
+        int count = registered.load(std::memory_order_acquire);
+        std::copy(usages, usages + count, copy);
+        // Taken before the vector allocates, so the copy does not count itself
+        return std::vector<Usage>(copy, copy + count);
+    }
+
+    void reset() {
+        for (Usage &own : usages) {
+            own.peak_bytes = own.live_bytes;
+            own.allocations = 0;
+        }
+    }
+
+    void allocated(int category, long bytes) {
+        Usage &own = usages[category];
+        own.live_bytes += bytes;
+        own.live_blocks++;
+        own.allocations++;
+        if (own.live_bytes > own.peak_bytes)
+            own.peak_bytes = own.live_bytes;
+    }
+
+    void freed(int category, long bytes) {
+        Usage &own = usages[category];
+        own.live_bytes -= bytes;
+        own.live_blocks--;
+    }
+}
@@ -0,0 +1,97 @@
+#ifndef MEMORY_HPP
+#define MEMORY_HPP
+
+#include <memory>
+#include <typeinfo>
+#include <utility>
+#include <vector>
+
+/* Memory accounting by category behind hw3 --stats, in builds with FANC_MEMSTATS (make MEMSTATS=1).
+ * operator new (Allocator.cpp, hw3 only) puts a 16 byte header in front of every block with its size and the category
+ * of the innermost Tag on the allocating thread, operator delete takes the block off that
+ * category again. AST nodes are tagged with their class by memory::make, which the parser
+ * uses instead of std::make_shared, so a node's category also holds what its constructor
+ * allocates (names, child vectors). Free-variable sets, scopes with their symbols and the
+ * scope output buffers are tagged where they are filled, everything else counts as "other".
+ * Usage is per thread like the stats counters, a block freed by another thread than the
+ * one that allocated it is subtracted from the freeing thread.
+ * Without FANC_MEMSTATS there are no headers, MEMORY_TAG expands to nothing and make is
+ * std::make_shared.
+ */
+namespace memory {
+    enum Category {
+        OTHER,
+        FREE_VARIABLES,  // exp_symbols and the condition symbols copied into scopes
+        SCOPES,          // Scope and Symbol storage
+        OUTPUT,          // ScopePrinter buffers and the printed scopes
+        FIXED_CATEGORIES
+    };
+
+    // Categories registered past this share "other"
+    const int MAX_CATEGORIES = 64;
+
+    struct Usage {
+        long live_bytes;
+        long peak_bytes;
+        long live_blocks;
+        long allocations;
+    };
+
+    extern thread_local int current;
+
+    // Id of a category by name, registered on first use
+    int category(const char *name);
+
+    // The category of a class, named after it
+    int category(const std::type_info &type);
+
+    template<typename T>
+    int category() {
+        static const int id = category(typeid(T));
+        return id;
+    }
+
+    const char *name(int category);
+
+    // Usage of the calling thread, indexed by category
+    std::vector<Usage> usage();
+
+    // Starts the peaks and allocation counts of the calling thread over, live blocks stay
+    void reset();
+
+    // Called by operator new and delete
+    void allocated(int category, long bytes);
+
+    void freed(int category, long bytes);
+
+    // Allocations of the calling thread go to a category from construction to destruction
+    class Tag {
+    public:
+        explicit Tag(int category) : previous(current) {
+            current = category;
+        }
+
+        ~Tag() {
+            current = previous;
+        }
+
+    private:
+        int previous;
+    };
+
+    template<typename T, typename... Args>
+    std::shared_ptr<T> make(Args &&... args) {
+#ifdef FANC_MEMSTATS
+        Tag tag(category<T>());
+#endif
+        return std::make_shared<T>(std::forward<Args>(args)...);
+    }
+}
+
+#ifdef FANC_MEMSTATS
+#define MEMORY_TAG(category) memory::Tag memory_tag(category)
+#else
+#define MEMORY_TAG(category) ((void) 0)
+#endif
+
+#endif //MEMORY_HPP
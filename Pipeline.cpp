@@ -0,0 +1,119 @@
+#include "Pipeline.hpp"
+#include "SpscRing.hpp"
+#include "Trace.hpp"
+#include "parser.tab.h"
+#include <atomic>
+#include <exception>
+#include <new>
+#include <thread>
+
+// From the flex-generated scanner and the bison-generated parser
+extern int yylex();
+extern YYSTYPE yylval;
+extern YYLTYPE yylloc;
+extern std::function<void(const std::shared_ptr<ast::FuncDecl> &)> function_parsed;
+extern void cancelScanStream();
+
+namespace pipeline {
+    static const size_t TOKEN_SLOTS = 4096;
+    static const size_t FUNCTION_SLOTS = 256;
+    // Kind of the token that stands for an exception thrown by the scanner
+    static const int LEX_ERROR = -1;
+
+    struct Token {
+        int kind;
+        YYLTYPE offset;
+        YYSTYPE value;
+    };
+
+    void parse(const std::function<void(const std::shared_ptr<ast::FuncDecl> &)> &declare, stats::Report *report) {
+        SpscRing<Token> tokens(TOKEN_SLOTS);
+        SpscRing<std::shared_ptr<ast::FuncDecl>> functions(FUNCTION_SLOTS);
+        // Set when the parser stopped early, the lexer must not wait for room then
+        std::atomic<bool> cancelled(false);
+        std::exception_ptr lex_error;
+        std::exception_ptr parse_error;
+        stats::Counters lexer_counters;
+        stats::Counters parser_counters;
+
+        // Never cancelled, the calling thread takes functions until the end marker
+        function_parsed = [&functions](const std::shared_ptr<ast::FuncDecl> &func) {
+            std::shared_ptr<ast::FuncDecl> copy = func;
+            functions.push(std::move(copy));
+        };
+
+        std::thread lexer([&tokens, &cancelled, &lex_error, &lexer_counters, report] {
+            trace::nameThread("lexer");
+            {
+                stats::PhaseTimer timer(report, stats::LEX);
+                trace::Span span("phase", "lex");
+                Token token;
+                bool more = true;
+                // Stopping between tokens spares reading the rest of a stream nobody parses
+                while (more && !cancelled.load(std::memory_order_relaxed)) {
+                    STATS_COUNT(tokens);
+                    try {
+                        token.kind = yylex();
+                        token.value = std::move(yylval);
+                    } catch (...) {
+                        lex_error = std::current_exception();
+                        token.kind = LEX_ERROR;
+                    }
+                    token.offset = yylloc;
+                    more = token.kind > 0;
+                    if (!tokens.push(std::move(token), &cancelled))
+                        break;
+                }
+            }
+            lexer_counters = stats::counters;
+        });
+
+        std::thread parser([&tokens, &cancelled, &lex_error, &parse_error, &parser_counters, &functions, report] {
+            trace::nameThread("parser");
+            yypstate *state = yypstate_new();
+            try {
+                if (state == nullptr)
+                    throw std::bad_alloc();
+                stats::PhaseTimer timer(report, stats::PARSE);
+                trace::Span span("phase", "parse");
+                Token token;
+                int status = YYPUSH_MORE;
+                while (status == YYPUSH_MORE) {
+                    tokens.pop(token);
+                    if (token.kind == LEX_ERROR)
+                        std::rethrow_exception(lex_error);
+                    status = yypush_parse(state, token.kind, &token.value, &token.offset);
+                }
+            } catch (...) {
+                parse_error = std::current_exception();
+                cancelled.store(true, std::memory_order_relaxed);
+                // The lexer may be waiting for input of a stream, the rest of it is not needed
+                cancelScanStream();
+            }
+            yypstate_delete(state);
+            functions.push(nullptr);
+            parser_counters = stats::counters;
+        });
+
+        // The functions are drained to the end even after an error, so the parser can finish
+        std::exception_ptr declare_error;
+        std::shared_ptr<ast::FuncDecl> func;
+        for (functions.pop(func); func != nullptr; functions.pop(func)) {
+            if (!declare || declare_error != nullptr)
+                continue;
+            try {
+                declare(func);
+            } catch (...) {
+                declare_error = std::current_exception();
+            }
+        }
+        parser.join();
+        lexer.join();
+        stats::merge(lexer_counters);
+        stats::merge(parser_counters);
+        if (parse_error != nullptr)
+            std::rethrow_exception(parse_error);
+        if (declare_error != nullptr)
+            std::rethrow_exception(declare_error);
+    }
+}
@@ -0,0 +1,28 @@
+#ifndef PIPELINE_HPP
+#define PIPELINE_HPP
+
+#include <functional>
+#include <memory>
+#include "nodes.hpp"
+#include "Stats.hpp"
+
+/* Parsing on three threads, behind hw3 --pipeline (fanc::Options::pipeline).
+ * A lexer thread runs the scanner and hands its tokens, with their values and offsets, to a
+ * parser thread through a ring (SpscRing.hpp). The parser thread pushes them into the push
+ * parser and passes every function it reduces through a second ring to the calling thread,
+ * which registers the signatures while the rest of the input is still being lexed and parsed.
+ * The bodies are only checked once the parse is over and every signature is known.
+ * The result is the one of the sequential parse, errors included: a scanner error travels as a
+ * token, so it is raised where the parser reaches it, after any syntax error before it.
+ */
+namespace pipeline {
+    /* Parses the input the scanner was given (scanBuffer or scanStream) and leaves the program in
+     * ::program like yyparse does. declare is called on the calling thread with each function in
+     * source order. The first error of the scanner or parser is rethrown on the calling thread.
+     * Lex and parse times go to report from their threads, their counters are merged into the
+     * calling thread's.
+     */
+    void parse(const std::function<void(const std::shared_ptr<ast::FuncDecl> &)> &declare, stats::Report *report);
+}
+
+#endif //PIPELINE_HPP
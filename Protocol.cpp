@@ -0,0 +1,69 @@
+#include "Protocol.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+
+namespace protocol {
+    static const size_t MAX_FRAME = 64 << 20;
+
+    FrameReader::FrameReader(int fd) : fd(fd), pos(0), end(0) {}
+
+    bool FrameReader::fill() {
+        while (true) {
+            ssize_t n = read(fd, buffer, sizeof(buffer));
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                return false;
+            pos = 0;
+            end = n;
+            return true;
+        }
+    }
+
+    bool FrameReader::readFrame(std::string &payload) {
+        size_t length = 0;
+        int digits = 0;
+        while (true) {
+            if (pos == end && !fill())
+                return false;
+            char c = buffer[pos++];
+            if (c == '\n')
+                break;
+            if (c < '0' || c > '9' || ++digits > 10)
+                return false;
+            length = length * 10 + (c - '0');
+        }
+        if (digits == 0 || length > MAX_FRAME)
+            return false;
+        payload.resize(length);
+        size_t done = 0;
+        while (done < length) {
+            if (pos == end && !fill())
+                return false;
+            size_t n = std::min(length - done, end - pos);
+            memcpy(&payload[done], buffer + pos, n);
+            pos += n;
+            done += n;
+        }
+        return true;
+    }
+
+    std::string frame(const std::string &payload) {
+        return std::to_string(payload.size()) + "\n" + payload;
+    }
+
+    bool writeAll(int fd, const std::string &data) {
+        size_t done = 0;
+        while (done < data.size()) {
+            ssize_t n = write(fd, data.data() + done, data.size() - done);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                return false;
+            done += n;
+        }
+        return true;
+    }
+}
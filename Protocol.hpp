@@ -0,0 +1,36 @@
+#ifndef PROTOCOL_HPP
+#define PROTOCOL_HPP
+
+#include <string>
+
+/* Wire format between hw3 --serve and hw3-client.
+ * Every message is a frame: the payload length in decimal, a newline, then the payload bytes.
+ * A request is one frame holding the source. The response is two frames, the analyzer output
+ * and the diagnostic, exactly one of them is empty; written one after the other they are what
+ * hw3 prints to stdout for the same source. A connection can carry any number of requests.
+ */
+namespace protocol {
+    // Reads frames from a socket through a buffer, so a small frame costs one read call
+    class FrameReader {
+    public:
+        explicit FrameReader(int fd);
+
+        // False on end of file or a malformed frame
+        bool readFrame(std::string &payload);
+
+    private:
+        int fd;
+        char buffer[4096];
+        size_t pos;
+        size_t end;
+
+        bool fill();
+    };
+
+    // Encodes a payload as a frame, a message is written with one writeAll of its frames
+    std::string frame(const std::string &payload);
+
+    bool writeAll(int fd, const std::string &data);
+}
+
+#endif //PROTOCOL_HPP
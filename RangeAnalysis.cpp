@@ -0,0 +1,326 @@
+#include "RangeAnalysis.hpp"
+#include <algorithm>
+#include <climits>
+#include <set>
+
+namespace ranges {
+
+    static const Interval EMPTY = {1, 0};
+    static const Interval ANY_INT = {INT_MIN, INT_MAX};
+    static const Interval ANY_BYTE = {0, 255};
+
+    // Bounds that widening jumps to, the byte limits keep byte loops precise
+    static const long long thresholds[] = {INT_MIN, 0, 255, INT_MAX};
+
+    static Interval join(const Interval &a, const Interval &b) {
+        if (a.empty())
+            return b;
+        if (b.empty())
+            return a;
+        return {std::min(a.lo, b.lo), std::max(a.hi, b.hi)};
+    }
+
+    static Interval meet(const Interval &a, const Interval &b) {
+        return {std::max(a.lo, b.lo), std::min(a.hi, b.hi)};
+    }
+
+    static bool operator!=(const Interval &a, const Interval &b) {
+        if (a.empty() && b.empty())
+            return false;
+        return a.lo != b.lo || a.hi != b.hi;
+    }
+
+    static bool inByteRange(const Interval &a) {
+        return !a.empty() && a.lo >= 0 && a.hi <= 255;
+    }
+
+    // 32-bit arithmetic wraps around, so a result that leaves the int range may be anything
+    static Interval toInt(long long lo, long long hi) {
+        if (lo < INT_MIN || hi > INT_MAX)
+            return ANY_INT;
+        return {lo, hi};
+    }
+
+    static Interval typeRange(ast::BuiltInType type) {
+        if (type == ast::BuiltInType::BYTE)
+            return ANY_BYTE;
+        if (type == ast::BuiltInType::BOOL)
+            return {0, 1};
+        return ANY_INT;
+    }
+
+    static Interval widen(const Interval &old, const Interval &next) {
+        if (old.empty())
+            return next;
+        Interval result = next;
+        if (next.lo < old.lo)
+            for (long long threshold : thresholds)
+                if (threshold <= next.lo)
+                    result.lo = threshold;
+        if (next.hi > old.hi)
+            for (auto it = std::rbegin(thresholds); it != std::rend(thresholds); ++it)
+                if (*it >= next.hi)
+                    result.hi = *it;
+        return result;
+    }
+
+    static Interval divide(const Interval &a, const Interval &b) {
+        std::vector<long long> divisors;
+        if (b.lo < 0)
+            divisors.insert(divisors.end(), {b.lo, std::min(b.hi, -1LL)});
+        if (b.hi > 0)
+            divisors.insert(divisors.end(), {std::max(b.lo, 1LL), b.hi});
+        if (divisors.empty())
+            return ANY_INT;
+        long long lo = LLONG_MAX, hi = LLONG_MIN;
+        for (long long divisor : divisors) {
+            for (long long dividend : {a.lo, a.hi}) {
+                lo = std::min(lo, dividend / divisor);
+                hi = std::max(hi, dividend / divisor);
+            }
+        }
+        return toInt(lo, hi);
+    }
+
+    void RangeStats::add(const RangeStats &other) {
+        truncs += other.truncs;
+        truncs_removed += other.truncs_removed;
+        div_checks += other.div_checks;
+        div_checks_removed += other.div_checks_removed;
+        warnings.insert(warnings.end(), other.warnings.begin(), other.warnings.end());
+    }
+
+    void RangeAnalysis::splitBlocks(const ir::Function &function) {
+        const auto &code = function.code;
+        blocks.clear();
+        block_of_label.assign(function.num_labels, -1);
+        size_t begin = 0;
+        for (size_t i = 0; i < code.size(); i++) {
+            if (code[i].op == ir::LABEL && i > begin) {
+                blocks.push_back({begin, i});
+                begin = i;
+            }
+            if (code[i].op == ir::LABEL)
+                block_of_label[code[i].imm] = (int) blocks.size();
+            if (code[i].isBranch() || code[i].op == ir::RET) {
+                blocks.push_back({begin, i + 1});
+                begin = i + 1;
+            }
+        }
+        if (begin < code.size())
+            blocks.push_back({begin, code.size()});
+    }
+
+    void RangeAnalysis::transfer(const ir::Instr &instr, State &state) const {
+        const Interval &a = instr.a >= 0 ? state[instr.a] : EMPTY;
+        const Interval &b = instr.b >= 0 ? state[instr.b] : EMPTY;
+        Interval result = EMPTY;
+        switch (instr.op) {
+            case ir::CONST:
+                result = {instr.imm, instr.imm};
+                break;
+            case ir::COPY:
+                result = a;
+                break;
+            case ir::ADD:
+                result = toInt(a.lo + b.lo, a.hi + b.hi);
+                break;
+            case ir::SUB:
+                result = toInt(a.lo - b.hi, a.hi - b.lo);
+                break;
+            case ir::MUL: {
+                long long corners[] = {a.lo * b.lo, a.lo * b.hi, a.hi * b.lo, a.hi * b.hi};
+                result = toInt(*std::min_element(corners, corners + 4), *std::max_element(corners, corners + 4));
+                break;
+            }
+            case ir::DIV:
+                result = divide(a, b);
+                break;
+            case ir::CHECK_DIV: {
+                // Past the guard the divisor is known not to be zero
+                Interval divisor = a;
+                if (divisor.lo == 0)
+                    divisor.lo = 1;
+                if (divisor.hi == 0)
+                    divisor.hi = -1;
+                state[instr.a] = divisor;
+                return;
+            }
+            case ir::TRUNC:
+                result = inByteRange(a) ? a : ANY_BYTE;
+                break;
+            case ir::STR:
+            case ir::CALL:
+                if (instr.dst >= 0)
+                    result = typeRange(func->reg_types[instr.dst]);
+                break;
+            default:
+                return;
+        }
+        if (instr.dst >= 0)
+            state[instr.dst] = (a.empty() && instr.a >= 0) || (b.empty() && instr.b >= 0) ? EMPTY : result;
+    }
+
+    // Narrows the operands of `a cmp b` assuming it holds, returns false if it never can
+    bool RangeAnalysis::refine(ast::RelOpType cmp, int a, int b, State &state) {
+        Interval left = state[a], right = state[b];
+        switch (cmp) {
+            case ast::RelOpType::EQ:
+                left = right = meet(left, right);
+                break;
+            case ast::RelOpType::NE:
+                if (right.lo == right.hi) {
+                    if (left.lo == right.lo)
+                        left.lo++;
+                    if (left.hi == right.lo)
+                        left.hi--;
+                }
+                if (left.lo == left.hi) {
+                    if (right.lo == left.lo)
+                        right.lo++;
+                    if (right.hi == left.lo)
+                        right.hi--;
+                }
+                break;
+            case ast::RelOpType::LT:
+                left.hi = std::min(left.hi, right.hi - 1);
+                right.lo = std::max(right.lo, left.lo + 1);
+                break;
+            case ast::RelOpType::LE:
+                left.hi = std::min(left.hi, right.hi);
+                right.lo = std::max(right.lo, left.lo);
+                break;
+            case ast::RelOpType::GT:
+                left.lo = std::max(left.lo, right.lo + 1);
+                right.hi = std::min(right.hi, left.hi - 1);
+                break;
+            case ast::RelOpType::GE:
+                left.lo = std::max(left.lo, right.lo);
+                right.hi = std::min(right.hi, left.hi);
+                break;
+        }
+        if (left.empty() || right.empty())
+            return false;
+        state[a] = left;
+        state[b] = right;
+        return true;
+    }
+
+    RangeStats RangeAnalysis::run(ir::Function &function) {
+        func = &function;
+        splitBlocks(function);
+        const auto &code = function.code;
+        size_t regs = function.reg_types.size();
+
+        std::vector<State> in(blocks.size());
+        std::vector<bool> reached(blocks.size(), false), loop_head(blocks.size(), false);
+        std::vector<int> visits(blocks.size(), 0);
+        for (size_t block = 0; block < blocks.size(); block++) {
+            const ir::Instr &last = code[blocks[block].end - 1];
+            if (last.isBranch() && block_of_label[last.target] <= (int) block)
+                loop_head[block_of_label[last.target]] = true;
+        }
+
+        std::set<size_t> worklist;
+        auto propagate = [&](size_t to, const State &state) {
+            if (to >= blocks.size())
+                return;
+            if (!reached[to]) {
+                in[to] = state;
+                reached[to] = true;
+                worklist.insert(to);
+                return;
+            }
+            bool changed = false;
+            for (size_t reg = 0; reg < regs; reg++) {
+                Interval next = join(in[to][reg], state[reg]);
+                if (loop_head[to] && visits[to] > 2)
+                    next = widen(in[to][reg], next);
+                if (next != in[to][reg]) {
+                    in[to][reg] = next;
+                    changed = true;
+                }
+            }
+            if (changed)
+                worklist.insert(to);
+        };
+
+        if (!blocks.empty()) {
+            State entry(regs, EMPTY);
+            for (int param = 0; param < function.num_params; param++)
+                entry[param] = typeRange(function.reg_types[param]);
+            propagate(0, entry);
+        }
+        while (!worklist.empty()) {
+            size_t block = *worklist.begin();
+            worklist.erase(worklist.begin());
+            visits[block]++;
+            State state = in[block];
+            for (size_t i = blocks[block].begin; i < blocks[block].end; i++) {
+                const ir::Instr &instr = code[i];
+                if (instr.op == ir::BRANCH) {
+                    State taken = state;
+                    if (refine(instr.cmp, instr.a, instr.b, taken))
+                        propagate(block_of_label[instr.target], taken);
+                    if (refine(ir::negate(instr.cmp), instr.a, instr.b, state))
+                        propagate(block + 1, state);
+                } else if (instr.op == ir::JUMP) {
+                    propagate(block_of_label[instr.target], state);
+                } else if (instr.op != ir::RET) {
+                    transfer(instr, state);
+                    if (i + 1 == blocks[block].end)
+                        propagate(block + 1, state);
+                }
+            }
+        }
+
+        // Replay every reachable block with its final entry state and drop the guards proven redundant
+        RangeStats stats;
+        std::vector<bool> removed(code.size(), false);
+        for (size_t block = 0; block < blocks.size(); block++) {
+            State state = reached[block] ? in[block] : State();
+            for (size_t i = blocks[block].begin; i < blocks[block].end; i++) {
+                ir::Instr &instr = function.code[i];
+                if (instr.op == ir::TRUNC) {
+                    stats.truncs++;
+                    if (reached[block] && inByteRange(state[instr.a])) {
+                        stats.truncs_removed++;
+                        removed[i] = instr.a == instr.dst;
+                        instr.op = ir::COPY;
+                    } else if (reached[block] && instr.imm == 1 && !state[instr.a].empty() &&
+                               (state[instr.a].lo > 255 || state[instr.a].hi < 0)) {
+                        stats.warnings.push_back("line " + std::to_string(lines.line(instr.offset)) +
+                                                 ": byte value in [" + std::to_string(state[instr.a].lo) + ", " +
+                                                 std::to_string(state[instr.a].hi) + "] is always out of range");
+                    }
+                } else if (instr.op == ir::CHECK_DIV) {
+                    stats.div_checks++;
+                    if (reached[block] && !state[instr.a].empty() && !state[instr.a].contains(0)) {
+                        stats.div_checks_removed++;
+                        removed[i] = true;
+                    } else if (reached[block] && state[instr.a].lo == 0 && state[instr.a].hi == 0) {
+                        stats.warnings.push_back("line " + std::to_string(lines.line(instr.offset)) + ": division by zero");
+                    }
+                }
+                if (reached[block] && !instr.isBranch())
+                    transfer(instr, state);
+            }
+        }
+        std::vector<ir::Instr> kept;
+        for (size_t i = 0; i < code.size(); i++)
+            if (!removed[i])
+                kept.push_back(code[i]);
+        function.code = kept;
+        func = nullptr;
+        return stats;
+    }
+
+    void printStats(const RangeStats &stats, std::ostream &os) {
+        os << "---range analysis---" << std::endl;
+        for (auto &warning : stats.warnings)
+            os << "warning: " << warning << std::endl;
+        os << "truncation guards removed: " << stats.truncs_removed << " of " << stats.truncs << std::endl;
+        os << "division guards removed: " << stats.div_checks_removed << " of " << stats.div_checks << std::endl;
+    }
+
+}
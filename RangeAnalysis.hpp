@@ -0,0 +1,73 @@
+#ifndef RANGE_ANALYSIS_HPP
+#define RANGE_ANALYSIS_HPP
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include "IR.hpp"
+
+/* Interval analysis of int and byte values over the IR.
+ * Intervals flow through declarations and assignments (COPY), arithmetic, conversions (TRUNC)
+ * and are narrowed on both edges of every conditional branch, so `if (x < 10)` and loop
+ * conditions bound the variables they test. Loop heads are widened towards the byte and int
+ * limits so the analysis always terminates.
+ * Truncation guards whose operand provably fits in a byte and division guards whose divisor
+ * provably is not zero are removed. Conversions whose operand can never fit a byte are
+ * reported as warnings.
+ */
+namespace ranges {
+
+    struct Interval {
+        long long lo;
+        long long hi;
+
+        bool empty() const { return lo > hi; }
+
+        bool contains(long long value) const { return lo <= value && value <= hi; }
+    };
+
+    struct RangeStats {
+        int truncs;
+        int truncs_removed;
+        int div_checks;
+        int div_checks_removed;
+        std::vector<std::string> warnings;
+
+        RangeStats() : truncs(0), truncs_removed(0), div_checks(0), div_checks_removed(0) {};
+
+        void add(const RangeStats &other);
+    };
+
+    class RangeAnalysis {
+    public:
+        // lines locates the warnings, see fanc::Result::lines
+        explicit RangeAnalysis(const source::LineTable &lines) : lines(lines), func(nullptr) {};
+
+        // Analyses func and removes the guards that were proven redundant
+        RangeStats run(ir::Function &func);
+
+    private:
+        struct Block {
+            size_t begin;
+            size_t end;
+        };
+
+        typedef std::vector<Interval> State;
+
+        const source::LineTable &lines;
+        const ir::Function *func;
+        std::vector<Block> blocks;
+        std::vector<int> block_of_label;
+
+        void splitBlocks(const ir::Function &func);
+
+        void transfer(const ir::Instr &instr, State &state) const;
+
+        static bool refine(ast::RelOpType cmp, int a, int b, State &state);
+    };
+
+    void printStats(const RangeStats &stats, std::ostream &os);
+
+}
+
+#endif //RANGE_ANALYSIS_HPP
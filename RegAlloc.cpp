@@ -0,0 +1,197 @@
+#include "RegAlloc.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <unordered_map>
+
+namespace regalloc {
+
+    // Caller- and callee-saved registers are interleaved so that a reduced pool keeps both kinds
+    const char *const registerNames[] = {"rcx", "rbx", "rsi", "r12", "rdi", "r13", "r8", "r14",
+                                         "r9", "r15", "r10"};
+    const bool calleeSaved[] = {false, true, false, true, false, true, false, true, false, true, false};
+    const int registerCount = sizeof(calleeSaved) / sizeof(calleeSaved[0]);
+
+    // Fixed-size bit set over the IR registers of one function
+    class RegSet {
+    public:
+        explicit RegSet(size_t size = 0) : words((size + 63) / 64, 0) {};
+
+        void insert(int reg) { words[reg / 64] |= 1ULL << (reg % 64); }
+
+        void erase(int reg) { words[reg / 64] &= ~(1ULL << (reg % 64)); }
+
+        bool contains(int reg) const { return words[reg / 64] >> (reg % 64) & 1; }
+
+        bool unite(const RegSet &other) {
+            bool changed = false;
+            for (size_t i = 0; i < words.size(); i++) {
+                uint64_t merged = words[i] | other.words[i];
+                changed |= merged != words[i];
+                words[i] = merged;
+            }
+            return changed;
+        }
+
+        template<typename Fn>
+        void forEach(Fn fn) const {
+            for (size_t i = 0; i < words.size(); i++)
+                for (uint64_t word = words[i]; word != 0; word &= word - 1)
+                    fn((int) (i * 64 + __builtin_ctzll(word)));
+        }
+
+    private:
+        std::vector<uint64_t> words;
+    };
+
+    int Allocation::calleeSavedUsed() const {
+        int count = 0;
+        for (int reg : used_registers)
+            count += calleeSaved[reg];
+        return count;
+    }
+
+    LinearScan::LinearScan(int max_registers)
+            : max_registers(std::max(1, std::min(max_registers, registerCount))) {}
+
+    std::vector<LiveInterval> LinearScan::buildIntervals(const ir::Function &func) const {
+        const auto &code = func.code;
+        size_t size = code.size();
+        size_t regs = func.reg_types.size();
+
+        std::unordered_map<int, size_t> labels;
+        for (size_t i = 0; i < size; i++)
+            if (code[i].op == ir::LABEL)
+                labels[code[i].imm] = i;
+
+        // Backward liveness until a fixed point, loops need more than one round
+        std::vector<RegSet> live_in(size, RegSet(regs)), live_out(size, RegSet(regs));
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            for (size_t i = size; i-- > 0;) {
+                const ir::Instr &instr = code[i];
+                RegSet out(regs);
+                if (instr.op == ir::JUMP || instr.op == ir::BRANCH)
+                    out.unite(live_in[labels.at(instr.target)]);
+                if (instr.op != ir::JUMP && instr.op != ir::RET && i + 1 < size)
+                    out.unite(live_in[i + 1]);
+                live_out[i] = out;
+                RegSet in = out;
+                if (instr.dst >= 0)
+                    in.erase(instr.dst);
+                for (int reg : instr.uses())
+                    in.insert(reg);
+                changed |= live_in[i].unite(in);
+            }
+        }
+
+        std::vector<LiveInterval> intervals(regs);
+        for (size_t reg = 0; reg < regs; reg++)
+            intervals[reg] = {(int) reg, -1, -1, 0, SPILLED, -1};
+        auto extend = [&intervals](int reg, int position) {
+            LiveInterval &interval = intervals[reg];
+            if (interval.start < 0 || position < interval.start)
+                interval.start = position;
+            interval.end = std::max(interval.end, position);
+        };
+        for (int param = 0; param < func.num_params; param++)
+            extend(param, 0);
+        for (size_t i = 0; i < size; i++) {
+            live_in[i].forEach([&](int reg) { extend(reg, (int) i); });
+            if (code[i].dst >= 0)
+                extend(code[i].dst, (int) i);
+            if (code[i].op == ir::CALL) {
+                live_out[i].forEach([&](int reg) {
+                    if (reg != code[i].dst)
+                        intervals[reg].calls_crossed++;
+                });
+            }
+        }
+
+        std::vector<LiveInterval> result;
+        for (auto &interval : intervals)
+            if (interval.start >= 0)
+                result.push_back(interval);
+        std::sort(result.begin(), result.end(), [](const LiveInterval &a, const LiveInterval &b) {
+            return a.start < b.start || (a.start == b.start && a.reg < b.reg);
+        });
+        return result;
+    }
+
+    Allocation LinearScan::allocate(const ir::Function &func) const {
+        Allocation allocation;
+        allocation.function = func.name;
+        allocation.intervals = buildIntervals(func);
+        auto &intervals = allocation.intervals;
+
+        std::vector<bool> is_free(max_registers, true), ever_used(max_registers, false);
+        std::vector<int> active;    // indexes into intervals, sorted by end
+        auto by_end = [&intervals](int a, int b) { return intervals[a].end < intervals[b].end; };
+        auto spill = [&allocation](LiveInterval &interval) {
+            interval.location = SPILLED;
+            interval.spill_slot = allocation.spill_slots++;
+            allocation.spills++;
+        };
+
+        for (size_t current = 0; current < intervals.size(); current++) {
+            LiveInterval &interval = intervals[current];
+
+            // Expire intervals that ended before this one starts
+            while (!active.empty() && intervals[active.front()].end < interval.start) {
+                is_free[intervals[active.front()].location] = true;
+                active.erase(active.begin());
+            }
+
+            // Values live across a call prefer callee-saved registers, all others prefer caller-saved ones
+            int chosen = -1;
+            bool wants_callee_saved = interval.calls_crossed > 0;
+            for (int reg = 0; reg < max_registers && chosen < 0; reg++)
+                if (is_free[reg] && calleeSaved[reg] == wants_callee_saved)
+                    chosen = reg;
+            for (int reg = 0; reg < max_registers && chosen < 0; reg++)
+                if (is_free[reg])
+                    chosen = reg;
+
+            if (chosen < 0) {
+                // Spill whichever of the active intervals and the current one ends last
+                int victim = active.back();
+                if (intervals[victim].end > interval.end) {
+                    chosen = intervals[victim].location;
+                    spill(intervals[victim]);
+                    active.pop_back();
+                } else {
+                    spill(interval);
+                    continue;
+                }
+            }
+
+            interval.location = chosen;
+            is_free[chosen] = false;
+            ever_used[chosen] = true;
+            active.insert(std::upper_bound(active.begin(), active.end(), (int) current, by_end), (int) current);
+            allocation.max_pressure = std::max(allocation.max_pressure, (int) active.size());
+        }
+
+        allocation.location.assign(func.reg_types.size(), SPILLED);
+        for (auto &interval : intervals) {
+            allocation.location[interval.reg] = interval.location;
+            if (interval.location != SPILLED && !calleeSaved[interval.location])
+                allocation.call_saves += interval.calls_crossed;
+        }
+        for (int reg = 0; reg < max_registers; reg++)
+            if (ever_used[reg])
+                allocation.used_registers.push_back(reg);
+        return allocation;
+    }
+
+    void printStats(const Allocation &allocation, std::ostream &os) {
+        os << allocation.function << ": " << allocation.intervals.size() << " intervals, "
+           << allocation.used_registers.size() << " registers (";
+        for (size_t i = 0; i < allocation.used_registers.size(); i++)
+            os << (i ? " " : "") << registerNames[allocation.used_registers[i]];
+        os << "), " << allocation.calleeSavedUsed() << " callee-saved, max pressure " << allocation.max_pressure
+           << ", " << allocation.spills << " spills, " << allocation.call_saves << " saves around calls"
+           << std::endl;
+    }
+
+}
@@ -0,0 +1,71 @@
+#ifndef REGALLOC_HPP
+#define REGALLOC_HPP
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include "IR.hpp"
+
+/* Linear-scan register allocation of IR registers onto x86-64 registers.
+ * Live intervals come from a backward liveness pass over the function, so a variable only
+ * occupies a register where it is actually live instead of owning a stack slot for the whole
+ * function. rax (return value), rdx (idiv writes rdx:rax) and r11 (spill scratch) are never
+ * allocated.
+ * Values live across a call prefer callee-saved registers, which the function saves once in
+ * its prologue. When none is free they get a caller-saved register that is saved and restored
+ * around every call they cross, and only when no register is free at all is a value spilled.
+ */
+namespace regalloc {
+
+    enum Location {
+        SPILLED = -1
+    };
+
+    struct LiveInterval {
+        int reg;
+        int start;
+        int end;
+        int calls_crossed;
+        int location;   // index into registerNames, or SPILLED
+        int spill_slot;
+    };
+
+    struct Allocation {
+        std::string function;
+        std::vector<LiveInterval> intervals;
+        std::vector<int> location;          // physical register of each IR register, or SPILLED
+        int spills;
+        int spill_slots;
+        int call_saves;                     // caller-saved registers saved and restored around calls
+        int max_pressure;
+        std::vector<int> used_registers;
+
+        Allocation() : spills(0), spill_slots(0), call_saves(0), max_pressure(0) {};
+
+        int calleeSavedUsed() const;
+    };
+
+    extern const char *const registerNames[];
+
+    extern const bool calleeSaved[];
+
+    extern const int registerCount;
+
+    class LinearScan {
+    public:
+        // Only the first max_registers entries of registerNames are allocated
+        explicit LinearScan(int max_registers = registerCount);
+
+        Allocation allocate(const ir::Function &func) const;
+
+    private:
+        int max_registers;
+
+        std::vector<LiveInterval> buildIntervals(const ir::Function &func) const;
+    };
+
+    void printStats(const Allocation &allocation, std::ostream &os);
+
+}
+
+#endif //REGALLOC_HPP
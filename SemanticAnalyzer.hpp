@@ -4,14 +4,17 @@
 #include "visitor.hpp"
 #include "SymbolTable.hpp"
 #include "output.hpp"
+#include "AnalysisCache.hpp"
+#include "Trace.hpp"
+#include "TypeRules.hpp"
+#include <chrono>
 #include <iostream>
 
 
-static int convert_int_to_byte (int num, int line);
+static int convert_int_to_byte (int num, source::Offset offset);
 
 static bool is_num_type (ast::BuiltInType type);
 
-static bool compare_exp_list (std::vector<ast::BuiltInType>& paramTypesDecl, std::vector<ast::BuiltInType>& paramTypesCall);
 
 //void getExpSymbols (ast::Exp& node, std::unordered_map<std::string, Symbol>& symbols);
 
@@ -20,98 +23,223 @@ std::vector<std::string> builtInTypeToString(const std::vector<ast::BuiltInType>
 std::vector<std::string> builtInTypeVectorToString(const std::vector<ast::BuiltInType>& types) ;
 
 
-class SemanticAnalyzer : public Visitor {
+/* Type checks the AST and fills the symbol table.
+ * Nodes are visited through ast::visitExp / ast::visitStatement, which pick the visit overload
+ * by the node's kind. Expressions take a Constant to report a literal value to their parent.
+ * Neither expressions nor statements are walked recursively: checkExp and checkStatement keep
+ * their own work stacks, so how deep a program nests is bounded by the heap, not by the stack
+ * of the (possibly worker) thread.
+ */
+class SemanticAnalyzer {
 public:
-    // Implement visit methods for each type of AST node
+    // Value of an expression that is a literal or a cast of one, used to range check bytes
+    struct Constant {
+        bool known = false;
+        int value = 0;
+
+        void set(int new_value) {
+            known = true;
+            value = new_value;
+        }
+    };
+
+    // Parameters of a function as collected from its formals
+    struct Params {
+        std::vector<ast::BuiltInType> types;
+        std::vector<std::string> names;
+    };
+
+    // An operand that has been checked, handed to the visit of the expression using it
+    struct Operand {
+        ast::BuiltInType type;
+        Constant constant;
+    };
+
+    // Checks an expression and its operands, operands first and in source order
+    ast::BuiltInType checkExp(ast::Exp& root, Constant* constant) {
+        exp_work.clear();
+        operand_stack.clear();
+        exp_work.push_back({&root, constant != nullptr, false, 0});
+        while (!exp_work.empty()) {
+            ExpWork& top = exp_work.back();
+            if (!top.expanded) {
+                top.expanded = true;
+                top.operands = operand_stack.size();
+                ast::Exp& exp = *top.exp;
+                // Arithmetic and casts range check the value of their operands
+                bool wants_constant = exp.kind == ast::NodeKind::BinOp || exp.kind == ast::NodeKind::Cast;
+                if (exp.kind == ast::NodeKind::Call)
+                    checkCallee(static_cast<ast::Call&>(exp));
+                pushOperands(exp, wants_constant);
+                continue;
+            }
+            ExpWork done = top;
+            exp_work.pop_back();
+            Constant value;
+            ast::BuiltInType type = ast::visitExp(*done.exp, *this, done.wants_constant ? &value : nullptr,
+                                                  operand_stack.data() + done.operands);
+            operand_stack.resize(done.operands);
+            operand_stack.push_back({type, value});
+        }
+        if (constant != nullptr)
+            *constant = operand_stack.back().constant;
+        return operand_stack.back().type;
+    }
+
+    // Checks a statement, compound statements push their parts and scope changes instead of recursing
+    void checkStatement(ast::Statement& root) {
+        enum Step { VISIT, ENTER_IF, ENTER_WHILE, EXIT_SCOPE };
+        struct Work {
+            Step step;
+            ast::Statement* statement;
+        };
+        std::vector<Work> work = {{VISIT, &root}};
+        while (!work.empty()) {
+            Work item = work.back();
+            work.pop_back();
+            if (item.step == ENTER_IF) {
+                sym_table.enterScope(ScopeType::IF, static_cast<ast::If*>(item.statement)->condition->get_symbols());
+                continue;
+            }
+            if (item.step == ENTER_WHILE) {
+                sym_table.enterScope(ScopeType::WHILE,
+                                     static_cast<ast::While*>(item.statement)->condition->get_symbols());
+                continue;
+            }
+            if (item.step == EXIT_SCOPE) {
+                sym_table.exitScope();
+                continue;
+            }
+            // Parts are pushed last first, so they run in source order
+            switch (item.statement->kind) {
+                case ast::NodeKind::Statements: {
+                    auto& node = static_cast<ast::Statements&>(*item.statement);
+                    //sstd::cout << "Analyzing Statements node" << std::endl;
+                    if (node.is_scope) {
+                        sym_table.enterScope(ScopeType::INFUNC);
+                        work.push_back({EXIT_SCOPE, &node});
+                    }
+                    for (auto it = node.statements.rbegin(); it != node.statements.rend(); ++it)
+                        work.push_back({VISIT, it->get()});
+                    break;
+                }
+                case ast::NodeKind::If: {
+                    auto& node = static_cast<ast::If&>(*item.statement);
+                    //std::cout << "Analyzing If node" << std::endl;
+                    if (checkExp(*node.condition, nullptr) != ast::BuiltInType::BOOL)
+                        output::errorMismatch( node.condition->offset);
+                    if (node.otherwise != nullptr) {
+                        work.push_back({EXIT_SCOPE, &node});
+                        work.push_back({VISIT, node.otherwise.get()});
+                        work.push_back({ENTER_IF, &node});
+                    }
+                    work.push_back({EXIT_SCOPE, &node});
+                    work.push_back({VISIT, node.then.get()});
+                    work.push_back({ENTER_IF, &node});
+                    break;
+                }
+                case ast::NodeKind::While: {
+                    auto& node = static_cast<ast::While&>(*item.statement);
+                    //std::cout << "Analyzing While node" << std::endl;
+                    if (checkExp(*node.condition, nullptr) != ast::BuiltInType::BOOL)
+                        output::errorMismatch( node.condition->offset);
+                    work.push_back({EXIT_SCOPE, &node});
+                    work.push_back({VISIT, node.body.get()});
+                    work.push_back({ENTER_WHILE, &node});
+                    break;
+                }
+                default:
+                    ast::visitStatement(*item.statement, *this);
+            }
+        }
+    }
 
     class SymbolTable sym_table;
 
+    // When set, functions whose analysis is cached are replayed instead of visited
+    AnalysisCache *cache = nullptr;
+    // Texts of the string literals, for the keys of the cache
+    const literals::Pool *literals = nullptr;
+
     void register_func(ast::FuncDecl& node)
     {
         //std::cout << "adding a func " << node.id->value << std::endl;
-        std::vector<ast::BuiltInType> paramTypes;
+        const signatures::Signature *params = sym_table.signatures->empty();
         for (auto formal : node.formals->formals)
-            paramTypes.push_back(formal->type->type);
-        sym_table.insertSymbolFunc(node.id->value, node.return_type->type ,paramTypes);
+            params = params->extend(formal->type->type);
+        sym_table.insertSymbolFunc(node.id->value, node.return_type->type, params);
         //std::cout << "adding a func done " << node.id->value << std::endl;
     }
 
-    ast::BuiltInType visit(ast::Num& node, int* val) override {
-        if (val != nullptr) {
-            *val = node.value;
+    ast::BuiltInType visit(ast::Num& node, Constant* constant, const Operand* operands) {
+        if (constant != nullptr) {
+            constant->set(node.value);
         }
         return ast::BuiltInType::INT;
     }
-    ast::BuiltInType visit(ast::NumB& node, int* val) override {
-        if (val != nullptr)
-            *val = node.value;
-        convert_int_to_byte (node.value, node.line);
+    ast::BuiltInType visit(ast::NumB& node, Constant* constant, const Operand* operands) {
+        if (constant != nullptr)
+            constant->set(node.value);
+        convert_int_to_byte (node.value, node.offset);
         //sstd::cout << "Analyzing NumB node" << std::endl;
         return ast::BuiltInType::BYTE;
     }
 
-    ast::BuiltInType visit(ast::String& node, int* val) override {
+    ast::BuiltInType visit(ast::String& node, Constant* constant, const Operand* operands) {
         //sstd::cout << "Analyzing String node" << std::endl;
         return ast::BuiltInType::STRING;
     }
 
-    ast::BuiltInType visit(ast::Bool& node, int* val) override {
-        if (val != nullptr)
-            *val = node.value;
+    ast::BuiltInType visit(ast::Bool& node, Constant* constant, const Operand* operands) {
+        if (constant != nullptr)
+            constant->set(node.value);
         //sstd::cout << "Analyzing Bool node" << std::endl;
         return ast::BuiltInType::BOOL;
     }
 
-    ast::BuiltInType visit(ast::ID& node, int* symbols) override {
+    ast::BuiltInType visit(ast::ID& node, Constant* constant, const Operand* operands) {
         //std::cout << "Analyzing ID node for "<< node.value << std::endl;
 
         if (sym_table.isFunctionDefined(node.value))
-            output::errorDefAsFunc(node.line, node.value);
+            output::errorDefAsFunc(node.offset, node.value);
         if (!sym_table.currentScope->hasSymbol(node.value))
         {
             //sstd::cout << "line 64 - sym not found" << std::endl;
-            output::errorUndef(node.line, node.value);
+            output::errorUndef(node.offset, node.value);
         }
         ast::BuiltInType type = sym_table.getSymbolType(node.value);
         if (type ==  ast::BuiltInType::NONE)
-            output::errorUndef(node.line, node.value);
+            output::errorUndef(node.offset, node.value);
 
         return type;
 
     }
 
-    ast::BuiltInType visit(ast::BinOp& node, int* val) override {
+    ast::BuiltInType visit(ast::BinOp& node, Constant* constant, const Operand* operands) {
         //sstd::cout << "=== Starting BinOp Analysis ===" << std::endl;
 
-        // Create local storage for values
-        int left_val = -26372;
-        int right_val = -26372;
+        // Values of the operands, when they are literals
+        Constant left_val = operands[0].constant;
+        Constant right_val = operands[1].constant;
 
-        // Visit left operand
-        ast::BuiltInType type_1 = node.left->accept(*this, &left_val);
+        // Left operand
+        ast::BuiltInType type_1 = operands[0].type;
         //sstd::cout << "Left operand type: " << static_cast<int>(type_1) << std::endl;
 
-        // Visit right operand
-        ast::BuiltInType type_2 = node.right->accept(*this, &right_val);
+        // Right operand
+        ast::BuiltInType type_2 = operands[1].type;
         //sstd::cout << "Right operand type: " << static_cast<int>(type_2) << std::endl;
 
-        // Check numeric types
-        if (!is_num_type(type_1) || !is_num_type(type_2)) {
+        // Result type, NONE for non-numeric operands
+        ast::BuiltInType result_type = types::arithmetic(type_1, type_2);
+        if (result_type == ast::BuiltInType::NONE) {
             //sstd::cout << "Error: Non-numeric types in arithmetic operation" << std::endl;
-            output::errorMismatch(node.line);
+            output::errorMismatch(node.offset);
             return ast::BuiltInType::NONE;
         }
 
-        // Calculate result type
-        ast::BuiltInType result_type = ast::BuiltInType::INT;
-        if (type_1 == ast::BuiltInType::INT || type_2 == ast::BuiltInType::INT) {
-            result_type = ast::BuiltInType::INT;
-        } else {
-            result_type = ast::BuiltInType::BYTE;
-        }
-
         // Only perform computation if we need to store the result
-        if (val != nullptr) {
+        if (constant != nullptr) {
             // Calculate result value
             switch (node.op) {
                 case ast::BinOpType::ADD:
@@ -124,8 +252,8 @@ public:
                     //*val = left_val * right_val;
                     break;
                 case ast::BinOpType::DIV:
-                    if (right_val == 0) {
-                        output::errorMismatch(node.line);
+                    if (right_val.known && right_val.value == 0) {
+                        output::errorMismatch(node.offset);
                         return ast::BuiltInType::NONE;
                     }
                     //*val = left_val / right_val;
@@ -140,101 +268,92 @@ public:
     }
 
 
-    ast::BuiltInType visit(ast::RelOp& node, int* val) override {
+    ast::BuiltInType visit(ast::RelOp& node, Constant* constant, const Operand* operands) {
         //sstd::cout << "Analyzing RelOp node" << std::endl;
-        int* val_1 = nullptr;
-        int* val_2 = nullptr;
-        ast::BuiltInType type_1 = node.left->accept(*this, nullptr);
-        ast::BuiltInType type_2 = node.right->accept(*this, nullptr);
+        ast::BuiltInType type_1 = operands[0].type;
+        ast::BuiltInType type_2 = operands[1].type;
         if (!is_num_type(type_1) || !is_num_type(type_2))
-            output::errorMismatch(node.line);
+            output::errorMismatch(node.offset);
         return ast::BuiltInType::BOOL;
     }
 
-    ast::BuiltInType visit(ast::Not& node, int* val)  override {
+    ast::BuiltInType visit(ast::Not& node, Constant* constant, const Operand* operands) {
         //sstd::cout << "Analyzing Not node" << std::endl;
-        ast::BuiltInType type = node.exp->accept(*this, nullptr);
+        ast::BuiltInType type = operands[0].type;
         if (type != ast::BuiltInType::BOOL)
-            output::errorMismatch(node.line);
+            output::errorMismatch(node.offset);
 
         return ast::BuiltInType::BOOL;
     }
 
-    ast::BuiltInType visit(ast::And& node, int* val) override {
+    ast::BuiltInType visit(ast::And& node, Constant* constant, const Operand* operands) {
         //sstd::cout << "Analyzing And node" << std::endl;
-        ast::BuiltInType type_1 = node.left->accept(*this, nullptr);
-        ast::BuiltInType type_2 = node.right->accept(*this, nullptr);
+        ast::BuiltInType type_1 = operands[0].type;
+        ast::BuiltInType type_2 = operands[1].type;
 
         if (type_1 != ast::BuiltInType::BOOL || type_2 != ast::BuiltInType::BOOL)
-            output::errorMismatch(node.line);
+            output::errorMismatch(node.offset);
 
         return ast::BuiltInType::BOOL;
 
     }
 
-    ast::BuiltInType visit(ast::Or& node, int* val) override {
+    ast::BuiltInType visit(ast::Or& node, Constant* constant, const Operand* operands) {
         //sstd::cout << "Analyzing Or node" << std::endl;
-        ast::BuiltInType type_1 = node.left->accept(*this, nullptr);
-        ast::BuiltInType type_2 = node.right->accept(*this, nullptr);
+        ast::BuiltInType type_1 = operands[0].type;
+        ast::BuiltInType type_2 = operands[1].type;
 
         if (type_1 != ast::BuiltInType::BOOL || type_2 != ast::BuiltInType::BOOL)
-            output::errorMismatch(node.line);
+            output::errorMismatch(node.offset);
 
         return ast::BuiltInType::BOOL;
     }
 
-    ast::BuiltInType visit(ast::Type& node) override {
+    ast::BuiltInType visit(ast::Type& node) {
         //sstd::cout << "Analyzing Type node" << std::endl;
         return node.type;
     }
 
-    ast::BuiltInType visit(ast::Cast& node, int* val) override {
+    ast::BuiltInType visit(ast::Cast& node, Constant* constant, const Operand* operands) {
         //sstd::cout << "Analyzing Cast node" << std::endl;
-        int exp_val = -6826;
-        ast::BuiltInType exp_type = node.exp->accept(*this,&exp_val);
-        if (node.target_type->type == ast::BuiltInType::BYTE && exp_type == ast::BuiltInType::INT) {
-            if (exp_val != -6826 ) {
-                convert_int_to_byte(exp_val, node.line);
-                if (val != nullptr)
-                    *val = exp_val;
-            }
+        Constant exp_val = operands[0].constant;
+        ast::BuiltInType exp_type = operands[0].type;
+        ast::BuiltInType target_type = node.target_type->type;
+        if (!types::castable(target_type, exp_type))
+            output::errorMismatch(node.offset);
+        // A literal converted between int and byte stays known, it must fit when narrowed
+        if (exp_type != target_type && exp_val.known) {
+            if (types::narrowing(target_type, exp_type))
+                convert_int_to_byte(exp_val.value, node.offset);
+            if (constant != nullptr)
+                *constant = exp_val;
         }
-        else if (node.target_type->type == ast::BuiltInType::INT && exp_type == ast::BuiltInType::BYTE) {
-            if (exp_val != -6826 && val != nullptr)
-                *val = exp_val;
-        }
-        else if (exp_type != node.target_type->type)
-            output::errorMismatch(node.line);
-        return node.target_type->type;
+        return target_type;
 
     }
 
-    ast::BuiltInType visit(ast::ExpList& node,  std::vector<ast::BuiltInType>* paramTypes) override {
-        //sstd::cout << "Analyzing ExpList node" << std::endl;
-        ast::BuiltInType exp_type =  ast::BuiltInType::NONE;
-        for (auto exp_node : node.exps) {
-            exp_type = exp_node->accept(*this, nullptr);
-            paramTypes->push_back(exp_type);
-        }
-        return  ast::BuiltInType::NONE;
-    } //change i belive
-
-    ast::BuiltInType visit(ast::Call& node) override {
+    // The checks of a call made before its arguments are checked
+    void checkCallee(ast::Call& node) {
         //sstd::cout << "Analyzing Call node" << std::endl;
         bool is_defined = sym_table.isFunctionDefined(node.func_id->value);
         // //std::cout <<node.func_id->value<<  " - func scope " << is_defined <<std::endl;
         if (!is_defined && sym_table.currentScope->hasSymbol(node.func_id->value))
-            output::errorDefAsVar(node.line, node.func_id->value);
+            output::errorDefAsVar(node.offset, node.func_id->value);
         if (!is_defined)
-            output::errorUndefFunc(node.line, node.func_id->value);
+            output::errorUndefFunc(node.offset, node.func_id->value);
+    }
+
+    ast::BuiltInType visit(ast::Call& node, Constant* constant, const Operand* operands) {
         Symbol sym = sym_table.getFunctionSymbol(node.func_id->value);
         //sstd::cout << " got sym " << sym.name <<std::endl;
-        std::vector<ast::BuiltInType>   params;
-        visit(*node.args, &params);
+        // The argument types are interned as they are, most calls then match with one comparison
+        const signatures::Signature *args = sym_table.signatures->empty();
+        for (size_t i = 0; i < node.args->exps.size(); i++)
+            args = args->extend(operands[i].type);
         //std::cout << " got params "  <<std::endl;
-        if (!compare_exp_list(params, sym.paramTypes)){
-            std::vector<std::string> paramTypesCopy = builtInTypeVectorToString(sym.paramTypes);
-            output::errorPrototypeMismatch(node.line, node.func_id->value, paramTypesCopy);
+        if (!sym.params->accepts(args)){
+            std::vector<std::string> paramTypesCopy = builtInTypeVectorToString(sym.params->types);
+            output::errorPrototypeMismatch(node.offset, node.func_id->value, paramTypesCopy);
 
         }
         //std::cout << " End Analyzing Call node" << std::endl;
@@ -242,38 +361,33 @@ public:
         return sym.type;
     }
 
-    ast::BuiltInType visit(ast::Call& node, int* p) override {
-        return visit(node);
+    // A call used as a statement
+    ast::BuiltInType visit(ast::Call& node) {
+        return checkExp(node, nullptr);
     }
 
-    ast::BuiltInType visit(ast::Statements& node) override {
-        //sstd::cout << "Analyzing Statements node" << std::endl;
-        if (node.is_scope)
-            sym_table.enterScope(ScopeType::INFUNC);
-        for (auto statment : node.statements)
-            statment->accept(*this);
-        if (node.is_scope)
-            sym_table.exitScope();
+    ast::BuiltInType visit(ast::Statements& node) {
+        checkStatement(node);
         return  ast::BuiltInType::NONE;
     }
 
-    ast::BuiltInType visit(ast::Break& node) override {
+    ast::BuiltInType visit(ast::Break& node) {
         //sstd::cout << "Analyzing Break node" << std::endl;
         if (sym_table.currentScope == nullptr ||
             !sym_table.currentScope->hasTypeAncestor(ScopeType::WHILE) )
-            output::errorUnexpectedBreak (node.line);
+            output::errorUnexpectedBreak (node.offset);
 
         return  ast::BuiltInType::NONE;
     }
 
-    ast::BuiltInType visit(ast::Continue& node) override {
+    ast::BuiltInType visit(ast::Continue& node) {
         if (sym_table.currentScope == nullptr ||
                 !sym_table.currentScope->hasTypeAncestor(ScopeType::WHILE) )
-            output::errorUnexpectedContinue (node.line);
+            output::errorUnexpectedContinue (node.offset);
         return  ast::BuiltInType::NONE;
     }
 
-    ast::BuiltInType visit(ast::Return& node) override {
+    ast::BuiltInType visit(ast::Return& node) {
     // Ensure currentScope is not null before accessing its members
     if (sym_table.currentScope == nullptr) {
         return ast::BuiltInType::NONE; // Return a safe default
@@ -281,32 +395,30 @@ public:
 
     // Check if the scope type is FUNC
     if (!sym_table.currentScope->hasTypeAncestor(ScopeType::FUNC)) {
-        output::errorMismatch(node.line); //tests 26 is wrong here...
+        output::errorMismatch(node.offset); //tests 26 is wrong here...
         return ast::BuiltInType::NONE;
     }
 
     // Check for mismatched void return
     if (node.exp == nullptr && sym_table.currentScope->getFunctionAncestorReturnType() != ast::BuiltInType::VOID) {
-        output::errorMismatch(node.line);
+        output::errorMismatch(node.offset);
         return ast::BuiltInType::NONE;
     }
 
     // Check for mismatched non-void return
     if (node.exp != nullptr) {
         if (sym_table.currentScope->getFunctionAncestorReturnType() == ast::BuiltInType::VOID) {
-            output::errorMismatch(node.line);
+            output::errorMismatch(node.offset);
             return ast::BuiltInType::NONE;
         }
 
         // Check the expression's type
         ast::BuiltInType func_type = sym_table.currentScope->getFunctionAncestorReturnType();
-        ast::BuiltInType exp_type = node.exp->accept(*this, nullptr);
-        if(!(exp_type ==ast::BuiltInType::BYTE &&  func_type == ast::BuiltInType::INT)) {
-            if (exp_type != func_type) {
-                //std::cout <<"here?" << std::endl;
-                output::errorMismatch(node.line);
-                return ast::BuiltInType::NONE;
-            }
+        ast::BuiltInType exp_type = checkExp(*node.exp, nullptr);
+        if (!types::assignable(func_type, exp_type)) {
+            //std::cout <<"here?" << std::endl;
+            output::errorMismatch(node.offset);
+            return ast::BuiltInType::NONE;
         }
     }
 
@@ -314,48 +426,17 @@ public:
 }
 
 
-    ast::BuiltInType visit(ast::If& node) override {
-        //std::cout << "Analyzing If node" << std::endl;
-        if (node.condition->accept(*this) != ast::BuiltInType::BOOL)
-            output::errorMismatch( node.condition->line);
-        sym_table.enterScope(ScopeType::IF,  node.condition->get_symbols());
-        //if (node.then->is_scope)
-          //  sym_table.enterScope(ScopeType::COND);
-        node.then->accept(*this);
-       // if (node.then->is_scope)
-         //   sym_table.exitScope();
-        sym_table.exitScope();
-        if (node.otherwise != nullptr)
-        {
-            sym_table.enterScope(ScopeType::IF, node.condition->get_symbols());
-            //if (node.otherwise->is_scope)
-                //sym_table.enterScope(ScopeType::COND);
-            node.otherwise->accept(*this);
-           // if (node.otherwise->is_scope)
-             //   sym_table.exitScope();
-            sym_table.exitScope();
-        }
-        //sym_table.exitScope();
-        //std::cout << "Analyzing If node DoNe" << std::endl;
+    ast::BuiltInType visit(ast::If& node) {
+        checkStatement(node);
         return  ast::BuiltInType::NONE;
     }
 
-    ast::BuiltInType visit(ast::While& node) override { //scope printer
-        //std::cout << "Analyzing While node" << std::endl;
-        if (node.condition->accept(*this, nullptr) != ast::BuiltInType::BOOL)
-            output::errorMismatch( node.condition->line);
-        sym_table.enterScope(ScopeType::WHILE, node.condition->get_symbols());
-       // if (node.body->is_scope)
-         //   sym_table.enterScope(ScopeType::);
-        node.body->accept(*this);
-       // if (node.body->is_scope)
-         //   sym_table.exitScope();
-        sym_table.exitScope();
-        //std::cout << "Analyzing While node done!" << std::endl;
+    ast::BuiltInType visit(ast::While& node) {
+        checkStatement(node);
         return ast::BuiltInType::NONE;
     }
 
-    ast::BuiltInType visit(ast::VarDecl& node) override {
+    ast::BuiltInType visit(ast::VarDecl& node) {
         //sstd::cout << "\n=== Starting VarDecl Analysis ===" << std::endl;
         //sstd::cout << "Variable name: " << node.id->value << std::endl;
         // Get and print the declared type
@@ -366,155 +447,116 @@ public:
         if ((sym_table.currentScope->scopeType == ScopeType::WHILE ||
             sym_table.currentScope->scopeType == ScopeType::IF ||
             sym_table.currentScope->scopeType == ScopeType::INFUNC) && sym_table.currentScope->hasCondSymbol(node.id->value))
-            output::errorDef(node.line, node.id->value);
+            output::errorDef(node.offset, node.id->value);
 
         if (node.init_exp != nullptr) {
             //sstd::cout << "Has initialization expression" << std::endl;
-            int init_value = -8766;
+            Constant init_value;
 
             // Get the type and value of the initialization expression
-            ast::BuiltInType exp_type = node.init_exp->accept(*this, &init_value);
+            ast::BuiltInType exp_type = checkExp(*node.init_exp, &init_value);
             //sstd::cout << "Expression evaluated to:" << std::endl;
             //sstd::cout << "  Type: " << static_cast<int>(exp_type) << std::endl;
             //sstd::cout << "  Value: " << init_value << std::endl;
 
-            // Detailed type compatibility check
-            //sstd::cout << "\nType compatibility check:" << std::endl;
-            //sstd::cout << "1. Direct type match? " << (declared_type == exp_type ? "Yes" : "No") << std::endl;
-            if (declared_type == ast::BuiltInType::BYTE && exp_type == ast::BuiltInType::INT && init_value ==-8766)
-                output::errorMismatch(node.line);
-            if (declared_type == ast::BuiltInType::BYTE && (exp_type == ast::BuiltInType::INT))
-                int useless = convert_int_to_byte(init_value, node.line);
-            if (declared_type == ast::BuiltInType::BYTE && (exp_type == ast::BuiltInType::BYTE && init_value !=-8766 ))
-                int useless = convert_int_to_byte(init_value, node.line);
-            if (declared_type == ast::BuiltInType::INT) {
-                //sstd::cout << "2. Assigning to INT:" << std::endl;
-                if (exp_type == ast::BuiltInType::BYTE) {
-                    //sstd::cout << "   BYTE->INT conversion allowed" << std::endl;
-                } else if (exp_type == ast::BuiltInType::INT) {
-                    //sstd::cout << "   INT->INT assignment allowed" << std::endl;
-                } else {
-                    //sstd::cout << "   Invalid type for INT assignment" << std::endl;
-                    output::errorMismatch(node.line);
-                    return ast::BuiltInType::NONE;
-                }
-            }
-            else if (declared_type == ast::BuiltInType::BYTE) {
-                //sstd::cout << "2. Assigning to BYTE:" << std::endl;
-                if (exp_type == ast::BuiltInType::BYTE) {
-                    //sstd::cout << "   BYTE->BYTE assignment allowed" << std::endl;
-                } else if (exp_type == ast::BuiltInType::INT) {
-                    //sstd::cout << "   Attempting INT->BYTE conversion" << std::endl;
-                    
-                        output::errorMismatch(node.line);
-                        init_value = convert_int_to_byte(init_value, node.line);
-                        //sstd::cout << "   Conversion successful" << std::endl;
-                  
-                } else {
-                    //sstd::cout << "   Invalid type for BYTE assignment" << std::endl;
-                    output::errorMismatch(node.line);
-                    return ast::BuiltInType::NONE;
-                }
-            }
-            else if(is_num_type(declared_type) == false || is_num_type(exp_type) == false)
-        {
-            if(exp_type != declared_type)
-                output::errorMismatch(node.line);
-        }
+            // An int literal that does not fit a byte is reported as such, before the mismatch
+            if (types::narrowing(declared_type, exp_type) && init_value.known)
+                convert_int_to_byte(init_value.value, node.offset);
+            if (!types::assignable(declared_type, exp_type))
+                output::errorMismatch(node.offset);
         }
         // If we got here, types are compatible
         if(sym_table.insertSymbol(node.id->value, declared_type) == false)
-            output::errorDef(node.line, node.id->value);
+            output::errorDef(node.offset, node.id->value);
         //sstd::cout << "=== Successfully completed VarDecl Analysis ===" << std::endl;
 
         return ast::BuiltInType::NONE;
     }
 
-    ast::BuiltInType visit(ast::Assign& node) override {
+    ast::BuiltInType visit(ast::Assign& node) {
         //sstd::cout << "Analyzing Assign node" << std::endl;
-        int exp_val = -8754;
-        ast::BuiltInType dest_type = node.id->accept(*this, nullptr);
-        ast::BuiltInType src_type= node.exp->accept(*this, &exp_val);
+        Constant exp_val;
+        ast::BuiltInType dest_type = checkExp(*node.id, nullptr);
+        ast::BuiltInType src_type= checkExp(*node.exp, &exp_val);
 
-        if((!(is_num_type(dest_type) && is_num_type(src_type)) && dest_type != src_type) || dest_type == ast::BuiltInType::NONE)
-            output::errorMismatch(node.line);
-        
-        if(dest_type == ast::BuiltInType::BYTE && src_type == ast::BuiltInType::INT )
-            output::errorMismatch(node.line);
+        if (!types::assignable(dest_type, src_type))
+            output::errorMismatch(node.offset);
 
         return ast::BuiltInType::NONE;
     }
 
-    ast::BuiltInType visit(ast::Formal& node) override {
+    ast::BuiltInType visit(ast::Formal& node) {
         //sstd::cout << "Analyzing Formal node" << std::endl;
         if (sym_table.currentScope->hasSymbol(node.id->value))
-            output::errorDef(node.line, node.id->value);
+            output::errorDef(node.offset, node.id->value);
 
         return visit(*node.type);
         //sstd::cout << "Analyzing Formal node" << std::endl;
     }
 
-    ast::BuiltInType visit(ast::Formals& node, std::vector<ast::BuiltInType>* params_type,std::vector<std::string>* params_name )  {
+    ast::BuiltInType visit(ast::Formals& node, Params& params) {
         //sstd::cout << "Analyzing Formals node" << std::endl;
-        for (auto formal : node.formals)
+        for (auto& formal : node.formals)
         {
-            params_type->push_back(formal->type->type);
-            params_name->push_back(formal->id->value);
+            params.types.push_back(formal->type->type);
+            params.names.push_back(formal->id->value);
         }
 
         return ast::BuiltInType::NONE;
     }
 
 
-    ast::BuiltInType visit(ast::FuncDecl& node) override {
+    ast::BuiltInType visit(ast::FuncDecl& node) {
         //std::cout << "Analyzing FuncDecl node " << node.id->value << std::endl;
-        std::vector<ast::BuiltInType> params_type;
-        std::vector<std::string> params_name;
-        visit(*node.formals, &params_type, &params_name);
-        sym_table.enterScope(ScopeType::FUNC, params_type, params_name , node.return_type->type);
+        Params params;
+        visit(*node.formals, params);
+        sym_table.enterScope(ScopeType::FUNC, params.types, params.names, node.return_type->type);
         visit (*node.body);
         sym_table.exitScope();
         return  ast::BuiltInType::NONE;
     }
 
 
-    ast::BuiltInType visit(ast::Funcs& node) override {
-        // Iterate over each function in the node and register them
-        for (auto& func : node.funcs) {
-            // Check if the function is already defined
-            if (sym_table.isFunctionDefined(func->id->value)) {
-                // Output error for redefined function, using the correct line
-                output::errorDef(func->id->line, func->id->value);  // Ensure func->line is correct here
-            }
-
-            // Check for duplicate variable names within the function parameters
-            std::unordered_map<std::string, int> paramNames;
-            bool hasDuplicate = false;
-            std::string duplicateVarName;
+    /* Registers the signature of a function, in source order.
+     * Needs only the functions before it, so compileStream calls it while the rest is being parsed.
+     */
+    void declare(ast::FuncDecl& func) {
+        // Check if the function is already defined
+        if (sym_table.isFunctionDefined(func.id->value)) {
+            // Output error for redefined function, using the correct line
+            output::errorDef(func.id->offset, func.id->value);  // Ensure func->offset is correct here
+        }
 
-            for (auto& param : func->formals->formals) {
-                const std::string& paramName = param->id->value;
-                paramNames[paramName]++;
+        // Check for duplicate variable names within the function parameters
+        std::unordered_map<std::string, int> paramNames;
+        bool hasDuplicate = false;
+        std::string duplicateVarName;
 
-                // If count exceeds 1, it's a duplicate
-                if (paramNames[paramName] > 1) {
-                    hasDuplicate = true;
-                    duplicateVarName = paramName;  // Store the name of the duplicated variable
-                    break;
-                }
-            }
-            if (func->id->value == "main" && !paramNames.empty())
-                output::errorMainMissing();
+        for (auto& param : func.formals->formals) {
+            const std::string& paramName = param->id->value;
+            paramNames[paramName]++;
 
-            // If duplicates were found, print the name of the duplicate variable
-            if (hasDuplicate) {
-                output::errorDef(func->id->line, duplicateVarName); // Correct the line number issue here
+            // If count exceeds 1, it's a duplicate
+            if (paramNames[paramName] > 1) {
+                hasDuplicate = true;
+                duplicateVarName = paramName;  // Store the name of the duplicated variable
+                break;
             }
+        }
+        if (func.id->value == "main" && !paramNames.empty())
+            output::errorMainMissing();
 
-            // Register the function after checking for duplicates
-            register_func(*func);
+        // If duplicates were found, print the name of the duplicate variable
+        if (hasDuplicate) {
+            output::errorDef(func.id->offset, duplicateVarName); // Correct the line number issue here
         }
 
+        // Register the function after checking for duplicates
+        register_func(func);
+    }
+
+    // Checks of the declarations that need every signature, after declare was called for all functions
+    void finishDeclarations(ast::Funcs& node) {
         // Ensure that 'main' function is defined and is void
         //std::cout << sym_table.getFunctionSymbol("main").type << std::endl;
         if (!sym_table.isFunctionDefined("main") || sym_table.getFunctionSymbol("main").type != ast::BuiltInType::VOID ) {
@@ -527,32 +569,107 @@ public:
                 const std::string& paramName = param->id->value;
                 // If the parameter name is already a function name, output an error
                 if (sym_table.isFunctionDefined(paramName)) {
-                    output::errorDef(func->id->line, paramName);  // line number issue...!!!
+                    output::errorDef(func->id->offset, paramName);  // line number issue...!!!
                 }
             }
         }
+    }
 
+    // Checks the function bodies, once finishDeclarations passed
+    void checkBodies(ast::Funcs& node) {
         // Visit each function again (recursive call)
+        std::string signature_key;
+        if (cache != nullptr)
+            signature_key = AnalysisCache::signatureKey(sym_table.globalFunctionRegistry);
         for (auto& func : node.funcs) {
+            trace::Span span("function", func->id->value);
+            if (cache == nullptr) {
+                visit(*func);
+                continue;
+            }
+            output::ScopePrinter &printer = sym_table.global->scopePrinter;
+            std::string key = AnalysisCache::functionKey(*func, signature_key, *literals);
+            std::string block;
+            auto start = std::chrono::steady_clock::now();
+            if (cache->lookup(key, block)) {
+                printer.replay(block);
+                cache->replayed(std::chrono::duration_cast<std::chrono::microseconds>(
+                        std::chrono::steady_clock::now() - start).count());
+                continue;
+            }
+            printer.beginCapture();
             visit(*func);
+            block = printer.endCapture();
+            cache->store(key, block, std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - start).count());
         }
+    }
 
-        // Print the symbol table state
-        std::cout << sym_table.global->scopePrinter << std::endl;
-
+    ast::BuiltInType visit(ast::Funcs& node) {
+        // Iterate over each function in the node and register them
+        for (auto& func : node.funcs)
+            declare(*func);
+        finishDeclarations(node);
+        checkBodies(node);
         return ast::BuiltInType::NONE;
     }
 
+private:
+    struct ExpWork {
+        ast::Exp* exp;
+        bool wants_constant;
+        bool expanded;
+        size_t operands;    // where the operands' results start on operand_stack
+    };
+
+    // Work and results of checkExp, kept between calls to reuse their storage
+    std::vector<ExpWork> exp_work;
+    std::vector<Operand> operand_stack;
+
+    void pushOperands(ast::Exp& exp, bool wants_constant) {
+        switch (exp.kind) {
+            case ast::NodeKind::BinOp:
+                pushOperand(static_cast<ast::BinOp&>(exp).right, wants_constant);
+                pushOperand(static_cast<ast::BinOp&>(exp).left, wants_constant);
+                break;
+            case ast::NodeKind::RelOp:
+                pushOperand(static_cast<ast::RelOp&>(exp).right, wants_constant);
+                pushOperand(static_cast<ast::RelOp&>(exp).left, wants_constant);
+                break;
+            case ast::NodeKind::And:
+                pushOperand(static_cast<ast::And&>(exp).right, wants_constant);
+                pushOperand(static_cast<ast::And&>(exp).left, wants_constant);
+                break;
+            case ast::NodeKind::Or:
+                pushOperand(static_cast<ast::Or&>(exp).right, wants_constant);
+                pushOperand(static_cast<ast::Or&>(exp).left, wants_constant);
+                break;
+            case ast::NodeKind::Not:
+                pushOperand(static_cast<ast::Not&>(exp).exp, wants_constant);
+                break;
+            case ast::NodeKind::Cast:
+                pushOperand(static_cast<ast::Cast&>(exp).exp, wants_constant);
+                break;
+            case ast::NodeKind::Call: {
+                auto& args = static_cast<ast::Call&>(exp).args->exps;
+                for (auto it = args.rbegin(); it != args.rend(); ++it)
+                    pushOperand(*it, wants_constant);
+                break;
+            }
+            default:
+                break;
+        }
+    }
 
-
-
-
+    void pushOperand(const std::shared_ptr<ast::Exp>& operand, bool wants_constant) {
+        exp_work.push_back({operand.get(), wants_constant, false, 0});
+    }
 };
 
-static int convert_int_to_byte (int num, int line)
+static int convert_int_to_byte (int num, source::Offset offset)
 {
     if (num > 255 || num < 0)
-        output::errorByteTooLarge(line, num);
+        output::errorByteTooLarge(offset, num);
     return num;
 }
 
@@ -560,22 +677,6 @@ static bool is_num_type (ast::BuiltInType type) {
     return type == ast::BuiltInType::INT || type == ast::BuiltInType::BYTE;
 }
 
-static bool compare_exp_list(std::vector<ast::BuiltInType>& paramTypesDecl, std::vector<ast::BuiltInType>& paramTypesCall) {
-    bool is_legal = false;
-    if (paramTypesCall.size() == paramTypesDecl.size()) {
-        is_legal = true;
-        for (int i = 0; i < paramTypesDecl.size() && is_legal; i++) {
-            // Check if one is 'int' and the other is 'byte' and allow the comparison to succeed
-            if ((paramTypesDecl[i] == ast::BuiltInType::INT && paramTypesCall[i] == ast::BuiltInType::BYTE) ||
-                (paramTypesDecl[i] == ast::BuiltInType::BYTE && paramTypesCall[i] == ast::BuiltInType::INT)) {
-                continue;  // Treat as equal
-            }
-            // Otherwise, check if the types are exactly equal
-            is_legal = paramTypesCall[i] == paramTypesDecl[i];
-        }
-    }
-    return is_legal;
-}
 
 
 std::string builtInTypeToString(const ast::BuiltInType &type) {
@@ -0,0 +1,166 @@
+#include "Server.hpp"
+#include "Compiler.hpp"
+#include "Protocol.hpp"
+#include "Trace.hpp"
+#include <cerrno>
+#include <csignal>
+#include <pthread.h>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/* The signal handler writes to stop_pipe, the accepting thread polls its read end next to the
+ * listener, so a signal arriving just before accept still wakes it up.
+ */
+static int stop_pipe[2] = {-1, -1};
+
+static void requestStop(int) {
+    int saved = errno;
+    ssize_t ignored = write(stop_pipe[1], "", 1);
+    (void) ignored;
+    errno = saved;
+}
+
+CompileServer::CompileServer(const std::string &path, int workers)
+        : path(path), worker_count(workers > 0 ? workers : 1), stopping(false) {}
+
+int CompileServer::run() {
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        std::cerr << "hw3: socket path too long: " << path << std::endl;
+        return 1;
+    }
+    strcpy(address.sun_path, path.c_str());
+
+    // A socket left by an earlier server is replaced, any other file at path is kept
+    struct stat existing;
+    if (lstat(path.c_str(), &existing) == 0) {
+        if (!S_ISSOCK(existing.st_mode)) {
+            std::cerr << "hw3: cannot listen on " << path << ": not a socket" << std::endl;
+            return 1;
+        }
+        unlink(path.c_str());
+    }
+
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0 || bind(listener, (struct sockaddr *) &address, sizeof(address)) < 0 ||
+        listen(listener, SOMAXCONN) < 0) {
+        std::cerr << "hw3: cannot listen on " << path << ": " << strerror(errno) << std::endl;
+        if (listener >= 0)
+            close(listener);
+        return 1;
+    }
+
+    if (pipe(stop_pipe) < 0) {
+        std::cerr << "hw3: cannot create a pipe: " << strerror(errno) << std::endl;
+        close(listener);
+        return 1;
+    }
+    fcntl(stop_pipe[1], F_SETFL, O_NONBLOCK);
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = requestStop;
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+    signal(SIGPIPE, SIG_IGN);
+
+    // Workers start with the signals blocked, so they are delivered to the accepting thread
+    sigset_t signals, previous;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, &previous);
+    for (int i = 0; i < worker_count; i++)
+        workers.emplace_back(&CompileServer::work, this, i);
+    pthread_sigmask(SIG_SETMASK, &previous, nullptr);
+    std::cerr << "hw3: serving on " << path << " with " << worker_count << " workers" << std::endl;
+
+    struct pollfd ready[2] = {{listener, POLLIN, 0}, {stop_pipe[0], POLLIN, 0}};
+    while (true) {
+        if (poll(ready, 2, -1) < 0) {
+            if (errno == EINTR)
+                continue;
+            std::cerr << "hw3: poll failed: " << strerror(errno) << std::endl;
+            break;
+        }
+        if (ready[1].revents != 0)
+            break;
+        if (ready[0].revents == 0)
+            continue;
+        int fd = accept(listener, nullptr, nullptr);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+            std::cerr << "hw3: accept failed: " << strerror(errno) << std::endl;
+            break;
+        }
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        connections.push(fd);
+        queue_ready.notify_one();
+    }
+
+    {
+        // Workers waiting for the next request of a connection read an end of file instead, the
+        // requests already sent are still answered
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        stopping = true;
+        for (int fd : open_connections)
+            shutdown(fd, SHUT_RD);
+        queue_ready.notify_all();
+    }
+    for (auto &worker : workers)
+        worker.join();
+    close(listener);
+    close(stop_pipe[0]);
+    close(stop_pipe[1]);
+    unlink(path.c_str());
+    return 0;
+}
+
+void CompileServer::work(int index) {
+    trace::nameThread("server worker " + std::to_string(index + 1));
+    while (true) {
+        int fd;
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex);
+            queue_ready.wait(lock, [this] { return stopping || !connections.empty(); });
+            if (connections.empty())
+                return;
+            fd = connections.front();
+            connections.pop();
+            // Accepted before the stop, it is drained like the connections being served
+            if (stopping)
+                shutdown(fd, SHUT_RD);
+            open_connections.insert(fd);
+        }
+        serve(fd);
+        {
+            // Unregistered before the descriptor can be reused
+            std::lock_guard<std::mutex> lock(queue_mutex);
+            open_connections.erase(fd);
+        }
+        close(fd);
+    }
+}
+
+void CompileServer::serve(int fd) {
+    protocol::FrameReader reader(fd);
+    std::string source;
+    while (reader.readFrame(source)) {
+        trace::Span span("request", "compile");
+        fanc::Result result = fanc::compile(source.data(), source.size());
+        // The same text hw3 prints for this source
+        std::string output = result.ok() ? result.scopes + "\n" : "";
+        std::string diagnostic = result.ok() ? "" : result.diagnostics.front().message + "\n";
+        if (!protocol::writeAll(fd, protocol::frame(output) + protocol::frame(diagnostic)))
+            return;
+    }
+}
@@ -0,0 +1,44 @@
+#ifndef SERVER_HPP
+#define SERVER_HPP
+
+#include <condition_variable>
+#include <mutex>
+#include <queue>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+/* The long running compiler behind hw3 --serve.
+ * Listens on a Unix domain socket and hands every accepted connection to a pool of worker
+ * threads. A worker answers the requests of its connection (see Protocol.hpp) until the client
+ * closes it. fanc::compile serialises parsing, the workers overlap the analysis, reading
+ * requests, writing responses and waiting on clients.
+ * SIGINT and SIGTERM stop accepting, finish the open connections and remove the socket. An open
+ * connection is finished by answering the requests its client already sent: the server shuts
+ * down its reading side, so a worker waiting on an idle client does not hold up the exit.
+ */
+class CompileServer {
+public:
+    CompileServer(const std::string &path, int workers);
+
+    // Serves until stopped, returns the process exit code
+    int run();
+
+private:
+    std::string path;
+    int worker_count;
+    std::vector<std::thread> workers;
+    std::queue<int> connections;
+    // Connections being served, under queue_mutex
+    std::set<int> open_connections;
+    std::mutex queue_mutex;
+    std::condition_variable queue_ready;
+    bool stopping;
+
+    void work(int index);
+
+    void serve(int fd);
+};
+
+#endif //SERVER_HPP
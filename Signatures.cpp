@@ -0,0 +1,50 @@
+#include "Signatures.hpp"
+#include "Memory.hpp"
+#include <utility>
+
+namespace signatures {
+    Signature::Signature(Interner *interner, uint32_t id, std::vector<ast::BuiltInType> types,
+                         const Signature *widened)
+            : id(id), types(std::move(types)), widened(widened != nullptr ? widened : this), interner(interner) {
+        for (auto &link : next)
+            link.store(nullptr, std::memory_order_relaxed);
+    }
+
+    Interner::Interner() {
+        MEMORY_TAG(memory::SCOPES);
+        root = create({}, nullptr);
+    }
+
+    const Signature *Interner::create(std::vector<ast::BuiltInType> types, const Signature *widened) {
+        lists.emplace_back(new Signature(this, (uint32_t) lists.size(), std::move(types), widened));
+        return lists.back().get();
+    }
+
+    const Signature *Signature::extend(ast::BuiltInType type) const {
+        std::atomic<const Signature *> &link = next[type + 1];
+        const Signature *found = link.load(std::memory_order_acquire);
+        if (found != nullptr)
+            return found;
+        // Before taking the lock, the widened list may have to be created as well
+        const Signature *widened_list = nullptr;
+        if (type == ast::BuiltInType::BYTE || widened != this)
+            widened_list = widened->extend(type == ast::BuiltInType::BYTE ? ast::BuiltInType::INT : type);
+        MEMORY_TAG(memory::SCOPES);
+        std::lock_guard<std::mutex> lock(interner->create_mutex);
+        found = link.load(std::memory_order_relaxed);
+        if (found == nullptr) {
+            std::vector<ast::BuiltInType> extended = types;
+            extended.push_back(type);
+            found = interner->create(std::move(extended), widened_list);
+            link.store(found, std::memory_order_release);
+        }
+        return found;
+    }
+
+    const Signature *Interner::intern(const std::vector<ast::BuiltInType> &types) const {
+        const Signature *signature = root;
+        for (auto type : types)
+            signature = signature->extend(type);
+        return signature;
+    }
+}
@@ -0,0 +1,78 @@
+#ifndef SIGNATURES_HPP
+#define SIGNATURES_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "visitor.hpp"
+
+/* Interned parameter lists.
+ * Every distinct list of parameter types exists once, functions declared with the same list
+ * share it (Symbol::params). The lists form a trie: a list is its prefix extended by one type,
+ * so the argument types of a call are interned one argument at a time, without building a
+ * vector, and a call whose arguments have exactly the parameter types is checked by comparing
+ * two pointers. The analyzer has always let an INT argument pass for a BYTE parameter and the
+ * other way round, so every list also knows its widened form, the list with each BYTE made an
+ * INT, and two lists with the same widened form are compatible: a second pointer comparison.
+ * The lists of a compile belong to its Interner, which the SymbolTable creates and the
+ * fanc::Result keeps, so a server or batch run frees them with each compile. Lists never move
+ * while their Interner lives, looking one up takes no lock, creating one is serialised by a mutex.
+ */
+namespace signatures {
+    class Interner;
+
+    class Signature {
+    public:
+        // Numbered in creation order, the empty list is 0
+        const uint32_t id;
+        const std::vector<ast::BuiltInType> types;
+        // The list with every BYTE made an INT, this list itself when it has no BYTE
+        const Signature *const widened;
+        // Where this list and its extensions live
+        Interner *const interner;
+
+        // The list of these types followed by type
+        const Signature *extend(ast::BuiltInType type) const;
+
+        // True when a call with arguments of the types of args matches these parameters
+        bool accepts(const Signature *args) const {
+            return args == this || args->widened == widened;
+        }
+
+    private:
+        // NONE to STRING
+        static const int TYPE_COUNT = ast::BuiltInType::STRING + 2;
+
+        mutable std::atomic<const Signature *> next[TYPE_COUNT];
+
+        Signature(Interner *interner, uint32_t id, std::vector<ast::BuiltInType> types, const Signature *widened);
+
+        friend class Interner;
+    };
+
+    class Interner {
+    public:
+        Interner();
+        Interner(const Interner &) = delete;
+        Interner &operator=(const Interner &) = delete;
+
+        // The list without parameters, where every other list is extended from
+        const Signature *empty() const { return root; }
+
+        const Signature *intern(const std::vector<ast::BuiltInType> &types) const;
+
+    private:
+        // Guards the creation of lists, lookups only read the atomic links
+        mutable std::mutex create_mutex;
+        std::vector<std::unique_ptr<Signature>> lists;
+        const Signature *root;
+
+        const Signature *create(std::vector<ast::BuiltInType> types, const Signature *widened);
+
+        friend class Signature;
+    };
+}
+
+#endif //SIGNATURES_HPP
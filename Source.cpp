@@ -0,0 +1,18 @@
+#include "Source.hpp"
+#include <algorithm>
+
+namespace source {
+    thread_local Offset node_start = 0;
+
+    Position LineTable::position(Offset offset) const {
+        size_t line = std::upper_bound(starts.begin(), starts.end(), offset) - starts.begin();
+        return {(int) line, (int) (offset - starts[line - 1]) + 1};
+    }
+
+    LineTable LineTable::of(const std::string &text) {
+        LineTable lines;
+        for (size_t i = text.find('\n'); i != std::string::npos; i = text.find('\n', i + 1))
+            lines.addLine((Offset) (i + 1));
+        return lines;
+    }
+}
@@ -0,0 +1,51 @@
+#ifndef SOURCE_HPP
+#define SOURCE_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/* Locations in the source text.
+ * A node keeps only the byte offset where it starts (ast::Node::offset), 4 bytes. The scanner
+ * records where every line starts into a LineTable as it reads the input, the line and column
+ * of an offset are looked up there when a diagnostic or report is printed.
+ * Offsets of the parser are the start of a rule's first token (YYLLOC_DEFAULT in parser.y), so a
+ * statement spanning lines is located at its first line and not where its lookahead was read.
+ */
+namespace source {
+    typedef uint32_t Offset;
+
+    // Offset of errors about the whole program
+    const Offset NOWHERE = UINT32_MAX;
+
+    struct Position {
+        int line;       // from 1
+        int column;     // from 1, in bytes
+    };
+
+    class LineTable {
+    public:
+        // The first line starts at offset 0
+        LineTable() : starts(1, 0) {};
+
+        // Records the line starting at offset, after the last one recorded
+        void addLine(Offset offset) { starts.push_back(offset); }
+
+        Position position(Offset offset) const;
+
+        int line(Offset offset) const { return position(offset).line; }
+
+        // Table of a whole text, for the parses that are not given one (IncrementalParser)
+        static LineTable of(const std::string &text);
+
+    private:
+        std::vector<Offset> starts;
+    };
+
+    /* Where the nodes built on this thread start: the token the scanner matched last, or the
+     * rule the parser reduces. The two run on different threads under pipeline::parse.
+     */
+    extern thread_local Offset node_start;
+}
+
+#endif //SOURCE_HPP
@@ -0,0 +1,176 @@
+#include "Specializer.hpp"
+#include "AstUtils.hpp"
+#include "CodeGen.hpp"
+#include "ConstFold.hpp"
+#include <iomanip>
+#include <unordered_set>
+
+static std::string literalToString(const std::shared_ptr<ast::Exp> &exp) {
+    if (auto boolean = ast::cast<ast::Bool>(exp))
+        return boolean->value ? "true" : "false";
+    if (ast::cast<ast::NumB>(exp))
+        return std::to_string(ConstantFolder::literalValue(exp)) + "b";
+    return std::to_string(ConstantFolder::literalValue(exp));
+}
+
+Specializer::Specializer(std::unordered_map<std::string, Symbol> &functions, int max_growth_percent)
+        : functions(functions), max_growth_percent(max_growth_percent), size_before(0), size_added(0) {}
+
+void Specializer::run(ast::Funcs &program) {
+    std::unordered_map<std::string, int> call_sites;
+    for (auto &func : program.funcs) {
+        bodies[func->id->value] = func;
+        origin[func->id->value] = func->id->value;
+        size_before += ast::countNodes(func);
+        ast::forEachCall(func->body, [&call_sites](ast::Call &call) { call_sites[call.func_id->value]++; });
+    }
+
+    // Clones are appended to the program, so their own calls are specialised in turn
+    for (size_t i = 0; i < program.funcs.size(); i++) {
+        std::shared_ptr<ast::FuncDecl> func = program.funcs[i];
+        const std::string caller = func->id->value;
+        ast::forEachCall(func->body, [this, &program, &caller](ast::Call &call) {
+            specializeCall(call, program, caller);
+        });
+    }
+
+    // Functions whose every call site now goes to a clone are no longer needed
+    std::unordered_map<std::string, int> remaining;
+    for (auto &func : program.funcs)
+        ast::forEachCall(func->body, [&remaining](ast::Call &call) { remaining[call.func_id->value]++; });
+    std::vector<std::shared_ptr<ast::FuncDecl>> kept;
+    for (auto &func : program.funcs) {
+        const std::string &name = func->id->value;
+        if (name != "main" && call_sites[name] > 0 && remaining[name] == 0) {
+            removed.push_back(name);
+            size_added -= ast::countNodes(func);
+        } else {
+            kept.push_back(func);
+        }
+    }
+    program.funcs = kept;
+}
+
+void Specializer::specializeCall(ast::Call &call, ast::Funcs &program, const std::string &caller) {
+    const std::string callee = call.func_id->value;
+    // A clone calling its own origin would unroll recursion one level per constant
+    if (!bodies.count(callee) || origin[caller] == origin[callee])
+        return;
+    auto &args = call.args->exps;
+    std::vector<bool> is_constant;
+    bool any_constant = false;
+    std::string key = callee + "(";
+    for (size_t i = 0; i < args.size(); i++) {
+        is_constant.push_back(ConstantFolder::isLiteral(args[i]));
+        any_constant = any_constant || is_constant.back();
+        key += (i ? ", " : "") + (is_constant.back() ? literalToString(args[i]) : "_");
+    }
+    key += ")";
+    if (!any_constant)
+        return;
+
+    auto it = clone_of_key.find(key);
+    int index = it != clone_of_key.end() ? it->second : makeClone(key, callee, is_constant, args, program);
+    if (index < 0)
+        return;
+    Clone &clone = clones[index];
+    clone.call_sites++;
+    call.func_id->value = clone.name;
+    std::vector<std::shared_ptr<ast::Exp>> kept;
+    for (size_t i = 0; i < args.size(); i++)
+        if (!is_constant[i])
+            kept.push_back(args[i]);
+    args = kept;
+}
+
+int Specializer::makeClone(const std::string &key, const std::string &callee, const std::vector<bool> &is_constant,
+                           const std::vector<std::shared_ptr<ast::Exp>> &args, ast::Funcs &program) {
+    const auto &original = bodies[callee];
+    std::string name = callee + "$" + std::to_string(clones.size() + 1);
+    auto body = ast::cast<ast::Statements>(ast::cloneStatement(original->body, {}));
+    auto formals = std::make_shared<ast::Formals>();
+    formals->offset = original->formals->offset;
+
+    std::unordered_set<std::string> assigned;
+    ast::forEachAssign(body, [&assigned](ast::Assign &assign) { assigned.insert(assign.id->value); });
+    std::unordered_map<std::string, std::shared_ptr<ast::Exp>> constants;
+    std::vector<std::shared_ptr<ast::Statement>> prologue;
+    std::vector<ast::BuiltInType> param_types;
+    for (size_t i = 0; i < is_constant.size(); i++) {
+        const auto &formal = original->formals->formals[i];
+        ast::BuiltInType type = formal->type->type;
+        if (!is_constant[i]) {
+            auto copy = std::make_shared<ast::Formal>(ast::makeId(formal->id->value, formal->id->offset),
+                                                      ast::makeType(type, formal->type->offset));
+            copy->offset = formal->offset;
+            formals->push_back(copy);
+            param_types.push_back(type);
+            continue;
+        }
+        // Passing an int literal to a byte parameter truncates it, the literal is converted the same way
+        auto literal = ConstantFolder::makeLiteral(type, ConstantFolder::literalValue(args[i]), formal->offset);
+        if (assigned.count(formal->id->value)) {
+            auto decl = std::make_shared<ast::VarDecl>(ast::makeId(formal->id->value, formal->offset),
+                                                       ast::makeType(type, formal->offset), literal);
+            decl->offset = formal->offset;
+            prologue.push_back(decl);
+        } else {
+            constants[formal->id->value] = literal;
+        }
+    }
+    body->statements.insert(body->statements.begin(), prologue.begin(), prologue.end());
+
+    auto clone = std::make_shared<ast::FuncDecl>(ast::makeId(name, original->id->offset),
+                                                 ast::makeType(original->return_type->type,
+                                                               original->return_type->offset),
+                                                 formals, body);
+    clone->offset = original->offset;
+    ConstantFolder folder;
+    folder.run(*clone, constants);
+
+    // The clone only pays off if folding leaves less code than the generic version
+    CodeGen code_gen(functions);
+    int instructions_before = ir::countCode(code_gen.lower(*original)).instructions;
+    int instructions_after = ir::countCode(code_gen.lower(*clone)).instructions;
+    int clone_size = ast::countNodes(clone);
+    if (instructions_after >= instructions_before) {
+        skipped.push_back(key + ": nothing folds");
+        clone_of_key[key] = -1;
+        return -1;
+    }
+    if (size_added + clone_size > size_before * max_growth_percent / 100) {
+        skipped.push_back(key + ": over the growth budget");
+        clone_of_key[key] = -1;
+        return -1;
+    }
+
+    size_added += clone_size;
+    functions[name] = Symbol(name, original->return_type->type, functions.at(callee).params->interner->intern(param_types));
+    program.push_back(clone);
+    bodies[name] = clone;
+    origin[name] = origin[callee];
+    Clone record = {name, callee, key, 0, folder.folded_branches, instructions_before, instructions_after};
+    clones.push_back(record);
+    clone_of_key[key] = (int) clones.size() - 1;
+    return clone_of_key[key];
+}
+
+void Specializer::printReport(std::ostream &os) const {
+    os << "---specialization report---" << std::endl;
+    int folded = 0, instructions_removed = 0;
+    for (auto &clone : clones) {
+        os << clone.name << " = " << clone.constants << ": " << clone.call_sites << " call sites, "
+           << clone.folded_branches << " branches folded, " << clone.instructions_before << " -> "
+           << clone.instructions_after << " instructions" << std::endl;
+        folded += clone.folded_branches;
+        instructions_removed += clone.instructions_before - clone.instructions_after;
+    }
+    for (auto &reason : skipped)
+        os << "kept " << reason << std::endl;
+    for (auto &name : removed)
+        os << "removed " << name << ": every call site was specialised" << std::endl;
+    double growth = size_before == 0 ? 0 : 100.0 * size_added / size_before;
+    os << clones.size() << " clones, " << folded << " branches folded, " << instructions_removed
+       << " instructions removed, size " << size_before << " -> " << size_before + size_added << " nodes ("
+       << std::showpos << std::fixed << std::setprecision(1) << growth << "%)" << std::noshowpos << std::endl;
+}
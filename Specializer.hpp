@@ -0,0 +1,56 @@
+#ifndef SPECIALIZER_HPP
+#define SPECIALIZER_HPP
+
+#include <iostream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "nodes.hpp"
+#include "SymbolTable.hpp"
+
+/* Interprocedural constant propagation by function specialisation.
+ * A call that passes literals creates a clone of the callee, named callee$N, in which those
+ * parameters are replaced by their values and the body is constant folded. The clone is kept
+ * only if it lowers to fewer instructions than the callee, and call sites with the same
+ * constant arguments share it.
+ * Clones are added to the function registry so later passes and CodeGen treat them as regular
+ * functions. Callees left without callers are removed.
+ */
+class Specializer {
+public:
+    Specializer(std::unordered_map<std::string, Symbol> &functions, int max_growth_percent);
+
+    void run(ast::Funcs &program);
+
+    void printReport(std::ostream &os) const;
+
+private:
+    struct Clone {
+        std::string name;
+        std::string callee;
+        std::string constants;
+        int call_sites;
+        int folded_branches;
+        int instructions_before;
+        int instructions_after;
+    };
+
+    std::unordered_map<std::string, Symbol> &functions;
+    int max_growth_percent;
+    std::unordered_map<std::string, std::shared_ptr<ast::FuncDecl>> bodies;
+    std::unordered_map<std::string, std::string> origin;  // function each clone was made from
+    std::unordered_map<std::string, int> clone_of_key;    // -1 for keys that were not worth a clone
+    std::vector<Clone> clones;
+    std::vector<std::string> removed;
+    std::vector<std::string> skipped;
+    int size_before;
+    int size_added;
+
+    void specializeCall(ast::Call &call, ast::Funcs &program, const std::string &caller);
+
+    int makeClone(const std::string &key, const std::string &callee, const std::vector<bool> &is_constant,
+                  const std::vector<std::shared_ptr<ast::Exp>> &args, ast::Funcs &program);
+};
+
+#endif //SPECIALIZER_HPP
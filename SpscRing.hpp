@@ -0,0 +1,64 @@
+#ifndef SPSC_RING_HPP
+#define SPSC_RING_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+/* Bounded queue between exactly one producer thread and one consumer thread, without locks.
+ * The producer only writes tail and the consumer only writes head, each publishes its slots
+ * with a release store the other side reads with acquire. The indices sit on their own cache
+ * lines so the two threads do not invalidate each other's on every item.
+ * A full (or empty) ring is waited on by spinning briefly and then yielding, which keeps the
+ * hand-off cheap when both threads have a core and still lets the other run when they share one.
+ */
+template<typename T>
+class SpscRing {
+public:
+    // capacity is rounded up to a power of two
+    explicit SpscRing(size_t capacity) : head(0), tail(0) {
+        size_t size = 1;
+        while (size < capacity)
+            size *= 2;
+        slots.resize(size);
+        mask = size - 1;
+    }
+
+    // Moves item in, waiting for room. Gives up and returns false once *cancelled is set.
+    bool push(T &&item, const std::atomic<bool> *cancelled = nullptr) {
+        size_t own = tail.load(std::memory_order_relaxed);
+        for (int spins = 0; own - head.load(std::memory_order_acquire) == slots.size(); spins++) {
+            if (cancelled != nullptr && cancelled->load(std::memory_order_relaxed))
+                return false;
+            wait(spins);
+        }
+        slots[own & mask] = std::move(item);
+        tail.store(own + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Moves the oldest item out, waiting for one
+    void pop(T &item) {
+        size_t own = head.load(std::memory_order_relaxed);
+        for (int spins = 0; tail.load(std::memory_order_acquire) == own; spins++)
+            wait(spins);
+        item = std::move(slots[own & mask]);
+        head.store(own + 1, std::memory_order_release);
+    }
+
+private:
+    static const int SPINS = 64;
+
+    std::vector<T> slots;
+    size_t mask;
+    alignas(64) std::atomic<size_t> head;   // next slot to pop, written by the consumer
+    alignas(64) std::atomic<size_t> tail;   // next slot to push, written by the producer
+
+    static void wait(int spins) {
+        if (spins >= SPINS)
+            std::this_thread::yield();
+    }
+};
+
+#endif //SPSC_RING_HPP
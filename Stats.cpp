@@ -0,0 +1,166 @@
+#include "Stats.hpp"
+#include "AstUtils.hpp"
+#include <iomanip>
+#include <sys/resource.h>
+
+extern int yylex();
+extern YYSTYPE yylval;
+extern YYLTYPE yylloc;
+
+namespace stats {
+    static const char *PHASE_NAMES[PHASE_COUNT] = {"lex", "parse", "analysis", "print"};
+
+    thread_local Counters counters;
+    thread_local Report *current = nullptr;
+
+    double threadCpuMicros() {
+        struct timespec now;
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+        return now.tv_sec * 1e6 + now.tv_nsec / 1e3;
+    }
+
+    PhaseTimer::PhaseTimer(Report *report, Phase phase) : report(report), phase(phase), cpu_start(0) {
+        if (report == nullptr)
+            return;
+        wall_start = std::chrono::steady_clock::now();
+        cpu_start = threadCpuMicros();
+    }
+
+    PhaseTimer::~PhaseTimer() {
+        if (report == nullptr)
+            return;
+        report->phases[phase].wall_micros += std::chrono::duration<double, std::micro>(
+                std::chrono::steady_clock::now() - wall_start).count();
+        report->phases[phase].cpu_micros += threadCpuMicros() - cpu_start;
+    }
+
+    int lex(YYSTYPE *value, YYLTYPE *location) {
+        STATS_COUNT(tokens);
+        int token;
+        if (current == nullptr) {
+            token = yylex();
+        } else {
+            PhaseTimer timer(current, LEX);
+            token = yylex();
+        }
+        *value = std::move(yylval);
+        *location = yylloc;
+        return token;
+    }
+
+    void merge(const Counters &other) {
+        counters.tokens += other.tokens;
+        counters.scopes += other.scopes;
+        counters.symbol_lookups += other.symbol_lookups;
+        counters.lookup_steps += other.lookup_steps;
+        counters.lookup_max_depth = std::max(counters.lookup_max_depth, other.lookup_max_depth);
+        counters.allocations += other.allocations;
+        counters.allocated_bytes += other.allocated_bytes;
+    }
+
+    void snapshot(Report *report, Phase phase) {
+#ifdef FANC_MEMSTATS
+        if (report != nullptr)
+            report->memory[phase] = memory::usage();
+#endif
+    }
+
+    void finish(Report &report, const std::shared_ptr<ast::Node> &program, const literals::Pool *literals) {
+        report.counters = counters;
+        report.literals = literals != nullptr ? literals->count() : 0;
+        report.literal_bytes = literals != nullptr ? (long) literals->bytes() : 0;
+        report.nodes.clear();
+        ast::forEachNode(program, [&report](ast::Node &node) { report.nodes[ast::kindName(node)]++; });
+        struct rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        report.peak_rss_kb = usage.ru_maxrss;
+    }
+
+    static long totalNodes(const Report &report) {
+        long total = 0;
+        for (auto &kind : report.nodes)
+            total += kind.second;
+        return total;
+    }
+
+    void printTable(const Report &report, std::ostream &os) {
+        os << "---stats---" << std::endl;
+        os << std::left << std::setw(12) << "phase" << std::right << std::setw(12) << "wall ms"
+           << std::setw(12) << "cpu ms" << std::endl;
+        os << std::fixed << std::setprecision(3);
+        for (int phase = 0; phase < PHASE_COUNT; phase++)
+            os << std::left << std::setw(12) << PHASE_NAMES[phase] << std::right
+               << std::setw(12) << report.phases[phase].wall_micros / 1000
+               << std::setw(12) << report.phases[phase].cpu_micros / 1000 << std::endl;
+        os << "ast nodes: " << totalNodes(report) << std::endl;
+        for (auto &kind : report.nodes)
+            os << "  " << std::left << std::setw(12) << kind.first << std::right << std::setw(10) << kind.second
+               << std::endl;
+        os << "string literals: " << report.literals << " distinct (" << report.literal_bytes << " bytes)" << std::endl;
+#ifdef FANC_STATS
+        const Counters &c = report.counters;
+        os << "tokens: " << c.tokens << std::endl;
+        os << "scopes entered: " << c.scopes << std::endl;
+        os << "symbol lookups: " << c.symbol_lookups << ", scopes walked " << c.lookup_steps << " (avg "
+           << std::setprecision(2) << (c.symbol_lookups == 0 ? 0.0 : (double) c.lookup_steps / c.symbol_lookups)
+           << ", max " << c.lookup_max_depth << ")" << std::endl;
+        os << "allocations: " << c.allocations << " (" << c.allocated_bytes << " bytes)" << std::endl;
+#else
+        os << "counters: disabled in this build (FANC_STATS)" << std::endl;
+#endif
+        for (int phase = 0; phase < PHASE_COUNT; phase++) {
+            if (report.memory[phase].empty())
+                continue;
+            os << "memory after " << PHASE_NAMES[phase] << ":" << std::endl;
+            os << "  " << std::left << std::setw(20) << "category" << std::right << std::setw(12) << "live KiB"
+               << std::setw(12) << "peak KiB" << std::setw(12) << "live blocks" << std::setw(12) << "allocations"
+               << std::endl;
+            for (size_t i = 0; i < report.memory[phase].size(); i++) {
+                const memory::Usage &usage = report.memory[phase][i];
+                if (usage.allocations == 0 && usage.live_blocks == 0)
+                    continue;
+                os << "  " << std::left << std::setw(20) << memory::name(i) << std::right
+                   << std::setw(12) << usage.live_bytes / 1024.0 << std::setw(12) << usage.peak_bytes / 1024.0
+                   << std::setw(12) << usage.live_blocks << std::setw(12) << usage.allocations << std::endl;
+            }
+        }
+        os << "peak rss: " << report.peak_rss_kb << " KiB" << std::endl;
+    }
+
+    void printJson(const Report &report, std::ostream &os) {
+        os << std::fixed << std::setprecision(3);
+        os << "{\"phases\": {";
+        for (int phase = 0; phase < PHASE_COUNT; phase++)
+            os << (phase == 0 ? "" : ", ") << "\"" << PHASE_NAMES[phase] << "\": {\"wall_ms\": "
+               << report.phases[phase].wall_micros / 1000 << ", \"cpu_ms\": "
+               << report.phases[phase].cpu_micros / 1000 << "}";
+        os << "}, \"nodes\": {\"total\": " << totalNodes(report);
+        for (auto &kind : report.nodes)
+            os << ", \"" << kind.first << "\": " << kind.second;
+        os << "}, \"literals\": {\"count\": " << report.literals << ", \"bytes\": " << report.literal_bytes << "}";
+#ifdef FANC_STATS
+        const Counters &c = report.counters;
+        os << ", \"counters\": {\"tokens\": " << c.tokens << ", \"scopes\": " << c.scopes
+           << ", \"symbol_lookups\": " << c.symbol_lookups << ", \"lookup_steps\": " << c.lookup_steps
+           << ", \"lookup_max_depth\": " << c.lookup_max_depth << ", \"allocations\": " << c.allocations
+           << ", \"allocated_bytes\": " << c.allocated_bytes << "}";
+#endif
+        bool first = true;
+        for (int phase = 0; phase < PHASE_COUNT; phase++) {
+            if (report.memory[phase].empty())
+                continue;
+            os << (first ? ", \"memory\": {" : ", ") << "\"" << PHASE_NAMES[phase] << "\": {";
+            first = false;
+            for (size_t i = 0; i < report.memory[phase].size(); i++) {
+                const memory::Usage &usage = report.memory[phase][i];
+                os << (i == 0 ? "" : ", ") << "\"" << memory::name(i) << "\": {\"live_bytes\": " << usage.live_bytes
+                   << ", \"peak_bytes\": " << usage.peak_bytes << ", \"live_blocks\": " << usage.live_blocks
+                   << ", \"allocations\": " << usage.allocations << "}";
+            }
+            os << "}";
+        }
+        if (!first)
+            os << "}";
+        os << ", \"peak_rss_kb\": " << report.peak_rss_kb << "}" << std::endl;
+    }
+}
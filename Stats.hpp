@@ -0,0 +1,113 @@
+#ifndef STATS_HPP
+#define STATS_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include "nodes.hpp"
+#include "Memory.hpp"
+
+/* Measurements behind hw3 --stats.
+ * Phase times are taken by PhaseTimer around each phase of fanc::compile. Lexing and parsing
+ * run interleaved, so while timing is on every token is timed on its way from the scanner to
+ * the parser and the parse phase is what remains of yyparse.
+ * The counters sit on hot paths (scanner, symbol lookups, operator new in Allocator.cpp), so they only exist
+ * when the build defines FANC_STATS: without it the STATS_* macros expand to nothing.
+ * Counters are per thread and reset by every compile, so concurrent compiles do not mix.
+ * Builds with FANC_MEMSTATS also snapshot the memory categories of Memory.hpp at the end of
+ * the parse, analysis and print phases.
+ */
+namespace stats {
+    enum Phase {
+        LEX,
+        PARSE,
+        ANALYSIS,
+        PRINT,
+        PHASE_COUNT
+    };
+
+    struct PhaseTime {
+        double wall_micros;
+        double cpu_micros;
+    };
+
+    struct Counters {
+        long tokens;
+        long scopes;
+        long symbol_lookups;
+        long lookup_steps;      // scopes walked by all lookups
+        long lookup_max_depth;  // most scopes walked by one lookup
+        long allocations;
+        long allocated_bytes;
+    };
+
+    struct Report {
+        bool enabled;
+        PhaseTime phases[PHASE_COUNT];
+        Counters counters;
+        std::map<std::string, long> nodes;  // AST nodes by kind
+        std::vector<memory::Usage> memory[PHASE_COUNT];  // by category, empty if not taken
+        long literals;          // distinct string literals in the pool of the compile
+        long literal_bytes;
+        long peak_rss_kb;
+
+        Report() : enabled(false), phases(), counters(), literals(0), literal_bytes(0), peak_rss_kb(0) {};
+    };
+
+    extern thread_local Counters counters;
+
+    // Set while a compile with stats is running, makes the scanner time its tokens
+    extern thread_local Report *current;
+
+    // Adds the wall and CPU time of the thread from construction to destruction to a phase,
+    // does nothing without a report
+    class PhaseTimer {
+    public:
+        PhaseTimer(Report *report, Phase phase);
+
+        ~PhaseTimer();
+
+    private:
+        Report *report;
+        Phase phase;
+        std::chrono::steady_clock::time_point wall_start;
+        double cpu_start;
+    };
+
+    double threadCpuMicros();
+
+    // Called by the parser instead of yylex, moves the token's value to *value and its offset to *location
+    int lex(YYSTYPE *value, YYLTYPE *location);
+
+    // Adds the counters another thread kept for the same compile to this thread's
+    void merge(const Counters &other);
+
+    // Keeps the memory usage of the thread as the state at the end of a phase, does nothing
+    // without a report or FANC_MEMSTATS
+    void snapshot(Report *report, Phase phase);
+
+    // Fills the parts of the report taken at the end of a compile: node counts, the size of the
+    // literal pool and peak RSS
+    void finish(Report &report, const std::shared_ptr<ast::Node> &program, const literals::Pool *literals);
+
+    void printTable(const Report &report, std::ostream &os);
+
+    void printJson(const Report &report, std::ostream &os);
+}
+
+#ifdef FANC_STATS
+#define STATS_COUNT(counter) (stats::counters.counter++)
+#define STATS_ADD(counter, n) (stats::counters.counter += (n))
+#define STATS_MAX(counter, n) \
+    (stats::counters.counter = std::max(stats::counters.counter, (long) (n)))
+#else
+#define STATS_COUNT(counter) ((void) 0)
+#define STATS_ADD(counter, n) ((void) 0)
+#define STATS_MAX(counter, n) ((void) 0)
+#endif
+
+#endif //STATS_HPP
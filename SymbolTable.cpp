@@ -1,20 +1,32 @@
 #include "SymbolTable.hpp"
 #include "output.hpp"
 #include "nodes.hpp"
+#include "Trace.hpp"
+#include "Memory.hpp"
+
+// Names of ScopeType values in --trace
+static const char *SCOPE_NAMES[] = {"global scope", "function scope", "if scope", "while scope", "block scope"};
 
 // Constructor initializes the symbol table
-SymbolTable::SymbolTable() {
+SymbolTable::SymbolTable() : signatures(std::make_shared<signatures::Interner>()) {
     currentScope = nullptr;
     initializeGlobalScope();  // Initialize the global scope with predefined functions
 }
 
 // Destructor (clean up memory)
 SymbolTable::~SymbolTable() {
-    delete currentScope;
+    // An error can leave nested scopes open, they are all freed up to the global one
+    while (currentScope != nullptr) {
+        trace::endScope();
+        Scope* parent = currentScope->parent_scope;
+        delete currentScope;
+        currentScope = parent;
+    }
 }
 
 // Insert a symbol into the current scope
-bool SymbolTable::insertSymbolFunc(const std::string& name, ast::BuiltInType type, const std::vector<ast::BuiltInType> &paramTypes) {
+bool SymbolTable::insertSymbolFunc(const std::string& name, ast::BuiltInType type, const signatures::Signature *params) {
+    MEMORY_TAG(memory::SCOPES);
     if (globalFunctionRegistry.find(name) != globalFunctionRegistry.end()) {
         //std::cerr << "Error: Symbol '" << name << "' already defined in this scope.\n";
         return false;
@@ -22,14 +34,14 @@ bool SymbolTable::insertSymbolFunc(const std::string& name, ast::BuiltInType typ
 
     // Insert the symbol into the current scope
 
-    globalFunctionRegistry[name] = Symbol(name, type, 0);  // Offset irrelevant for global functions
-    globalFunctionRegistry[name].paramTypes = paramTypes;
-    global->scopePrinter.emitFunc(name, type, paramTypes);
+    globalFunctionRegistry[name] = Symbol(name, type, params);  // Offset irrelevant for global functions
+    global->scopePrinter.emitFunc(name, type, params->types);
 
     return true;
 }
 
 bool SymbolTable::insertSymbol(const std::string& name, ast::BuiltInType type) {
+    MEMORY_TAG(memory::SCOPES);
     // Check if the symbol already exists in the current scope or any parent scopes
     Scope* scope = currentScope;
    // while (scope != nullptr) {
@@ -55,6 +67,7 @@ bool SymbolTable::insertSymbol(const std::string& name, ast::BuiltInType type) {
 
 // Look up a symbol in the current scope or higher scopes
 Symbol SymbolTable::lookupSymbol(const std::string& name) {
+    MEMORY_TAG(memory::SCOPES);
     return currentScope->getSymbol(name);
 }
 
@@ -76,6 +89,9 @@ bool SymbolTable::checkFunctionCall(const std::string& funcName) {
 
 // Enter a new scope
 void SymbolTable::enterScope(ScopeType type) {
+    MEMORY_TAG(memory::SCOPES);
+    STATS_COUNT(scopes);
+    trace::beginScope(SCOPE_NAMES[type]);
     Scope* newScope = new Scope(type);
     if (type != ScopeType::GLOBAL)
         global->scopePrinter.beginScope();
@@ -94,10 +110,14 @@ void SymbolTable::enterScope(ScopeType type) {
 
 void SymbolTable::enterScope(ScopeType type, const std::set<std::string>& cond_symbols)
 {
+    MEMORY_TAG(memory::SCOPES);
+    STATS_COUNT(scopes);
+    trace::beginScope(SCOPE_NAMES[type]);
     Scope* newScope = new Scope(type);
     if (type != ScopeType::GLOBAL)
         global->scopePrinter.beginScope();
     if (type ==ScopeType::WHILE || type ==ScopeType::IF || type ==ScopeType::INFUNC) {
+        MEMORY_TAG(memory::FREE_VARIABLES);
         newScope->condition_symbols = cond_symbols;
         newScope->offset = currentScope->offset;
     }
@@ -117,6 +137,9 @@ void SymbolTable::enterScope(ScopeType type, const std::set<std::string>& cond_s
 }
 
 void SymbolTable::enterScope(ScopeType type, std::vector<ast::BuiltInType>& params_type, std::vector<std::string>& params_names, ast::BuiltInType ret_type) {
+    MEMORY_TAG(memory::SCOPES);
+    STATS_COUNT(scopes);
+    trace::beginScope(SCOPE_NAMES[type]);
     Scope* newScope = new Scope(type);
     if (type != ScopeType::GLOBAL)
         global->scopePrinter.beginScope();
@@ -144,6 +167,7 @@ void SymbolTable::enterScope(ScopeType type, std::vector<ast::BuiltInType>& para
 
 // Exit the current scope
 void SymbolTable::exitScope() {
+    trace::endScope();
     Scope* oldScope = currentScope;
     //std::cout << "exiting scope : "<< oldScope->scopeType << std::endl;
     /* if (oldScope->parent_scope != nullptr)
@@ -163,21 +187,21 @@ void SymbolTable::exitScope() {
 void SymbolTable::initializeGlobalScope() {
     enterScope(ScopeType::GLOBAL);
     global = currentScope;
-    std::vector<ast::BuiltInType> vec1 = { ast::BuiltInType::STRING };
-    std::vector<ast::BuiltInType> vec12 = { ast::BuiltInType::INT };
     // Add predefined functions print and printi
-    this->insertSymbolFunc("print", ast::BuiltInType::VOID, vec1);
-    this->insertSymbolFunc("printi",ast::BuiltInType::VOID, vec12);
+    this->insertSymbolFunc("print", ast::BuiltInType::VOID, signatures->empty()->extend(ast::BuiltInType::STRING));
+    this->insertSymbolFunc("printi",ast::BuiltInType::VOID, signatures->empty()->extend(ast::BuiltInType::INT));
 }
 
 
 ast::BuiltInType SymbolTable::getSymbolType(std::string& name) {
+    MEMORY_TAG(memory::SCOPES);
     if (currentScope != nullptr)
         return currentScope->getSymbolType(name);
     return ast::BuiltInType::NONE;
 }
 
 Symbol SymbolTable::getFunctionSymbol(const std::string& funcName) {
+    MEMORY_TAG(memory::SCOPES);
     // Check if the function is in the global function registry
     auto it = globalFunctionRegistry.find(funcName);
     if (it != globalFunctionRegistry.end()) {
@@ -232,13 +256,19 @@ int Scope::insertSymbol(const std::string& name, ast::BuiltInType type, int coun
 }
 
 Symbol Scope::getSymbol(const std::string& name) {
-    //std::cout << "looking in current " << name << std::endl;
-    if (symbols.find(name) != symbols.end()) {
-        return symbols[name];
-    }
-    if (this->parent_scope) {
-        //std::cout << "looking in Parent " << name << std::endl;
-        return parent_scope->getSymbol(name);
+    // Walks up the parent chain, counted for --stats like hasSymbol
+    STATS_COUNT(symbol_lookups);
+    int depth = 0;
+    for (Scope* scope = this; scope != nullptr; scope = scope->parent_scope) {
+        depth++;
+        auto it = scope->symbols.find(name);
+        if (it != scope->symbols.end()) {
+            STATS_ADD(lookup_steps, depth);
+            STATS_MAX(lookup_max_depth, depth);
+            return it->second;
+        }
     }
+    STATS_ADD(lookup_steps, depth);
+    STATS_MAX(lookup_max_depth, depth);
     return Symbol ();
 }
@@ -2,11 +2,14 @@
 #define SYMBOLTABLE_H
 
 #include <iostream>
+#include <memory>
 #include <unordered_map>
 #include <vector>
 #include <string>
 #include "nodes.hpp"
 #include "output.hpp"
+#include "Stats.hpp"
+#include "Signatures.hpp"
 
 // Enum for symbol types
 enum ScopeType {
@@ -22,20 +25,18 @@ class Symbol {
 public:
     std::string name;
     ast::BuiltInType type;
-    std::vector<ast::BuiltInType> paramTypes;  // Arguments for functions (empty for non-functions)
+    const signatures::Signature *params;  // Arguments for functions, interned (nullptr for non-functions)
     int offset;  // Offset for variables or function arguments
     bool is_func;
 
     // Constructor for  variable
-    Symbol() : type(ast::BuiltInType::NONE), offset(0), is_func(false) {
-    paramTypes = {};  // Empty vector initialization for non-function symbols
-    };
+    Symbol() : type(ast::BuiltInType::NONE), params(nullptr), offset(0), is_func(false) {};
 
     Symbol(const std::string& _name, ast::BuiltInType type, int offset = 0)
-              : name(_name), type(type), offset(offset) ,is_func(false) {};
+              : name(_name), type(type), params(nullptr), offset(offset) ,is_func(false) {};
 
-    Symbol(const std::string& _name, ast::BuiltInType type ,const std::vector<ast::BuiltInType>& params, int offset = 0)
-            : name(_name), type(type), offset(offset) ,paramTypes(params) , is_func(true) {};
+    Symbol(const std::string& _name, ast::BuiltInType type ,const signatures::Signature *params, int offset = 0)
+            : name(_name), type(type), params(params), offset(offset) , is_func(true) {};
 
     ast::BuiltInType getType() { return type; }
 
@@ -66,16 +67,20 @@ public:
         return found;
     }
     bool hasSymbol(const std::string& name) {
-        bool found = symbols.find(name) != symbols.end();
-
-            //std::cout << "got " << name <<" in scope "<< scopeType<< std::endl;
-           // std::cout <<"Entered scope type: " << type << std::endl;
-        if (!found && parent_scope != nullptr ) {
-           // std::cout << "finding in parent  " << name << std::endl;
-            return parent_scope->hasSymbol(name);
+        // Walks up the parent chain, counted for --stats
+        STATS_COUNT(symbol_lookups);
+        int depth = 0;
+        for (Scope* scope = this; scope != nullptr; scope = scope->parent_scope) {
+            depth++;
+            if (scope->symbols.find(name) != scope->symbols.end()) {
+                STATS_ADD(lookup_steps, depth);
+                STATS_MAX(lookup_max_depth, depth);
+                return true;
+            }
         }
-
-        return found;
+        STATS_ADD(lookup_steps, depth);
+        STATS_MAX(lookup_max_depth, depth);
+        return false;
     }
 
     bool hasCondSymbol(const std::string& name) {
@@ -137,11 +142,12 @@ public:
     Scope* currentScope;
     Scope* global;
     std::unordered_map<std::string, Symbol> globalFunctionRegistry; // Global function registry
+    std::shared_ptr<signatures::Interner> signatures; // Parameter lists of the registered functions
 
     SymbolTable();
     ~SymbolTable();
 
-    bool insertSymbolFunc(const std::string& name, ast::BuiltInType type,  const std::vector<ast::BuiltInType> &paramTypes);
+    bool insertSymbolFunc(const std::string& name, ast::BuiltInType type, const signatures::Signature *params);
     bool insertSymbol(const std::string& name, ast::BuiltInType type);
     Symbol lookupSymbol(const std::string& name);
     bool isFunctionDefined(const std::string& funcName) const;
@@ -0,0 +1,140 @@
+#include "TailCalls.hpp"
+#include "AstUtils.hpp"
+
+TailCallEliminator::TailCallEliminator(const std::unordered_map<std::string, Symbol> &functions)
+        : functions(functions), eliminated(0) {}
+
+void TailCallEliminator::run(ast::Funcs &program) {
+    for (auto &func : program.funcs) {
+        int self_calls = 0;
+        ast::forEachCall(func->body, [&](ast::Call &call) { self_calls += call.func_id->value == func->id->value; });
+        if (self_calls == 0)
+            continue;
+
+        current = func;
+        eliminated = 0;
+        rewriteBlock(*func->body, false, true);
+        reports.push_back({func->id->value, eliminated, self_calls - eliminated});
+        if (eliminated == 0)
+            continue;
+
+        // The function entry becomes the head of a loop, falling off its end still leaves the function
+        source::Offset offset = func->offset;
+        auto loop_body = std::make_shared<ast::Statements>();
+        loop_body->offset = offset;
+        loop_body->is_scope = true;
+        loop_body->statements = func->body->statements;
+        auto brk = std::make_shared<ast::Break>();
+        brk->offset = offset;
+        loop_body->push_back(brk);
+        auto condition = std::make_shared<ast::Bool>(true);
+        condition->offset = offset;
+        auto entry = std::make_shared<ast::While>(condition, loop_body);
+        entry->offset = offset;
+        func->body->statements = {entry};
+    }
+}
+
+void TailCallEliminator::rewriteBlock(ast::Statements &block, bool in_loop, bool tail) {
+    std::vector<std::shared_ptr<ast::Statement>> rewritten;
+    auto &statements = block.statements;
+    for (size_t i = 0; i < statements.size(); i++) {
+        bool last = i + 1 == statements.size();
+        auto call = ast::cast<ast::Call>(statements[i]);
+        if (!in_loop && call != nullptr && isSelfCall(call) &&
+            current->return_type->type == ast::BuiltInType::VOID) {
+            // `f(...); return;` and a trailing `f(...);` are tail calls of a void function
+            auto next = last ? nullptr : ast::cast<ast::Return>(statements[i + 1]);
+            if ((last && tail) || (next != nullptr && next->exp == nullptr)) {
+                rewritten.push_back(jumpToEntry(*call));
+                if (next != nullptr)
+                    i++;
+                continue;
+            }
+        }
+        rewritten.push_back(rewrite(statements[i], in_loop, tail && last));
+    }
+    statements = rewritten;
+}
+
+std::shared_ptr<ast::Statement> TailCallEliminator::rewrite(const std::shared_ptr<ast::Statement> &statement,
+                                                            bool in_loop, bool tail) {
+    if (statement == nullptr)
+        return nullptr;
+    if (auto ret = ast::cast<ast::Return>(statement)) {
+        if (!in_loop && isSelfCall(ret->exp))
+            return jumpToEntry(*ast::cast<ast::Call>(ret->exp));
+    } else if (auto block = ast::cast<ast::Statements>(statement)) {
+        rewriteBlock(*block, in_loop, tail);
+    } else if (auto if_node = ast::cast<ast::If>(statement)) {
+        if_node->then = rewrite(if_node->then, in_loop, tail);
+        if_node->otherwise = rewrite(if_node->otherwise, in_loop, tail);
+    } else if (auto while_node = ast::cast<ast::While>(statement)) {
+        while_node->body = rewrite(while_node->body, true, false);
+    } else if (auto call = ast::cast<ast::Call>(statement)) {
+        // A lone call below an if/else in tail position of a void function
+        if (!in_loop && tail && isSelfCall(call) && current->return_type->type == ast::BuiltInType::VOID)
+            return jumpToEntry(*call);
+    }
+    return statement;
+}
+
+bool TailCallEliminator::isSelfCall(const std::shared_ptr<ast::Exp> &exp) const {
+    auto call = ast::cast<ast::Call>(exp);
+    return call != nullptr && call->func_id->value == current->id->value;
+}
+
+// Builds { T tmp_i = arg_i; ...; param_i = tmp_i; ...; continue; }
+std::shared_ptr<ast::Statement> TailCallEliminator::jumpToEntry(ast::Call &call) {
+    eliminated++;
+    source::Offset offset = call.offset;
+    auto &formals = current->formals->formals;
+    const Symbol &signature = functions.at(current->id->value);
+    auto block = std::make_shared<ast::Statements>();
+    block->offset = offset;
+    block->is_scope = true;
+
+    // Arguments that pass a parameter through unchanged need no reassignment
+    std::vector<size_t> changed;
+    for (size_t i = 0; i < formals.size(); i++) {
+        auto id = ast::cast<ast::ID>(call.args->exps[i]);
+        if (id == nullptr || id->value != formals[i]->id->value)
+            changed.push_back(i);
+    }
+
+    if (changed.size() == 1) {
+        size_t i = changed[0];
+        auto assign = std::make_shared<ast::Assign>(ast::makeId(formals[i]->id->value, offset), call.args->exps[i]);
+        assign->offset = offset;
+        block->push_back(assign);
+    } else {
+        // Every new argument is evaluated against the old parameter values before any is overwritten
+        for (size_t i : changed) {
+            auto temp = std::make_shared<ast::VarDecl>(ast::makeId("tco$" + formals[i]->id->value, offset),
+                                                       ast::makeType(signature.params->types[i], offset),
+                                                       call.args->exps[i]);
+            temp->offset = offset;
+            block->push_back(temp);
+        }
+        for (size_t i : changed) {
+            auto assign = std::make_shared<ast::Assign>(ast::makeId(formals[i]->id->value, offset),
+                                                        ast::makeId("tco$" + formals[i]->id->value, offset));
+            assign->offset = offset;
+            block->push_back(assign);
+        }
+    }
+    auto jump = std::make_shared<ast::Continue>();
+    jump->offset = offset;
+    block->push_back(jump);
+    return block;
+}
+
+void TailCallEliminator::printReport(std::ostream &os) const {
+    os << "---tail call report---" << std::endl;
+    for (auto &report : reports) {
+        os << report.name << ": " << report.eliminated << " tail call(s) turned into a loop";
+        if (report.kept > 0)
+            os << ", " << report.kept << " recursive call(s) kept";
+        os << std::endl;
+    }
+}
@@ -0,0 +1,47 @@
+#ifndef TAIL_CALLS_HPP
+#define TAIL_CALLS_HPP
+
+#include <iostream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "nodes.hpp"
+#include "SymbolTable.hpp"
+
+/* Turns self-recursive tail calls into loops.
+ * `return f(...)` inside f (and, in void functions, `f(...);` in tail position) becomes an
+ * assignment of the new arguments to the parameters followed by a jump back to the function
+ * entry. The entry is a `while (true)` wrapped around the body, so tail calls nested inside a
+ * loop of the body are left alone: a continue there would only restart the inner loop.
+ */
+class TailCallEliminator {
+public:
+    explicit TailCallEliminator(const std::unordered_map<std::string, Symbol> &functions);
+
+    void run(ast::Funcs &program);
+
+    void printReport(std::ostream &os) const;
+
+private:
+    struct FuncReport {
+        std::string name;
+        int eliminated;
+        int kept;
+    };
+
+    const std::unordered_map<std::string, Symbol> &functions;
+    std::vector<FuncReport> reports;
+    std::shared_ptr<ast::FuncDecl> current;
+    int eliminated;
+
+    std::shared_ptr<ast::Statement> rewrite(const std::shared_ptr<ast::Statement> &statement, bool in_loop, bool tail);
+
+    void rewriteBlock(ast::Statements &block, bool in_loop, bool tail);
+
+    bool isSelfCall(const std::shared_ptr<ast::Exp> &exp) const;
+
+    std::shared_ptr<ast::Statement> jumpToEntry(ast::Call &call);
+};
+
+#endif //TAIL_CALLS_HPP
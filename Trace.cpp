@@ -0,0 +1,163 @@
+#include "Trace.hpp"
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace trace {
+    // Events past this many per thread are dropped and counted
+    static const size_t MAX_EVENTS = 1 << 20;
+
+    struct Event {
+        std::string name;
+        const char *category;
+        std::string detail;
+        double begin;
+        double duration;
+    };
+
+    struct Buffer {
+        int tid;
+        std::string thread_name;
+        std::vector<Event> events;
+        size_t dropped;
+        // Start times of the open scopes, including those too deep to be recorded
+        std::vector<double> scopes;
+        std::vector<const char *> scope_kinds;
+    };
+
+    std::atomic<bool> active(false);
+    static int max_scope_depth = 0;
+    static std::chrono::steady_clock::time_point epoch;
+    static std::mutex registry_mutex;
+    static std::vector<std::shared_ptr<Buffer>> buffers;
+    static thread_local Buffer *local = nullptr;
+
+    static double now() {
+        return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - epoch).count();
+    }
+
+    static Buffer &buffer() {
+        if (local == nullptr) {
+            auto created = std::make_shared<Buffer>();
+            created->dropped = 0;
+            std::lock_guard<std::mutex> lock(registry_mutex);
+            created->tid = (int) buffers.size() + 1;
+            buffers.push_back(created);
+            local = created.get();
+        }
+        return *local;
+    }
+
+    static void record(const char *category, std::string name, std::string detail, double begin, double end) {
+        Buffer &own = buffer();
+        if (own.events.size() >= MAX_EVENTS) {
+            own.dropped++;
+            return;
+        }
+        own.events.push_back({std::move(name), category, std::move(detail), begin, end - begin});
+    }
+
+    void start(int scope_depth) {
+        epoch = std::chrono::steady_clock::now();
+        max_scope_depth = scope_depth;
+        active.store(true, std::memory_order_relaxed);
+    }
+
+    void nameThread(const std::string &name) {
+        if (enabled())
+            buffer().thread_name = name;
+    }
+
+    Span::Span(const char *category, const char *name) : recording(enabled()), category(category), begin(0) {
+        if (recording) {
+            this->name = name;
+            begin = now();
+        }
+    }
+
+    Span::Span(const char *category, const std::string &name, const std::string &detail)
+            : recording(enabled()), category(category), begin(0) {
+        if (recording) {
+            this->name = name;
+            this->detail = detail;
+            begin = now();
+        }
+    }
+
+    Span::~Span() {
+        if (recording)
+            record(category, std::move(name), std::move(detail), begin, now());
+    }
+
+    void beginScope(const char *kind) {
+        if (!enabled())
+            return;
+        Buffer &own = buffer();
+        own.scopes.push_back(now());
+        own.scope_kinds.push_back(kind);
+    }
+
+    void endScope() {
+        if (!enabled())
+            return;
+        Buffer &own = buffer();
+        if (own.scopes.empty())
+            return;
+        if ((int) own.scopes.size() <= max_scope_depth)
+            record("scope", own.scope_kinds.back(), "depth " + std::to_string(own.scopes.size()),
+                   own.scopes.back(), now());
+        own.scopes.pop_back();
+        own.scope_kinds.pop_back();
+    }
+
+    static void writeString(std::ostream &os, const std::string &text) {
+        os << '"';
+        for (char c : text) {
+            if (c == '"' || c == '\\')
+                os << '\\' << c;
+            else if ((unsigned char) c < 0x20)
+                os << "\\u" << std::hex << std::setw(4) << std::setfill('0') << (int) c << std::dec;
+            else
+                os << c;
+        }
+        os << '"';
+    }
+
+    bool write(const std::string &path) {
+        std::ofstream out(path, std::ios::trunc);
+        if (!out)
+            return false;
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        out << std::fixed << std::setprecision(3);
+        out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+        bool first = true;
+        for (auto &own : buffers) {
+            std::string thread_name = own->thread_name.empty() ? "thread " + std::to_string(own->tid)
+                                                               : own->thread_name;
+            out << (first ? "" : ",\n") << "{\"ph\": \"M\", \"pid\": 1, \"tid\": " << own->tid
+                << ", \"name\": \"thread_name\", \"args\": {\"name\": ";
+            writeString(out, thread_name);
+            out << "}}";
+            first = false;
+            for (auto &event : own->events) {
+                out << ",\n{\"ph\": \"X\", \"pid\": 1, \"tid\": " << own->tid << ", \"cat\": \"" << event.category
+                    << "\", \"name\": ";
+                writeString(out, event.name);
+                out << ", \"ts\": " << event.begin << ", \"dur\": " << event.duration;
+                if (!event.detail.empty()) {
+                    out << ", \"args\": {\"detail\": ";
+                    writeString(out, event.detail);
+                    out << "}";
+                }
+                out << "}";
+            }
+            if (own->dropped > 0)
+                out << ",\n{\"ph\": \"i\", \"pid\": 1, \"tid\": " << own->tid << ", \"s\": \"t\", \"ts\": " << now()
+                    << ", \"name\": \"" << own->dropped << " events dropped\"}";
+        }
+        out << "\n]}\n";
+        return (bool) out;
+    }
+}
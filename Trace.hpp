@@ -0,0 +1,55 @@
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+#include <atomic>
+#include <chrono>
+#include <string>
+
+/* Timeline of a compiler run in Chrome trace-event format, behind hw3 --trace=PATH.
+ * Spans are complete events ("ph": "X") of phases, analysed functions, scopes up to a
+ * configurable nesting depth and batch files. Every thread appends to its own buffer, so
+ * recording takes no lock: a buffer is registered once, under a mutex, the first time its
+ * thread records something. write() reads all buffers and must only run once the recording
+ * threads are done. Without start() a span costs one relaxed atomic load.
+ * The output loads in chrome://tracing and Perfetto.
+ */
+namespace trace {
+    extern std::atomic<bool> active;
+
+    // Starts recording, scopes are recorded while at most scope_depth scopes are open
+    void start(int scope_depth);
+
+    inline bool enabled() {
+        return active.load(std::memory_order_relaxed);
+    }
+
+    // Shown as the name of the calling thread's track
+    void nameThread(const std::string &name);
+
+    // Records the time from construction to destruction
+    class Span {
+    public:
+        Span(const char *category, const char *name);
+
+        Span(const char *category, const std::string &name, const std::string &detail = "");
+
+        ~Span();
+
+    private:
+        bool recording;
+        const char *category;
+        std::string name;
+        std::string detail;
+        double begin;
+    };
+
+    // Called by the symbol table as scopes are entered and left
+    void beginScope(const char *kind);
+
+    void endScope();
+
+    // Writes everything recorded so far, false if the file cannot be written
+    bool write(const std::string &path);
+}
+
+#endif //TRACE_HPP
@@ -0,0 +1,87 @@
+#ifndef TYPE_RULES_HPP
+#define TYPE_RULES_HPP
+
+#include "visitor.hpp"
+
+/* The typing rules of FanC between two built-in types, as tables indexed by BuiltInType.
+ * The analyzer checks declarations, assignments, returns, arithmetic and casts against them, and
+ * the passes after it (CodeGen, the evaluator) take their conversions from the same tables, so
+ * a rule is only written here. Rows and columns are NONE, VOID, BOOL, BYTE, INT, STRING: index()
+ * shifts NONE (-1) to 0. NONE and VOID never hold a value, so no rule accepts them.
+ */
+namespace types {
+    const int COUNT = ast::BuiltInType::STRING + 2;
+
+    constexpr int index(ast::BuiltInType type) {
+        return type + 1;
+    }
+
+    // [to][from]: a value of type from can be stored into a variable, parameter or return value of type to
+    constexpr bool ASSIGNABLE[COUNT][COUNT] = {
+            //            NONE   VOID   BOOL   BYTE   INT    STRING
+            /* NONE   */ {false, false, false, false, false, false},
+            /* VOID   */ {false, false, false, false, false, false},
+            /* BOOL   */ {false, false, true,  false, false, false},
+            /* BYTE   */ {false, false, false, true,  false, false},
+            /* INT    */ {false, false, false, true,  true,  false},
+            /* STRING */ {false, false, false, false, false, true},
+    };
+
+    // [left][right]: type of an arithmetic operation (BinOp), NONE when the operands are not numbers
+    constexpr ast::BuiltInType ARITHMETIC[COUNT][COUNT] = {
+            //            NONE             VOID             BOOL             BYTE             INT              STRING
+            /* NONE   */ {ast::NONE,       ast::NONE,       ast::NONE,       ast::NONE,       ast::NONE,       ast::NONE},
+            /* VOID   */ {ast::NONE,       ast::NONE,       ast::NONE,       ast::NONE,       ast::NONE,       ast::NONE},
+            /* BOOL   */ {ast::NONE,       ast::NONE,       ast::NONE,       ast::NONE,       ast::NONE,       ast::NONE},
+            /* BYTE   */ {ast::NONE,       ast::NONE,       ast::NONE,       ast::BYTE,       ast::INT,        ast::NONE},
+            /* INT    */ {ast::NONE,       ast::NONE,       ast::NONE,       ast::INT,        ast::INT,        ast::NONE},
+            /* STRING */ {ast::NONE,       ast::NONE,       ast::NONE,       ast::NONE,       ast::NONE,       ast::NONE},
+    };
+
+    // [to][from]: (to) exp is legal for an exp of type from
+    constexpr bool CASTABLE[COUNT][COUNT] = {
+            //            NONE   VOID   BOOL   BYTE   INT    STRING
+            /* NONE   */ {false, false, false, false, false, false},
+            /* VOID   */ {false, false, false, false, false, false},
+            /* BOOL   */ {false, false, true,  false, false, false},
+            /* BYTE   */ {false, false, false, true,  true,  false},
+            /* INT    */ {false, false, false, true,  true,  false},
+            /* STRING */ {false, false, false, false, false, true},
+    };
+
+    /* [to][from]: converting a value of type from to type to narrows it. A value known at compile
+     * time has to fit (errorByteTooLarge), any other is truncated at runtime behind a guard (TRUNC).
+     */
+    constexpr bool NARROWING[COUNT][COUNT] = {
+            //            NONE   VOID   BOOL   BYTE   INT    STRING
+            /* NONE   */ {false, false, false, false, false, false},
+            /* VOID   */ {false, false, false, false, false, false},
+            /* BOOL   */ {false, false, false, false, false, false},
+            /* BYTE   */ {false, false, false, false, true,  false},
+            /* INT    */ {false, false, false, false, false, false},
+            /* STRING */ {false, false, false, false, false, false},
+    };
+
+    constexpr bool assignable(ast::BuiltInType to, ast::BuiltInType from) {
+        return ASSIGNABLE[index(to)][index(from)];
+    }
+
+    constexpr ast::BuiltInType arithmetic(ast::BuiltInType left, ast::BuiltInType right) {
+        return ARITHMETIC[index(left)][index(right)];
+    }
+
+    constexpr bool castable(ast::BuiltInType to, ast::BuiltInType from) {
+        return CASTABLE[index(to)][index(from)];
+    }
+
+    constexpr bool narrowing(ast::BuiltInType to, ast::BuiltInType from) {
+        return NARROWING[index(to)][index(from)];
+    }
+
+    static_assert(assignable(ast::INT, ast::BYTE) && !assignable(ast::BYTE, ast::INT), "bytes widen, ints do not narrow");
+    static_assert(arithmetic(ast::BYTE, ast::BYTE) == ast::BYTE && arithmetic(ast::BYTE, ast::INT) == ast::INT,
+                  "arithmetic is done in the wider operand type");
+    static_assert(castable(ast::BYTE, ast::INT) && !castable(ast::INT, ast::BOOL), "casts only convert numbers");
+}
+
+#endif //TYPE_RULES_HPP
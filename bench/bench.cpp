@@ -0,0 +1,553 @@
+/* fanc-bench: benchmarks hw3 on generated FanC programs.
+ *
+ *   fanc-bench gen [--functions=N] [--statements=N] [--depth=N] [--expr=N] [--identifiers=N]
+ *                  [--formals=N] [--guards=PERCENT] [--seed=N]
+ *       prints a valid program, each option is one scaling axis
+ *   fanc-bench run [--hw3=PATH] [--runs=N] [--corpus=DIR] [--out=FILE]
+ *       generates the corpus (a base program and each axis scaled on its own), times hw3 on
+ *       every program end to end and per phase (from --stats-json) and writes the medians as JSON,
+ *       together with the guards hw3 --ranges removes from each program and the branches, jumps
+ *       and instructions hw3 --branch-stats counts with jump lists and with materialised booleans
+ *   fanc-bench compare BASE.json NEW.json [--threshold=PERCENT]
+ *       lists the changes between two results and fails if a time grew by more than PERCENT
+ */
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+static const char *PHASES[] = {"lex", "parse", "analysis", "print"};
+
+// Differences below this many milliseconds are noise, whatever the percentage
+static const double NOISE_MS = 0.05;
+
+struct GenOptions {
+    int functions;
+    int statements;     // per function, nested ones included
+    int depth;          // of if/while nesting
+    int expr;           // operators per expression
+    int identifiers;    // local variables declared at the top of each function
+    int formals;
+    int guards;         // percent of operators that divide, byte formals also get byte locals
+    unsigned seed;
+
+    GenOptions() : functions(20), statements(20), depth(2), expr(4), identifiers(8), formals(2), guards(0),
+                   seed(1) {};
+};
+
+/* Writes programs that pass semantic analysis: every name is declared once per function and
+ * before its use, byte values only flow into int expressions and calls go to functions defined
+ * earlier with arguments of the right types. Divisors are never zero: a literal, a byte plus one
+ * (which range analysis can prove) or a square plus one (which it cannot).
+ */
+class Generator {
+public:
+    explicit Generator(const GenOptions &options) : options(options), rng(options.seed), temps(0) {}
+
+    std::string program() {
+        for (int i = 0; i < options.functions; i++)
+            function(i);
+        visible.clear();
+        bytes.clear();
+        out << "void main() {\n    printi(" << call(0) << ");\n}\n";
+        return out.str();
+    }
+
+private:
+    struct Function {
+        std::string name;
+        std::vector<bool> byte_formals;
+    };
+
+    GenOptions options;
+    std::mt19937 rng;
+    std::ostringstream out;
+    std::vector<Function> functions;
+    std::vector<std::vector<std::string>> visible;  // int names by open block
+    std::vector<std::string> bytes;                 // byte formals of the current function
+    int temps;
+    int budget;
+
+    int pick(int n) {
+        return n <= 0 ? 0 : (int) (rng() % n);
+    }
+
+    std::string indent(int level) {
+        return std::string(4 * (level + 1), ' ');
+    }
+
+    std::string anyInt() {
+        std::vector<std::string> names;
+        for (auto &block : visible)
+            names.insert(names.end(), block.begin(), block.end());
+        if (names.empty())
+            return std::to_string(pick(100));
+        return names[pick(names.size())];
+    }
+
+    std::string term(int call_depth) {
+        int kind = pick(10);
+        if (kind < 2)
+            return std::to_string(pick(100));
+        if (kind < 3 && !bytes.empty())
+            return bytes[pick(bytes.size())];
+        if (kind < 4 && !functions.empty() && call_depth == 0)
+            return call(1);
+        return anyInt();
+    }
+
+    std::string expression(int length, int call_depth = 0) {
+        static const char *ops[] = {" + ", " - ", " * "};
+        std::string text = term(call_depth);
+        for (int i = 0; i < length; i++) {
+            if (options.guards > 0 && pick(100) < options.guards)
+                text += " / " + divisor();
+            else
+                text += ops[pick(3)] + term(call_depth);
+        }
+        return text;
+    }
+
+    std::string divisor() {
+        int kind = pick(3);
+        if (kind == 0 || (kind == 1 && bytes.empty()))
+            return std::to_string(1 + pick(9));
+        if (kind == 1)
+            return "(" + bytes[pick(bytes.size())] + " + 1)";
+        std::string name = anyInt();
+        return "(" + name + " * " + name + " + 1)";
+    }
+
+    // A call to one of the functions generated so far, arguments are short expressions
+    std::string call(int call_depth) {
+        const Function &callee = functions[pick(functions.size())];
+        std::string text = callee.name + "(";
+        for (size_t i = 0; i < callee.byte_formals.size(); i++) {
+            if (i > 0)
+                text += ", ";
+            text += callee.byte_formals[i] ? std::to_string(pick(256)) + "b" : expression(1, call_depth);
+        }
+        return text + ")";
+    }
+
+    std::string condition() {
+        static const char *relops[] = {" < ", " > ", " == ", " != ", " <= ", " >= "};
+        std::string text = expression(options.expr / 2) + relops[pick(6)] + expression(options.expr / 2);
+        if (pick(3) == 0)
+            text += (pick(2) ? " and " : " or ") + anyInt() + relops[pick(6)] + std::to_string(pick(100));
+        return text;
+    }
+
+    void block(int level, int count, int depth) {
+        visible.emplace_back();
+        // A block holds at least one statement, the first one opens the deepest nesting allowed
+        for (int i = 0; i < count && (i == 0 || budget > 0); i++)
+            statement(level, depth, i == 0);
+        visible.pop_back();
+    }
+
+    void statement(int level, int depth, bool nest) {
+        budget--;
+        int kind = pick(10);
+        if (depth < options.depth && budget > 0 && (nest || kind < 3)) {
+            int inner = std::max(1, std::min(budget, 1 + pick(3)));
+            if (kind % 2 == 0) {
+                out << indent(level) << "if (" << condition() << ") {\n";
+                block(level + 1, inner, depth + 1);
+                if (pick(2) && budget > 0) {
+                    out << indent(level) << "} else {\n";
+                    block(level + 1, 1, depth + 1);
+                }
+            } else {
+                out << indent(level) << "while (" << condition() << ") {\n";
+                block(level + 1, inner, depth + 1);
+                if (pick(4) == 0)
+                    out << indent(level + 1) << "break;\n";
+            }
+            out << indent(level) << "}\n";
+        } else if (kind < 5) {
+            out << indent(level) << anyInt() << " = " << expression(options.expr) << ";\n";
+        } else if (kind < 7) {
+            std::string name = "t" + std::to_string(temps++);
+            out << indent(level) << "int " << name << " = " << expression(options.expr) << ";\n";
+            visible.back().push_back(name);
+        } else if (kind < 8 && !functions.empty()) {
+            out << indent(level) << anyInt() << " = " << call(0) << ";\n";
+        } else {
+            out << indent(level) << "printi(" << expression(options.expr) << ");\n";
+        }
+    }
+
+    void function(int index) {
+        Function func = {"f" + std::to_string(index), {}};
+        visible.assign(1, {});
+        bytes.clear();
+        temps = 0;
+        out << "int " << func.name << "(";
+        for (int i = 0; i < options.formals; i++) {
+            bool is_byte = i % 3 == 2;
+            std::string name = "p" + std::to_string(i);
+            out << (i > 0 ? ", " : "") << (is_byte ? "byte " : "int ") << name;
+            func.byte_formals.push_back(is_byte);
+            (is_byte ? bytes : visible.back()).push_back(name);
+        }
+        out << ") {\n";
+        // A byte local per byte formal, its truncation guard is redundant unless the divisor is 1
+        for (size_t i = 0; options.guards > 0 && i < func.byte_formals.size(); i++) {
+            if (!func.byte_formals[i])
+                continue;
+            std::string name = "c" + std::to_string(i);
+            out << indent(0) << "byte " << name << " = p" << i << " / " << 1 + pick(4) << "b + " << pick(100)
+                << "b;\n";
+            bytes.push_back(name);
+        }
+        for (int i = 0; i < options.identifiers; i++) {
+            std::string name = "v" + std::to_string(i);
+            out << indent(0) << "int " << name << " = " << expression(options.expr) << ";\n";
+            visible.back().push_back(name);
+        }
+        budget = options.statements;
+        while (budget > 0)
+            block(0, budget, 0);
+        out << indent(0) << "return " << expression(options.expr) << ";\n}\n\n";
+        functions.push_back(func);
+    }
+};
+
+struct Case {
+    std::string name;
+    GenOptions options;
+};
+
+// The base program and every axis scaled on its own
+static std::vector<Case> corpus() {
+    std::vector<Case> cases;
+    GenOptions base;
+    cases.push_back({"base", base});
+    for (int n : {5, 500, 2000}) {
+        GenOptions options = base;
+        options.functions = n;
+        cases.push_back({"functions-" + std::to_string(n), options});
+    }
+    for (int n : {5, 100, 400}) {
+        GenOptions options = base;
+        options.statements = n;
+        cases.push_back({"statements-" + std::to_string(n), options});
+    }
+    for (int n : {0, 6, 12}) {
+        GenOptions options = base;
+        options.depth = n;
+        options.statements = 40;
+        cases.push_back({"depth-" + std::to_string(n), options});
+    }
+    for (int n : {1, 16, 64}) {
+        GenOptions options = base;
+        options.expr = n;
+        cases.push_back({"expr-" + std::to_string(n), options});
+    }
+    for (int n : {2, 32, 128}) {
+        GenOptions options = base;
+        options.identifiers = n;
+        cases.push_back({"identifiers-" + std::to_string(n), options});
+    }
+    for (int n : {0, 8, 24}) {
+        GenOptions options = base;
+        options.formals = n;
+        cases.push_back({"formals-" + std::to_string(n), options});
+    }
+    for (int n : {10, 40}) {
+        GenOptions options = base;
+        options.guards = n;
+        options.formals = 6;
+        cases.push_back({"guards-" + std::to_string(n), options});
+    }
+    return cases;
+}
+
+static bool option(const char *arg, const char *name, std::string &value) {
+    size_t length = strlen(name);
+    if (strncmp(arg, name, length) != 0 || arg[length] != '=')
+        return false;
+    value = arg + length + 1;
+    return true;
+}
+
+static std::string readFile(const std::string &path) {
+    std::ifstream in(path, std::ios::binary);
+    std::stringstream text;
+    text << in.rdbuf();
+    return text.str();
+}
+
+// The number following "key": inside the first object named section, -1 if missing
+static double jsonNumber(const std::string &json, const std::string &section, const std::string &key) {
+    size_t start = section.empty() ? 0 : json.find("\"" + section + "\":");
+    if (start == std::string::npos)
+        return -1;
+    size_t at = json.find("\"" + key + "\":", start);
+    if (at == std::string::npos)
+        return -1;
+    return atof(json.c_str() + at + key.size() + 3);
+}
+
+static double median(std::vector<double> values) {
+    if (values.empty())
+        return 0;
+    std::sort(values.begin(), values.end());
+    size_t mid = values.size() / 2;
+    return values.size() % 2 ? values[mid] : (values[mid - 1] + values[mid]) / 2;
+}
+
+// Runs hw3 on a file, returns the wall time in ms or -1 if it failed or reported an error
+static double runOnce(const std::string &hw3, const std::string &input, const std::string &stats) {
+    auto start = std::chrono::steady_clock::now();
+    int out[2];
+    if (pipe(out) < 0)
+        return -1;
+    pid_t pid = fork();
+    if (pid == 0) {
+        int in = open(input.c_str(), O_RDONLY);
+        dup2(in, 0);
+        dup2(out[1], 1);
+        close(out[0]);
+        std::string flag = "--stats-json=" + stats;
+        execl(hw3.c_str(), hw3.c_str(), flag.c_str(), (char *) nullptr);
+        _exit(127);
+    }
+    close(out[1]);
+    // Only the first bytes are kept, an error is a single "line N: ..." line
+    std::string head;
+    char buffer[4096];
+    ssize_t n;
+    while ((n = read(out[0], buffer, sizeof(buffer))) > 0)
+        if (head.size() < 64)
+            head.append(buffer, n);
+    close(out[0]);
+    int status;
+    waitpid(pid, &status, 0);
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    bool ok = pid > 0 && WIFEXITED(status) && WEXITSTATUS(status) == 0 && head.compare(0, 5, "line ") != 0 &&
+              head.compare(0, 7, "Program") != 0;
+    return ok ? ms : -1;
+}
+
+// Runs hw3 on a file with the given report flags, returns what it wrote to stderr
+static std::string reportOf(const std::string &hw3, const std::string &input, const std::vector<std::string> &flags) {
+    int err[2];
+    if (pipe(err) < 0)
+        return "";
+    pid_t pid = fork();
+    if (pid == 0) {
+        int in = open(input.c_str(), O_RDONLY);
+        int null = open("/dev/null", O_WRONLY);
+        dup2(in, 0);
+        dup2(null, 1);
+        dup2(err[1], 2);
+        close(err[0]);
+        std::vector<char *> args = {const_cast<char *>(hw3.c_str())};
+        for (auto &flag : flags)
+            args.push_back(const_cast<char *>(flag.c_str()));
+        args.push_back(nullptr);
+        execv(hw3.c_str(), args.data());
+        _exit(127);
+    }
+    close(err[1]);
+    std::string report;
+    char buffer[4096];
+    ssize_t n;
+    while ((n = read(err[0], buffer, sizeof(buffer))) > 0)
+        report.append(buffer, n);
+    close(err[0]);
+    int status;
+    waitpid(pid, &status, 0);
+    return report;
+}
+
+// The two numbers of a "label X of Y" line of a report, -1 if missing
+static void countsOf(const std::string &report, const std::string &label, double &part, double &whole) {
+    size_t at = report.find(label);
+    part = whole = -1;
+    if (at != std::string::npos)
+        sscanf(report.c_str() + at + label.size(), "%lf of %lf", &part, &whole);
+}
+
+static int run(int argc, char *argv[]) {
+    std::string hw3 = "./hw3", corpus_dir = "bench/corpus", out_path = "bench/results.json", value;
+    int runs = 5;
+    for (int i = 2; i < argc; i++) {
+        if (option(argv[i], "--hw3", value))
+            hw3 = value;
+        else if (option(argv[i], "--runs", value))
+            runs = std::max(1, atoi(value.c_str()));
+        else if (option(argv[i], "--corpus", value))
+            corpus_dir = value;
+        else if (option(argv[i], "--out", value))
+            out_path = value;
+    }
+    if (system(("mkdir -p '" + corpus_dir + "'").c_str()) != 0)
+        return 1;
+
+    std::ostringstream json;
+    json << std::fixed << std::setprecision(4);
+    json << "{\"hw3\": \"" << hw3 << "\", \"runs\": " << runs << ", \"cases\": [";
+    bool failed = false;
+    std::vector<Case> cases = corpus();
+    for (size_t c = 0; c < cases.size(); c++) {
+        const Case &bench_case = cases[c];
+        std::string input = corpus_dir + "/" + bench_case.name + ".fanc";
+        std::string source = Generator(bench_case.options).program();
+        std::ofstream(input, std::ios::binary) << source;
+        std::string stats = corpus_dir + "/" + bench_case.name + ".stats.json";
+
+        std::vector<double> wall;
+        std::map<std::string, std::vector<double>> phases;
+        bool ok = true;
+        for (int r = 0; r < runs && ok; r++) {
+            double ms = runOnce(hw3, input, stats);
+            ok = ms >= 0;
+            wall.push_back(ms);
+            std::string report = readFile(stats);
+            for (const char *phase : PHASES)
+                phases[phase].push_back(jsonNumber(report, phase, "wall_ms"));
+        }
+        failed |= !ok;
+        // Counts do not vary between runs, one run reports them
+        std::string report = ok ? reportOf(hw3, input, {"--ranges", "--branch-stats"}) : "";
+        double truncs_removed, truncs, divs_removed, divs;
+        countsOf(report, "truncation guards removed: ", truncs_removed, truncs);
+        countsOf(report, "division guards removed: ", divs_removed, divs);
+        // The total line of --branch-stats, jump lists / materialised
+        double code[6] = {-1, -1, -1, -1, -1, -1};
+        size_t total = report.find("\ntotal ");
+        if (total != std::string::npos)
+            sscanf(report.c_str() + total, " total branches %lf/%lf jumps %lf/%lf instructions %lf/%lf", &code[0],
+                   &code[1], &code[2], &code[3], &code[4], &code[5]);
+
+        std::cerr << std::left << std::setw(16) << bench_case.name << std::right;
+        if (ok)
+            std::cerr << std::setw(10) << std::fixed << std::setprecision(3) << median(wall) << " ms"
+                      << std::setprecision(0) << "   guards removed: byte " << truncs_removed << "/" << truncs
+                      << ", division " << divs_removed << "/" << divs << "   branches " << code[0] << "/" << code[1]
+                      << std::endl;
+        else
+            std::cerr << "  failed, hw3 reports an error for " << input << std::endl;
+        json << (c == 0 ? "\n" : ",\n") << "  {\"name\": \"" << bench_case.name << "\", \"bytes\": " << source.size()
+             << ", \"ok\": " << (ok ? "true" : "false") << ", \"wall_ms\": " << median(wall);
+        for (const char *phase : PHASES)
+            json << ", \"" << phase << "_ms\": " << median(phases[phase]);
+        json << std::setprecision(0) << ", \"truncs\": " << truncs << ", \"truncs_removed\": " << truncs_removed
+             << ", \"div_checks\": " << divs << ", \"div_checks_removed\": " << divs_removed;
+        static const char *CODE[] = {"branches", "jumps", "instructions"};
+        for (int i = 0; i < 3; i++)
+            json << ", \"" << CODE[i] << "\": " << code[2 * i] << ", \"" << CODE[i] << "_materialised\": "
+                 << code[2 * i + 1];
+        json << std::setprecision(4);
+        json << "}";
+    }
+    json << "\n]}\n";
+    std::ofstream(out_path) << json.str();
+    std::cerr << "results written to " << out_path << std::endl;
+    return failed ? 1 : 0;
+}
+
+// Each case of a results file as name -> (metric -> ms)
+static std::map<std::string, std::map<std::string, double>> readResults(const std::string &path) {
+    std::map<std::string, std::map<std::string, double>> results;
+    std::string json = readFile(path);
+    size_t at = 0;
+    while ((at = json.find("{\"name\": \"", at)) != std::string::npos) {
+        size_t begin = at + 10, end = json.find('"', begin);
+        size_t close = json.find('}', end);
+        std::string entry = json.substr(at, close - at);
+        std::string name = json.substr(begin, end - begin);
+        results[name]["wall"] = jsonNumber(entry, "", "wall_ms");
+        for (const char *phase : PHASES)
+            results[name][phase] = jsonNumber(entry, "", std::string(phase) + "_ms");
+        at = close;
+    }
+    return results;
+}
+
+static int compare(int argc, char *argv[]) {
+    std::vector<std::string> paths;
+    double threshold = 10;
+    std::string value;
+    for (int i = 2; i < argc; i++) {
+        if (option(argv[i], "--threshold", value))
+            threshold = atof(value.c_str());
+        else
+            paths.push_back(argv[i]);
+    }
+    if (paths.size() != 2) {
+        std::cerr << "usage: fanc-bench compare BASE.json NEW.json [--threshold=PERCENT]" << std::endl;
+        return 2;
+    }
+    auto base = readResults(paths[0]);
+    auto current = readResults(paths[1]);
+    int regressions = 0;
+    std::cout << std::fixed << std::setprecision(3);
+    for (auto &entry : current) {
+        auto found = base.find(entry.first);
+        if (found == base.end())
+            continue;
+        for (auto &metric : entry.second) {
+            double before = found->second[metric.first], after = metric.second;
+            if (before <= 0 || after < 0)
+                continue;
+            double change = 100 * (after - before) / before;
+            bool regression = change > threshold && after - before > NOISE_MS;
+            regressions += regression;
+            if (metric.first == "wall" || regression)
+                std::cout << std::left << std::setw(16) << entry.first << std::setw(10) << metric.first << std::right
+                          << std::setw(10) << before << " -> " << std::setw(10) << after << " ms "
+                          << std::showpos << std::setprecision(1) << std::setw(7) << change << "%" << std::noshowpos
+                          << std::setprecision(3) << (regression ? "  REGRESSION" : "") << std::endl;
+        }
+    }
+    std::cout << std::setprecision(1) << regressions << " regression(s) above " << threshold << "%" << std::endl;
+    return regressions == 0 ? 0 : 1;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc >= 2 && strcmp(argv[1], "gen") == 0) {
+        GenOptions options;
+        std::string value;
+        for (int i = 2; i < argc; i++) {
+            if (option(argv[i], "--functions", value))
+                options.functions = std::max(1, atoi(value.c_str()));
+            else if (option(argv[i], "--statements", value))
+                options.statements = atoi(value.c_str());
+            else if (option(argv[i], "--depth", value))
+                options.depth = atoi(value.c_str());
+            else if (option(argv[i], "--expr", value))
+                options.expr = atoi(value.c_str());
+            else if (option(argv[i], "--identifiers", value))
+                options.identifiers = atoi(value.c_str());
+            else if (option(argv[i], "--formals", value))
+                options.formals = atoi(value.c_str());
+            else if (option(argv[i], "--guards", value))
+                options.guards = atoi(value.c_str());
+            else if (option(argv[i], "--seed", value))
+                options.seed = (unsigned) atoi(value.c_str());
+        }
+        std::cout << Generator(options).program();
+        return 0;
+    }
+    if (argc >= 2 && strcmp(argv[1], "run") == 0)
+        return run(argc, argv);
+    if (argc >= 2 && strcmp(argv[1], "compare") == 0)
+        return compare(argc, argv);
+    std::cerr << "usage: fanc-bench gen|run|compare ..." << std::endl;
+    return 2;
+}
@@ -0,0 +1,182 @@
+/* hw3-client: sends FanC sources to a running hw3 --serve.
+ *
+ *   hw3-client SOCKET [FILE]
+ *       compiles FILE (stdin without one) and prints what hw3 would print
+ *   hw3-client --bench=N [--clients=C] SOCKET FILE...
+ *       sends N requests, cycling over the files, from C concurrent connections and prints
+ *       requests per second and latency percentiles
+ *   hw3-client --bench=N [--clients=C] --fork=HW3 FILE...
+ *       the same measurement with one HW3 process per request, for comparison
+ */
+#include "../Protocol.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fcntl.h>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+static int connectTo(const char *path) {
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, path, sizeof(address.sun_path) - 1);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr *) &address, sizeof(address)) < 0) {
+        std::cerr << "hw3-client: cannot connect to " << path << ": " << strerror(errno) << std::endl;
+        exit(1);
+    }
+    return fd;
+}
+
+static bool request(int fd, protocol::FrameReader &reader, const std::string &source, std::string &output) {
+    std::string diagnostic;
+    if (!protocol::writeAll(fd, protocol::frame(source)) || !reader.readFrame(output) ||
+        !reader.readFrame(diagnostic))
+        return false;
+    output += diagnostic;
+    return true;
+}
+
+// Runs hw3 with source on stdin and collects its stdout
+static bool forkRequest(const char *compiler, const std::string &source, std::string &output) {
+    // Close on exec, so the pipes of concurrent requests do not leak into each other's children
+    int in[2], out[2];
+    if (pipe2(in, O_CLOEXEC) < 0 || pipe2(out, O_CLOEXEC) < 0)
+        return false;
+    pid_t pid = fork();
+    if (pid == 0) {
+        dup2(in[0], 0);
+        dup2(out[1], 1);
+        close(in[0]);
+        close(in[1]);
+        close(out[0]);
+        close(out[1]);
+        execl(compiler, compiler, (char *) nullptr);
+        _exit(127);
+    }
+    close(in[0]);
+    close(out[1]);
+    // Sources are small, hw3 reads all of stdin before it writes anything
+    protocol::writeAll(in[1], source);
+    close(in[1]);
+    output.clear();
+    char buffer[4096];
+    ssize_t n;
+    while ((n = read(out[0], buffer, sizeof(buffer))) > 0)
+        output.append(buffer, n);
+    close(out[0]);
+    int status;
+    waitpid(pid, &status, 0);
+    return pid > 0 && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+static std::string readFile(const char *path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        std::cerr << "hw3-client: cannot read " << path << std::endl;
+        exit(1);
+    }
+    std::stringstream text;
+    text << in.rdbuf();
+    return text.str();
+}
+
+static int bench(const char *socket_path, const char *compiler, const std::vector<std::string> &sources,
+                 int requests, int clients) {
+    std::vector<std::vector<double>> latencies(clients);
+    std::atomic<int> next(0), failures(0);
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int c = 0; c < clients; c++) {
+        threads.emplace_back([&, c] {
+            int fd = compiler == nullptr ? connectTo(socket_path) : -1;
+            protocol::FrameReader reader(fd);
+            std::string output;
+            for (int i = next++; i < requests; i = next++) {
+                const std::string &source = sources[i % sources.size()];
+                auto sent = std::chrono::steady_clock::now();
+                bool ok = compiler == nullptr ? request(fd, reader, source, output)
+                                              : forkRequest(compiler, source, output);
+                if (!ok)
+                    failures++;
+                latencies[c].push_back(std::chrono::duration<double, std::micro>(
+                        std::chrono::steady_clock::now() - sent).count());
+            }
+            if (fd >= 0)
+                close(fd);
+        });
+    }
+    for (auto &thread : threads)
+        thread.join();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::vector<double> all;
+    for (auto &latency : latencies)
+        all.insert(all.end(), latency.begin(), latency.end());
+    std::sort(all.begin(), all.end());
+    auto percentile = [&](double p) { return all.empty() ? 0.0 : all[std::min(all.size() - 1, (size_t) (p * all.size()))]; };
+    std::cout << (compiler == nullptr ? "server" : "fork per file") << ": " << requests << " requests, "
+              << clients << " clients, " << failures << " failed" << std::endl;
+    std::cout << "throughput: " << (int) (requests / seconds) << " requests/s" << std::endl;
+    std::cout << "latency: p50 " << percentile(0.50) << " us, p99 " << percentile(0.99) << " us, max "
+              << (all.empty() ? 0.0 : all.back()) << " us" << std::endl;
+    return failures == 0 ? 0 : 1;
+}
+
+int main(int argc, char *argv[]) {
+    int requests = 0;
+    int clients = 1;
+    const char *compiler = nullptr;
+    std::vector<const char *> positional;
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--bench=", 8) == 0)
+            requests = atoi(argv[i] + 8);
+        else if (strncmp(argv[i], "--clients=", 10) == 0)
+            clients = std::max(1, atoi(argv[i] + 10));
+        else if (strncmp(argv[i], "--fork=", 7) == 0)
+            compiler = argv[i] + 7;
+        else
+            positional.push_back(argv[i]);
+    }
+
+    if (requests > 0) {
+        size_t first = compiler == nullptr ? 1 : 0;
+        if (positional.size() <= first) {
+            std::cerr << "usage: hw3-client --bench=N [--clients=C] (SOCKET | --fork=HW3) FILE..." << std::endl;
+            return 2;
+        }
+        std::vector<std::string> sources;
+        for (size_t i = first; i < positional.size(); i++)
+            sources.push_back(readFile(positional[i]));
+        return bench(compiler == nullptr ? positional[0] : nullptr, compiler, sources, requests, clients);
+    }
+
+    if (positional.empty()) {
+        std::cerr << "usage: hw3-client SOCKET [FILE]" << std::endl;
+        return 2;
+    }
+    std::string source = positional.size() > 1
+                         ? readFile(positional[1])
+                         : std::string(std::istreambuf_iterator<char>(std::cin), std::istreambuf_iterator<char>());
+    int fd = connectTo(positional[0]);
+    protocol::FrameReader reader(fd);
+    std::string output;
+    if (!request(fd, reader, source, output)) {
+        std::cerr << "hw3-client: connection closed by the server" << std::endl;
+        return 1;
+    }
+    std::cout << output;
+    close(fd);
+    return 0;
+}
@@ -1,19 +1,294 @@
 #include "output.hpp"
 #include "nodes.hpp"
-#include "SemanticAnalyzer.hpp"
+#include "Compiler.hpp"
+#include "Server.hpp"
+#include "Batch.hpp"
+#include "Trace.hpp"
+#include "Inliner.hpp"
+#include "TailCalls.hpp"
+#include "Specializer.hpp"
+#include "Evaluator.hpp"
+#include "AnalysisCache.hpp"
+#include "CallGraph.hpp"
+#include "IncrementalCheck.hpp"
+#include "CodeGen.hpp"
+#include "RegAlloc.hpp"
+#include "RangeAnalysis.hpp"
+#include <algorithm>
+#include <iomanip>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <unistd.h>
 
-// Extern from the bison-generated parser
-extern int yyparse();
+// Writes the --trace file when main returns, whichever mode ran
+struct TraceWriter {
+    const char *path;
 
-extern std::shared_ptr<ast::Node> program;
+    ~TraceWriter() {
+        if (path != nullptr && !trace::write(path))
+            std::cerr << "hw3: cannot write " << path << std::endl;
+    }
+};
 
-int main() {
-    // Parse the input. The result is stored in the global variable `program`
-    yyparse();
-    //std::cout << "parse done" << std::endl;
-    // Print the AST using the PrintVisitor
-    SemanticAnalyzer sa;
-    program->accept(sa);
+static int usage(const std::string &problem) {
+    std::cerr << "hw3: " << problem << std::endl;
+    std::cerr << "usage: hw3 [options] < program.fanc" << std::endl;
+    std::cerr << "       hw3 --batch [--jobs=N] [--manifest=FILE] [--out-dir=DIR] [files...]" << std::endl;
+    std::cerr << "       hw3 --serve PATH [--workers=N]" << std::endl;
+    return 2;
+}
+
+int main(int argc, char *argv[]) {
+    InlineOptions inline_options;
+    EvalOptions eval_options;
+    bool tail_calls = false;
+    bool specialize = false;
+    int specialize_growth = 30;
+    bool emit_ir = false;
+    bool branch_stats = false;
+    bool register_stats = false;
+    bool range_checks = false;
+    bool call_graph = false;
+    int registers = regalloc::registerCount;
+    const char *cache_path = nullptr;
+    const char *serve_path = nullptr;
+    // Threads of --serve and of --batch, one per core when not given
+    int workers = 0;
+    int jobs = 0;
+    bool batch = false;
+    std::vector<std::string> batch_files;
+    const char *manifest = nullptr;
+    std::string out_dir;
+    bool print_stats = false;
+    const char *stats_json = nullptr;
+    const char *trace_path = nullptr;
+    int trace_scopes = 2;
+    long parse_depth = 0;
+    bool stream = false;
+    bool pipelined = false;
+    int incremental_edits = 0;
+    unsigned incremental_seed = 1;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--tco") == 0)
+            tail_calls = true;
+        else if (strcmp(argv[i], "--eval") == 0)
+            eval_options.enabled = true;
+        else if (strncmp(argv[i], "--eval-steps=", 13) == 0)
+            eval_options.max_steps = atoi(argv[i] + 13);
+        else if (strncmp(argv[i], "--eval-depth=", 13) == 0)
+            eval_options.max_depth = atoi(argv[i] + 13);
+        else if (strcmp(argv[i], "--specialize") == 0)
+            specialize = true;
+        else if (strncmp(argv[i], "--specialize-growth=", 20) == 0)
+            specialize_growth = atoi(argv[i] + 20);
+        else if (strcmp(argv[i], "--inline") == 0)
+            inline_options.enabled = true;
+        else if (strncmp(argv[i], "--inline-size=", 14) == 0)
+            inline_options.max_callee_size = atoi(argv[i] + 14);
+        else if (strncmp(argv[i], "--inline-growth=", 16) == 0)
+            inline_options.max_growth_percent = atoi(argv[i] + 16);
+        else if (strcmp(argv[i], "--no-inline-single") == 0)
+            inline_options.single_call_site = false;
+        else if (strcmp(argv[i], "--emit-ir") == 0)
+            emit_ir = true;
+        else if (strcmp(argv[i], "--branch-stats") == 0)
+            branch_stats = true;
+        else if (strcmp(argv[i], "--regalloc") == 0)
+            register_stats = true;
+        else if (strncmp(argv[i], "--regs=", 7) == 0)
+            registers = atoi(argv[i] + 7);
+        else if (strcmp(argv[i], "--ranges") == 0)
+            range_checks = true;
+        else if (strcmp(argv[i], "--callgraph") == 0)
+            call_graph = true;
+        else if (strncmp(argv[i], "--cache=", 8) == 0)
+            cache_path = argv[i] + 8;
+        else if (strcmp(argv[i], "--serve") == 0 && i + 1 < argc)
+            serve_path = argv[++i];
+        else if (strncmp(argv[i], "--serve=", 8) == 0)
+            serve_path = argv[i] + 8;
+        else if (strncmp(argv[i], "--workers=", 10) == 0)
+            workers = atoi(argv[i] + 10);
+        else if (strcmp(argv[i], "--batch") == 0)
+            batch = true;
+        else if (strncmp(argv[i], "--jobs=", 7) == 0)
+            jobs = atoi(argv[i] + 7);
+        else if (strncmp(argv[i], "--manifest=", 11) == 0)
+            manifest = argv[i] + 11;
+        else if (strncmp(argv[i], "--out-dir=", 10) == 0)
+            out_dir = argv[i] + 10;
+        else if (strcmp(argv[i], "--stats") == 0)
+            print_stats = true;
+        else if (strncmp(argv[i], "--stats-json=", 13) == 0)
+            stats_json = argv[i] + 13;
+        else if (strncmp(argv[i], "--trace=", 8) == 0)
+            trace_path = argv[i] + 8;
+        else if (strncmp(argv[i], "--trace-scopes=", 15) == 0)
+            trace_scopes = atoi(argv[i] + 15);
+        else if (strcmp(argv[i], "--stream") == 0)
+            stream = true;
+        else if (strcmp(argv[i], "--pipeline") == 0)
+            pipelined = true;
+        else if (strncmp(argv[i], "--parse-depth=", 14) == 0)
+            parse_depth = atol(argv[i] + 14);
+        else if (strncmp(argv[i], "--incremental-check=", 20) == 0)
+            incremental_edits = atoi(argv[i] + 20);
+        else if (strncmp(argv[i], "--incremental-seed=", 19) == 0)
+            incremental_seed = (unsigned) atol(argv[i] + 19);
+        else if (argv[i][0] != '-')
+            batch_files.push_back(argv[i]);
+        else
+            return usage("unknown option " + std::string(argv[i]));
+    }
+    // Without --batch the program is read from stdin, a file name would be silently ignored
+    if (!batch && !batch_files.empty())
+        return usage(batch_files.front() + ": input files are only read with --batch");
+    if (batch && workers > 0)
+        return usage("--batch takes --jobs=N, --workers=N is for --serve");
+    if (!batch && jobs > 0)
+        return usage("--jobs=N is only used with --batch");
+    int cores = std::max(1, (int) std::thread::hardware_concurrency());
+
+    TraceWriter trace_writer = {trace_path};
+    if (trace_path != nullptr) {
+        trace::start(trace_scopes);
+        trace::nameThread("main");
+    }
+    if (incremental_edits > 0) {
+        // Edits stdin with IncrementalParser and checks every result against a full parse
+        std::string text(std::istreambuf_iterator<char>(std::cin), (std::istreambuf_iterator<char>()));
+        try {
+            return incremental::check(text, incremental_edits, incremental_seed, std::cerr) == 0 ? 0 : 1;
+        } catch (const output::CompileError &error) {
+            std::cerr << "hw3: " << error.format(source::LineTable::of(text)) << std::endl;
+            return 1;
+        }
+    }
+    if (serve_path != nullptr)
+        return CompileServer(serve_path, workers > 0 ? workers : cores).run();
+    if (batch) {
+        if (manifest != nullptr && !BatchCompiler::readManifest(manifest, batch_files)) {
+            std::cerr << "hw3: cannot read " << manifest << std::endl;
+            return 1;
+        }
+        BatchCompiler compiler(batch_files, jobs > 0 ? jobs : cores, out_dir);
+        int status = compiler.run();
+        compiler.printSummary(std::cerr);
+        return status;
+    }
 
+    fanc::Options options;
+    options.stats = print_stats || stats_json != nullptr;
+    options.max_parse_depth = parse_depth;
+    options.pipeline = pipelined;
+    std::unique_ptr<AnalysisCache> cache;
+    if (cache_path != nullptr) {
+        cache.reset(new AnalysisCache(cache_path));
+        cache->load();
+        options.cache = cache.get();
+    }
+    // --stream parses stdin as it arrives, otherwise all of it is read first
+    std::string source;
+    if (!stream)
+        source.assign(std::istreambuf_iterator<char>(std::cin), std::istreambuf_iterator<char>());
+    fanc::Result result = stream ? fanc::compileStream(STDIN_FILENO, options)
+                                 : fanc::compile(source.data(), source.size(), options);
+    {
+        stats::PhaseTimer timer(options.stats ? &result.stats : nullptr, stats::PRINT);
+        if (result.ok())
+            std::cout << result.scopes << std::endl;
+        else
+            std::cout << result.diagnostics.front().message << std::endl;
+    }
+    stats::snapshot(options.stats ? &result.stats : nullptr, stats::PRINT);
+    if (print_stats)
+        stats::printTable(result.stats, std::cerr);
+    if (stats_json != nullptr) {
+        std::ofstream json(stats_json);
+        stats::printJson(result.stats, json);
+    }
+    if (!result.ok())
+        return 0;
+    if (cache) {
+        cache->save();
+        cache->printStats(std::cerr);
+    }
 
+    // Optimizations run on the checked AST and report to stderr, stdout keeps the analyzer output
+    auto funcs = result.program;
+    auto &functions = result.functions;
+    if (call_graph) {
+        trace::Span span("phase", "call graph");
+        // Of the program as written, before the passes below add and remove functions
+        CallGraph(*funcs).print(std::cerr);
+    }
+    if (tail_calls) {
+        trace::Span span("phase", "tco");
+        TailCallEliminator eliminator(functions);
+        eliminator.run(*funcs);
+        eliminator.printReport(std::cerr);
+    }
+    if (eval_options.enabled) {
+        trace::Span span("phase", "eval");
+        CompileTimeEvaluator evaluator(functions, eval_options);
+        evaluator.run(*funcs);
+        evaluator.printReport(std::cerr, result.lines);
+    }
+    if (specialize) {
+        trace::Span span("phase", "specialize");
+        Specializer specializer(functions, specialize_growth);
+        specializer.run(*funcs);
+        specializer.printReport(std::cerr);
+    }
+    if (inline_options.enabled) {
+        trace::Span span("phase", "inline");
+        Inliner inliner(functions, inline_options);
+        inliner.run(*funcs);
+        inliner.printReport(std::cerr, result.lines);
+    }
+    if (branch_stats) {
+        trace::Span span("phase", "branch stats");
+        // Compares the jump-list lowering of conditions with materialising every boolean
+        ir::Module lists = CodeGen(functions, true).run(*funcs);
+        ir::Module naive = CodeGen(functions, false).run(*funcs);
+        ir::CodeStats total_lists, total_naive;
+        std::cerr << "---branch stats (jump lists / materialised)---" << std::endl;
+        for (size_t i = 0; i < lists.functions.size(); i++) {
+            ir::CodeStats with = ir::countCode(lists.functions[i]);
+            ir::CodeStats without = ir::countCode(naive.functions[i]);
+            std::cerr << std::left << std::setw(20) << lists.functions[i].name << std::right
+                      << " branches " << with.branches << "/" << without.branches
+                      << " jumps " << with.jumps << "/" << without.jumps
+                      << " instructions " << with.instructions << "/" << without.instructions << std::endl;
+            total_lists.branches += with.branches;
+            total_lists.jumps += with.jumps;
+            total_lists.instructions += with.instructions;
+            total_naive.branches += without.branches;
+            total_naive.jumps += without.jumps;
+            total_naive.instructions += without.instructions;
+        }
+        std::cerr << std::left << std::setw(20) << "total" << std::right
+                  << " branches " << total_lists.branches << "/" << total_naive.branches
+                  << " jumps " << total_lists.jumps << "/" << total_naive.jumps
+                  << " instructions " << total_lists.instructions << "/" << total_naive.instructions << std::endl;
+    }
+    if (emit_ir || register_stats || range_checks) {
+        trace::Span span("phase", "ir");
+        ir::Module module = CodeGen(functions).run(*funcs);
+        if (range_checks) {
+            ranges::RangeStats total;
+            for (auto &func : module.functions)
+                total.add(ranges::RangeAnalysis(result.lines).run(func));
+            ranges::printStats(total, std::cerr);
+        }
+        if (register_stats) {
+            regalloc::LinearScan allocator(registers);
+            std::cerr << "---register allocation---" << std::endl;
+            for (auto &func : module.functions)
+                regalloc::printStats(allocator.allocate(func), std::cerr);
+        }
+        if (emit_ir)
+            ir::print(module, *result.literals, std::cerr);
+    }
 }
@@ -1,29 +1,29 @@
 #include "nodes.hpp"
+#include "Memory.hpp"
 #include <string>
 #include <utility>
 
-extern int yylineno;
-
 namespace ast {
 
-    Node::Node() : line(yylineno) {}
+    Node::Node(NodeKind kind) : offset(source::node_start), kind(kind) {}
 
-    Num::Num(const char *str) : Exp(), value(std::stoi(str)) {}
+    Num::Num(const char *str) : Exp(KIND), value(std::stoi(str)) {}
 
-    NumB::NumB(const char *str) : Exp(), value(std::stoi(str)) {}
+    NumB::NumB(const char *str) : Exp(KIND), value(std::stoi(str)) {}
 
-    String::String(const char *str) : Exp(), value(str) {
-        // Remove the quotes
-        value = value.substr(1, value.size() - 2);
-    }
+    String::String(literals::Index literal) : Exp(KIND), literal(literal) {}
 
-    Bool::Bool(bool value) : Exp(), value(value) {}
+    Bool::Bool(bool value) : Exp(KIND), value(value) {}
 
-    ID::ID(const char *str) : Exp(), value(str) { exp_symbols.insert(str); }
+    ID::ID(const char *str) : Exp(KIND), value(str) {
+        MEMORY_TAG(memory::FREE_VARIABLES);
+        exp_symbols.insert(str);
+    }
 
     BinOp::BinOp(std::shared_ptr<Exp> left, std::shared_ptr<Exp> right, BinOpType op)
-            : Exp(), left(std::move(left)), right(std::move(right)), op(op)
+            : Exp(KIND), left(std::move(left)), right(std::move(right)), op(op)
     {
+        MEMORY_TAG(memory::FREE_VARIABLES);
         if(left != nullptr)
             this->exp_symbols.insert(left->exp_symbols.begin(), left->exp_symbols.end());
         if(right != nullptr)
@@ -31,32 +31,36 @@ namespace ast {
     }
 
     RelOp::RelOp(std::shared_ptr<Exp> left, std::shared_ptr<Exp> right, RelOpType op)
-            : Exp(), left(std::move(left)), right(std::move(right)), op(op)
+            : Exp(KIND), left(std::move(left)), right(std::move(right)), op(op)
     {
+        MEMORY_TAG(memory::FREE_VARIABLES);
         if(left != nullptr)
             this->exp_symbols.insert(left->exp_symbols.begin(), left->exp_symbols.end());
         if(right != nullptr)
             this->exp_symbols.insert(right->exp_symbols.begin(),right->exp_symbols.end());
     }
 
-    Type::Type(BuiltInType type) : Node(), type(type) {}
+    Type::Type(BuiltInType type) : Node(KIND), type(type) {}
 
     Cast::Cast(std::shared_ptr<Exp> exp, std::shared_ptr<Type> target_type)
-            : Exp(), exp(std::move(exp)), target_type(std::move(target_type))
+            : Exp(KIND), exp(std::move(exp)), target_type(std::move(target_type))
     {
+        MEMORY_TAG(memory::FREE_VARIABLES);
         if(exp != nullptr)
             this->exp_symbols.insert(exp->exp_symbols.begin(), exp->exp_symbols.end());
     }
 
-    Not::Not(std::shared_ptr<Exp> exp) : Exp(), exp(std::move(exp))
+    Not::Not(std::shared_ptr<Exp> exp) : Exp(KIND), exp(std::move(exp))
     {
+        MEMORY_TAG(memory::FREE_VARIABLES);
         if(exp != nullptr)
             this->exp_symbols.insert(exp->exp_symbols.begin(), exp->exp_symbols.end());
     }
 
     And::And(std::shared_ptr<Exp> left, std::shared_ptr<Exp> right)
-            : Exp(), left(std::move(left)), right(std::move(right))
+            : Exp(KIND), left(std::move(left)), right(std::move(right))
     {
+        MEMORY_TAG(memory::FREE_VARIABLES);
         if(left != nullptr)
             this->exp_symbols.insert(left->exp_symbols.begin(), left->exp_symbols.end());
         if(right != nullptr)
@@ -64,15 +68,16 @@ namespace ast {
     }
 
     Or::Or(std::shared_ptr<Exp> left, std::shared_ptr<Exp> right)
-            : Exp(), left(std::move(left)), right(std::move(right))
+            : Exp(KIND), left(std::move(left)), right(std::move(right))
     {
+        MEMORY_TAG(memory::FREE_VARIABLES);
         if(left != nullptr)
             this->exp_symbols.insert(left->exp_symbols.begin(), left->exp_symbols.end());
         if(right != nullptr)
             this->exp_symbols.insert(right->exp_symbols.begin(),right->exp_symbols.end());
     }
 
-    ExpList::ExpList(std::shared_ptr<Exp> exp) : Node(), exps({std::move(exp)}) {}
+    ExpList::ExpList(std::shared_ptr<Exp> exp) : Node(KIND), exps({std::move(exp)}) {}
 
     void ExpList::push_front(const std::shared_ptr<Exp> &exp) {
         exps.insert(exps.begin(), exp);
@@ -83,12 +88,12 @@ namespace ast {
     }
 
     Call::Call(std::shared_ptr<ID> func_id, std::shared_ptr<ExpList> args)
-            : Exp(), func_id(std::move(func_id)), args(std::move(args)) {}
+            : Exp(KIND), func_id(std::move(func_id)), args(std::move(args)) {}
 
     Call::Call(std::shared_ptr<ID> func_id)
-            : Exp(), func_id(std::move(func_id)), args(std::make_shared<ExpList>()) {}
+            : Exp(KIND), func_id(std::move(func_id)), args(std::make_shared<ExpList>()) {}
 
-    Statements::Statements(std::shared_ptr<Statement> statement) : Statement(), statements({std::move(statement)}) {}
+    Statements::Statements(std::shared_ptr<Statement> statement) : Statement(KIND), statements({std::move(statement)}) {}
 
     void Statements::push_front(const std::shared_ptr<Statement> &statement) {
         statements.insert(statements.begin(), statement);
@@ -98,25 +103,25 @@ namespace ast {
         statements.push_back(statement);
     }
 
-    Return::Return(std::shared_ptr<Exp> exp) : Statement(), exp(std::move(exp)) {}
+    Return::Return(std::shared_ptr<Exp> exp) : Statement(KIND), exp(std::move(exp)) {}
 
     If::If(std::shared_ptr<Exp> condition, std::shared_ptr<Statement> then, std::shared_ptr<Statement> otherwise)
-            : Statement(), condition(std::move(condition)), then(std::move(then)), otherwise(std::move(otherwise)) {}
+            : Statement(KIND), condition(std::move(condition)), then(std::move(then)), otherwise(std::move(otherwise)) {}
 
     While::While(std::shared_ptr<Exp> condition, std::shared_ptr<Statement> body)
-            : Statement(), condition(std::move(condition)),
+            : Statement(KIND), condition(std::move(condition)),
               body(std::move(body)) {}
 
     VarDecl::VarDecl(std::shared_ptr<ID> id, std::shared_ptr<Type> type, std::shared_ptr<Exp> init_exp)
-            : Statement(), id(std::move(std::move(id))), type(std::move(type)), init_exp(std::move(init_exp)) {}
+            : Statement(KIND), id(std::move(std::move(id))), type(std::move(type)), init_exp(std::move(init_exp)) {}
 
     Assign::Assign(std::shared_ptr<ID> id, std::shared_ptr<Exp> exp)
-            : Statement(), id(std::move(id)), exp(std::move(exp)) {}
+            : Statement(KIND), id(std::move(id)), exp(std::move(exp)) {}
 
     Formal::Formal(std::shared_ptr<ID> id, std::shared_ptr<Type> type)
-            : Node(), id(std::move(id)), type(std::move(type)) {}
+            : Node(KIND), id(std::move(id)), type(std::move(type)) {}
 
-    Formals::Formals(std::shared_ptr<Formal> formal) : Node(), formals({std::move(formal)}) {}
+    Formals::Formals(std::shared_ptr<Formal> formal) : Node(KIND), formals({std::move(formal)}) {}
 
     void Formals::push_front(const std::shared_ptr<Formal> &formal) {
         formals.insert(formals.begin(), formal);
@@ -128,10 +133,10 @@ namespace ast {
 
     FuncDecl::FuncDecl(std::shared_ptr<ID> id, std::shared_ptr<Type> return_type, std::shared_ptr<Formals> formals,
                        std::shared_ptr<Statements> body)
-            : Node(), id(std::move(id)), return_type(std::move(return_type)), formals(std::move(formals)),
+            : Node(KIND), id(std::move(id)), return_type(std::move(return_type)), formals(std::move(formals)),
               body(std::move(body)) {}
 
-    Funcs::Funcs(std::shared_ptr<FuncDecl> func) : Node(), funcs({std::move(func)}) {}
+    Funcs::Funcs(std::shared_ptr<FuncDecl> func) : Node(KIND), funcs({std::move(func)}) {}
 
     void Funcs::push_front(const std::shared_ptr<FuncDecl> &func) {
         funcs.insert(funcs.begin(), func);
@@ -5,7 +5,11 @@
 #include <string>
 #include <vector>
 #include <set>
+#include <cstdlib>
+#include <utility>
 #include "visitor.hpp"
+#include "Literals.hpp"
+#include "Source.hpp"
 
 namespace ast {
 
@@ -31,144 +35,109 @@ namespace ast {
     /* Built-in types */
 
 
-    /* Base class for all AST nodes */
+    /* Base class for all AST nodes
+     * There are no virtual functions: the kind tells the class of a node, cast<T> checks it
+     * and visitExp / visitStatement switch on it to call a visitor statically.
+     */
     class Node {
     public:
-        // Line number in the source code
-        int line;
+        // Byte offset of the node's first token, see Source.hpp for its line and column
+        source::Offset offset;
+
+        // Class of the node, fixed at construction
+        const NodeKind kind;
 
         // Use this constructor only while parsing in bison or flex
-        Node();
+        explicit Node(NodeKind kind);
+    };
+
+    /* Base class for all statements */
+    class Statement : public Node {
+    public:
+        bool is_scope;
 
-        // Accept method for visitor pattern
-        virtual BuiltInType accept(Visitor &visitor) = 0;
-        virtual  BuiltInType accept(Visitor &visitor, int* p) = 0;
-        virtual  BuiltInType accept(Visitor &visitor, std::vector<BuiltInType>* params_type,std::vector<std::string>* params_name) = 0;
+        explicit Statement(NodeKind kind) : Node(kind), is_scope(false) {};
     };
 
-    /* Base class for all expressions */
-    class Exp : virtual public Node {
+    /* Base class for all expressions
+     * An expression is a statement so that a call can be both without virtual inheritance,
+     * cast<Statement> still only accepts calls among the expressions.
+     */
+    class Exp : public Statement {
     public:
         std::set<std::string> exp_symbols;
         std::set<std::string> get_symbols()
         {
             return exp_symbols;
         }
-        Exp() = default;
-    };
-
-    /* Base class for all statements */
-    class Statement : virtual public Node {
-    public:
-        bool is_scope;
-
-        Statement () :is_scope(false) {};
+        explicit Exp(NodeKind kind) : Statement(kind) {};
     };
 
     /* Number literal */
     class Num : public Exp {
     public:
+        static constexpr NodeKind KIND = NodeKind::Num;
+
         // Value of the number
         int value;
 
         // Constructor that receives a C-style string that represents the number
         explicit Num(const char *str);
-
-        BuiltInType accept(Visitor &visitor, int* p_val) override {
-            return visitor.visit(*this, p_val);
-        }
-        BuiltInType accept(Visitor &visitor) override {
-            return accept(visitor, nullptr);
-        }
-        BuiltInType accept(Visitor &visitor, std::vector<BuiltInType>* params_type,std::vector<std::string>* params_name) override {
-            return accept(visitor);
-        }
     };
 
     /* Byte literal */
     class NumB : public Exp {
     public:
+        static constexpr NodeKind KIND = NodeKind::NumB;
+
         // Value of the number
         int value;
 
         // Constructor that receives a C-style (including b character) string that represents the number
         explicit NumB(const char *str);
-
-        BuiltInType accept(Visitor &visitor, int* p_val) override {
-            return visitor.visit(*this, p_val);
-        }
-        BuiltInType accept(Visitor &visitor) override {
-            return accept(visitor, nullptr);
-        }
-        BuiltInType accept(Visitor &visitor, std::vector<BuiltInType>* params_type,std::vector<std::string>* params_name) override {
-            return accept(visitor);
-        }
     };
 
     /* String literal */
     class String : public Exp {
     public:
-        // Value of the string
-        std::string value;
+        static constexpr NodeKind KIND = NodeKind::String;
 
-        // Constructor that receives a C-style string that represents the string *including quotes*
-        explicit String(const char *str);
+        // Index of the decoded text in the literal pool of the compile (fanc::Result::literals)
+        literals::Index literal;
 
-        BuiltInType accept(Visitor &visitor, int* p_val) override {
-            return visitor.visit(*this, p_val);
-        }
-        BuiltInType accept(Visitor &visitor) override {
-            return accept(visitor, nullptr);
-        }
-        BuiltInType accept(Visitor &visitor, std::vector<BuiltInType>* params_type,std::vector<std::string>* params_name) override {
-            return accept(visitor);
-        }
+        explicit String(literals::Index literal);
     };
 
     /* Boolean literal */
     class Bool : public Exp {
     public:
+        static constexpr NodeKind KIND = NodeKind::Bool;
+
         // Value of the boolean
         bool value;
 
         // Constructor that receives the boolean value
         explicit Bool(bool value);
-
-        BuiltInType accept(Visitor &visitor, int* p_val) override {
-            return visitor.visit(*this, p_val);
-        }
-        BuiltInType accept(Visitor &visitor) override {
-            return accept(visitor, nullptr);
-        }
-        BuiltInType accept(Visitor &visitor, std::vector<BuiltInType>* params_type,std::vector<std::string>* params_name) override {
-            return accept(visitor);
-        }
     };
 
     /* Identifier */
     class ID : public Exp {
     public:
+        static constexpr NodeKind KIND = NodeKind::ID;
+
         // Name of the identifier
         std::string value;
 
         // Constructor that receives a C-style string that represents the identifier
         explicit ID(const char *str);
-
-        BuiltInType accept(Visitor &visitor, int* p_val) override {
-            return visitor.visit(*this, p_val);
-        }
-        BuiltInType accept(Visitor &visitor) override {
-            return accept(visitor, nullptr);
-        }
-        BuiltInType accept(Visitor &visitor, std::vector<BuiltInType>* params_type,std::vector<std::string>* params_name) override {
-            return accept(visitor);
-        }
     };
 
 
     /* Binary arithmetic operation */
     class BinOp : public Exp {
     public:
+        static constexpr NodeKind KIND = NodeKind::BinOp;
+
         // Left operand
         std::shared_ptr <Exp> left;
         // Right operand
@@ -178,22 +147,13 @@ namespace ast {
 
         // Constructor that receives the left and right operands and the operation
         BinOp(std::shared_ptr <Exp> left, std::shared_ptr <Exp> right, BinOpType op);
-
-
-        BuiltInType accept(Visitor &visitor, int* p_val) override {
-            return visitor.visit(*this, p_val);
-        }
-        BuiltInType accept(Visitor &visitor) override {
-            return accept(visitor, nullptr);
-        }
-        BuiltInType accept(Visitor &visitor, std::vector<BuiltInType>* params_type,std::vector<std::string>* params_name) override {
-            return accept(visitor);
-        }
     };
 
     /* Binary relational operation */
     class RelOp : public Exp {
     public:
+        static constexpr NodeKind KIND = NodeKind::RelOp;
+
         // Left operand
         std::shared_ptr <Exp> left;
         // Right operand
@@ -203,41 +163,25 @@ namespace ast {
 
         // Constructor that receives the left and right operands and the operation
         RelOp(std::shared_ptr <Exp> left, std::shared_ptr <Exp> right, RelOpType op);
-
-        BuiltInType accept(Visitor &visitor, int* p_val) override {
-            return visitor.visit(*this, p_val);
-        }
-        BuiltInType accept(Visitor &visitor) override {
-            return accept(visitor, nullptr);
-        }
-        BuiltInType accept(Visitor &visitor, std::vector<BuiltInType>* params_type,std::vector<std::string>* params_name) override {
-            return accept(visitor);
-        }
     };
 
     /* Unary logical NOT operation */
     class Not : public Exp {
     public:
+        static constexpr NodeKind KIND = NodeKind::Not;
+
         // Operand
         std::shared_ptr <Exp> exp;
 
         // Constructor that receives the operand
         explicit Not(std::shared_ptr <Exp> exp);
-
-        BuiltInType accept(Visitor &visitor, int* p_val) override {
-            return visitor.visit(*this, p_val);
-        }
-        BuiltInType accept(Visitor &visitor) override {
-            return accept(visitor, nullptr);
-        }
-        BuiltInType accept(Visitor &visitor, std::vector<BuiltInType>* params_type,std::vector<std::string>* params_name) override {
-            return accept(visitor);
-        }
     };
 
     /* Binary logical AND operation */
     class And : public Exp {
     public:
+        static constexpr NodeKind KIND = NodeKind::And;
+
         // Left operand
         std::shared_ptr <Exp> left;
         // Right operand
@@ -245,21 +189,13 @@ namespace ast {
 
         // Constructor that receives the left and right operands
         And(std::shared_ptr <Exp> left, std::shared_ptr <Exp> right);
-
-        BuiltInType accept(Visitor &visitor, int* p_val) override {
-            return visitor.visit(*this, p_val);
-        }
-        BuiltInType accept(Visitor &visitor) override {
-            return accept(visitor, nullptr);
-        }
-        BuiltInType accept(Visitor &visitor, std::vector<BuiltInType>* params_type,std::vector<std::string>* params_name) override {
-            return accept(visitor);
-        }
     };
 
     /* Binary logical OR operation */
     class Or : public Exp {
     public:
+        static constexpr NodeKind KIND = NodeKind::Or;
+
         // Left operand
         std::shared_ptr <Exp> left;
         // Right operand
@@ -267,42 +203,26 @@ namespace ast {
 
         // Constructor that receives the left and right operands
         Or(std::shared_ptr <Exp> left, std::shared_ptr <Exp> right);
-
-        BuiltInType accept(Visitor &visitor, int* p_val) override {
-            return visitor.visit(*this, p_val);
-        }
-        BuiltInType accept(Visitor &visitor) override {
-            return accept(visitor, nullptr);
-        }
-        BuiltInType accept(Visitor &visitor, std::vector<BuiltInType>* params_type,std::vector<std::string>* params_name) override {
-            return accept(visitor);
-        }
     };
 
     /* Type symbol */
     class Type : public Node {
     public:
+        static constexpr NodeKind KIND = NodeKind::Type;
+
         // Type
         BuiltInType type;
 
         // Constructor that receives the type
         explicit Type(BuiltInType type);
-
-        BuiltInType accept(Visitor &visitor) override {
-            return visitor.visit(*this);
-        }
-        BuiltInType accept(Visitor &visitor, int* p) override {
-            return accept(visitor);
-        }
-        BuiltInType accept(Visitor &visitor, std::vector<BuiltInType>* params_type,std::vector<std::string>* params_name) override {
-            return accept(visitor);
-        }
     };
 
 
     /* Type cast */
     class Cast : public Exp {
     public:
+        static constexpr NodeKind KIND = NodeKind::Cast;
+
         // Expression to be cast
         std::shared_ptr <Exp> exp;
         // Target type
@@ -310,26 +230,18 @@ namespace ast {
 
         // Constructor that receives the expression and the target type
         Cast(std::shared_ptr <Exp> exp, std::shared_ptr <Type> type);
-
-        BuiltInType accept(Visitor &visitor, int* p_val) override {
-            return visitor.visit(*this, p_val);
-        }
-        BuiltInType accept(Visitor &visitor) override {
-            return accept(visitor, nullptr);
-        }
-        BuiltInType accept(Visitor &visitor, std::vector<BuiltInType>* params_type,std::vector<std::string>* params_name) override {
-            return accept(visitor);
-        }
     };
 
     /* List of expressions */
     class ExpList : public Node {
     public:
+        static constexpr NodeKind KIND = NodeKind::ExpList;
+
         // List of expressions
         std::vector <std::shared_ptr<Exp>> exps;
 
         // Constructor that receives no expressions
-        ExpList() = default;
+        ExpList() : Node(KIND) {};
 
         // Constructor that receives the first expression
         explicit ExpList(std::shared_ptr <Exp> exp);
@@ -339,21 +251,13 @@ namespace ast {
 
         // Method to add an expression at the end of the list
         void push_back(const std::shared_ptr <Exp> &exp);
-
-        BuiltInType accept(Visitor &visitor) override {
-            return visitor.visit(*this, nullptr);
-        }
-        BuiltInType accept(Visitor &visitor, int* p) override {
-            return accept(visitor);
-        }
-        BuiltInType accept(Visitor &visitor, std::vector<BuiltInType>* params_type,std::vector<std::string>* params_name) override {
-            return accept(visitor);
-        }
     };
 
     /* Function call */
-    class Call : public Exp, public Statement {
+    class Call : public Exp {
     public:
+        static constexpr NodeKind KIND = NodeKind::Call;
+
         // Function identifier
         std::shared_ptr <ID> func_id;
         // List of arguments as expressions
@@ -364,26 +268,17 @@ namespace ast {
 
         // Constructor that receives only the function identifier (for parameterless functions)
         explicit Call(std::shared_ptr <ID> func_id);
-
-        BuiltInType accept(Visitor &visitor, int* p_val) override {
-            return visitor.visit(*this, p_val);
-        }
-
-        BuiltInType accept(Visitor &visitor) override {
-            return visitor.visit(*this);
-        }
-        BuiltInType accept(Visitor &visitor, std::vector<BuiltInType>* params_type,std::vector<std::string>* params_name) override {
-            return accept(visitor);
-        }
     };
 
     /* List of statements */
     class Statements : public Statement {
     public:
+        static constexpr NodeKind KIND = NodeKind::Statements;
+
         // List of statements
         std::vector <std::shared_ptr<Statement>> statements;
         // Constructor that receives no statements
-        Statements() = default;
+        Statements() : Statement(KIND) {};
 
         // Constructor that receives the first statement
         explicit Statements(std::shared_ptr <Statement> statement);
@@ -393,67 +288,41 @@ namespace ast {
 
         // Method to add a statement at the end of the list
         void push_back(const std::shared_ptr <Statement> &statement);
-
-        BuiltInType accept(Visitor &visitor) override {
-            return visitor.visit(*this );
-        }
-        BuiltInType accept(Visitor &visitor, int* p) override {
-            return accept(visitor);
-        }
-        BuiltInType accept(Visitor &visitor, std::vector<BuiltInType>* params_type,std::vector<std::string>* params_name) override {
-            return accept(visitor);
-        }
     };
 
     /* Break statement */
     class Break : public Statement {
-        BuiltInType accept(Visitor &visitor) override {
-            return visitor.visit(*this );
-        }
-        BuiltInType accept(Visitor &visitor, int* p) override {
-            return accept(visitor);
-        }
-        BuiltInType accept(Visitor &visitor, std::vector<BuiltInType>* params_type,std::vector<std::string>* params_name) override {
-            return accept(visitor);
-        }
+    public:
+        static constexpr NodeKind KIND = NodeKind::Break;
+
+        Break() : Statement(KIND) {};
     };
 
     /* Continue statement */
     class Continue : public Statement {
-        BuiltInType accept(Visitor &visitor) override {
-            return visitor.visit(*this );
-        }
-        BuiltInType accept(Visitor &visitor, int* p) override {
-            return accept(visitor);
-        }
-        BuiltInType accept(Visitor &visitor, std::vector<BuiltInType>* params_type,std::vector<std::string>* params_name) override {
-            return accept(visitor);
-        }
+    public:
+        static constexpr NodeKind KIND = NodeKind::Continue;
+
+        Continue() : Statement(KIND) {};
     };
 
     /* Return statement */
     class Return : public Statement {
     public:
+        static constexpr NodeKind KIND = NodeKind::Return;
+
         // Expression to be returned. If the return is expressionless, this field is nullptr
         std::shared_ptr <Exp> exp;
 
         // Constructor that receives the expression to be returned
         explicit Return(std::shared_ptr <Exp> exp = nullptr);
-
-        BuiltInType accept(Visitor &visitor) override {
-            return visitor.visit(*this );
-        }
-        BuiltInType accept(Visitor &visitor, int* p) override {
-            return accept(visitor);
-        }
-        BuiltInType accept(Visitor &visitor, std::vector<BuiltInType>* params_type,std::vector<std::string>* params_name) override {
-            return accept(visitor);
-        }
     };
 
     /* If statement */
     class If : public Statement {
     public:
+        static constexpr NodeKind KIND = NodeKind::If;
+
         // Condition expression
         std::shared_ptr <Exp> condition;
         // Statement to be executed if the condition is true
@@ -464,21 +333,13 @@ namespace ast {
         // Constructor that receives the condition, the statement to be executed if the condition is true, and the statement to be executed if the condition is false
         If(std::shared_ptr <Exp> condition, std::shared_ptr <Statement> then,
            std::shared_ptr <Statement> otherwise = nullptr);
-
-        BuiltInType accept(Visitor &visitor) override {
-            return visitor.visit(*this );
-        }
-        BuiltInType accept(Visitor &visitor, int* p) override {
-            return accept(visitor);
-        }
-        BuiltInType accept(Visitor &visitor, std::vector<BuiltInType>* params_type,std::vector<std::string>* params_name) override {
-            return accept(visitor);
-        }
     };
 
     /* While statement */
     class While : public Statement {
     public:
+        static constexpr NodeKind KIND = NodeKind::While;
+
         // Condition expression
         std::shared_ptr <Exp> condition;
         // Statement to be executed while the condition is true
@@ -486,21 +347,13 @@ namespace ast {
 
         // Constructor that receives the condition and the statement to be executed while the condition is true
         While(std::shared_ptr <Exp> condition, std::shared_ptr <Statement> body);
-
-        BuiltInType accept(Visitor &visitor) override {
-            return visitor.visit(*this );
-        }
-        BuiltInType accept(Visitor &visitor, int* p) override {
-            return accept(visitor);
-        }
-        BuiltInType accept(Visitor &visitor, std::vector<BuiltInType>* params_type,std::vector<std::string>* params_name) override {
-            return accept(visitor);
-        }
     };
 
     /* Variable declaration */
     class VarDecl : public Statement {
     public:
+        static constexpr NodeKind KIND = NodeKind::VarDecl;
+
         // Identifier of the variable
         std::shared_ptr <ID> id;
         // Type of the variable
@@ -510,21 +363,13 @@ namespace ast {
 
         // Constructor that receives the identifier, the type, and the initial value expression
         VarDecl(std::shared_ptr <ID> id, std::shared_ptr <Type> type, std::shared_ptr <Exp> init_exp = nullptr);
-
-        BuiltInType accept(Visitor &visitor) override {
-            return visitor.visit(*this );
-        }
-        BuiltInType accept(Visitor &visitor, int* p) override {
-            return accept(visitor);
-        }
-        BuiltInType accept(Visitor &visitor, std::vector<BuiltInType>* params_type,std::vector<std::string>* params_name) override {
-            return accept(visitor);
-        }
     };
 
     /* Assignment statement */
     class Assign : public Statement {
     public:
+        static constexpr NodeKind KIND = NodeKind::Assign;
+
         // Identifier of the variable
         std::shared_ptr <ID> id;
         // Expression to be assigned
@@ -532,21 +377,13 @@ namespace ast {
 
         // Constructor that receives the identifier and the expression to be assigned
         Assign(std::shared_ptr <ID> id, std::shared_ptr <Exp> exp);
-
-        BuiltInType accept(Visitor &visitor) override {
-            return visitor.visit(*this );
-        }
-        BuiltInType accept(Visitor &visitor, int* p) override {
-            return accept(visitor);
-        }
-        BuiltInType accept(Visitor &visitor, std::vector<BuiltInType>* params_type,std::vector<std::string>* params_name) override {
-            return accept(visitor);
-        }
     };
 
     /* Formal parameter */
     class Formal : public Node {
     public:
+        static constexpr NodeKind KIND = NodeKind::Formal;
+
         // Identifier of the parameter
         std::shared_ptr <ID> id;
         // Type of the parameter
@@ -554,26 +391,18 @@ namespace ast {
 
         // Constructor that receives the identifier and the type
         Formal(std::shared_ptr <ID> id, std::shared_ptr <Type> type);
-
-        BuiltInType accept(Visitor &visitor) override {
-            return visitor.visit(*this );
-        }
-        BuiltInType accept(Visitor &visitor, int* p) override {
-            return accept(visitor);
-        }
-        BuiltInType accept(Visitor &visitor, std::vector<BuiltInType>* params_type,std::vector<std::string>* params_name) override {
-            return accept(visitor);
-        }
     };
 
     /* List of formal parameters */
     class Formals : public Node {
     public:
+        static constexpr NodeKind KIND = NodeKind::Formals;
+
         // List of formal parameters
         std::vector <std::shared_ptr<Formal>> formals;
 
         // Constructor that receives no parameters
-        Formals() = default;
+        Formals() : Node(KIND) {};
 
         // Constructor that receives the first formal parameter
         explicit Formals(std::shared_ptr <Formal> formal);
@@ -583,21 +412,13 @@ namespace ast {
 
         // Method to add a formal parameter at the end of the list
         void push_back(const std::shared_ptr <Formal> &formal);
-
-        BuiltInType accept(Visitor &visitor, std::vector<BuiltInType>* params_type,std::vector<std::string>* params_name) override {
-            return visitor.visit(*this , params_type, params_name);
-        }
-        BuiltInType accept(Visitor &visitor, int* p) override {
-            return accept(visitor, nullptr, nullptr);
-        }
-        BuiltInType accept(Visitor &visitor) override {
-            return accept(visitor, nullptr, nullptr);
-        }
     };
 
     /* Function declaration */
     class FuncDecl : public Node {
     public:
+        static constexpr NodeKind KIND = NodeKind::FuncDecl;
+
         // Identifier of the function
         std::shared_ptr <ID> id;
         // Return type of the function
@@ -610,26 +431,18 @@ namespace ast {
         // Constructor that receives the identifier, the return type, the list of formal parameters, and the body
         FuncDecl(std::shared_ptr <ID> id, std::shared_ptr <Type> return_type, std::shared_ptr <Formals> formals,
                  std::shared_ptr <Statements> body);
-
-        BuiltInType accept(Visitor &visitor) override {
-            return visitor.visit(*this );
-        }
-        BuiltInType accept(Visitor &visitor, int* p) override {
-            return accept(visitor);
-        }
-        BuiltInType accept(Visitor &visitor, std::vector<BuiltInType>* params_type,std::vector<std::string>* params_name) override {
-            return accept(visitor);
-        }
     };
 
     /* List of function declarations */
     class Funcs : public Node {
     public:
+        static constexpr NodeKind KIND = NodeKind::Funcs;
+
         // List of function declarations
         std::vector <std::shared_ptr<FuncDecl>> funcs;
 
         // Constructor that receives no function declarations
-        Funcs() = default;
+        Funcs() : Node(KIND) {};
 
         // Constructor that receives the first function declaration
         explicit Funcs(std::shared_ptr <FuncDecl> func);
@@ -639,22 +452,90 @@ namespace ast {
 
         // Method to add a function declaration at the end of the list
         void push_back(const std::shared_ptr <FuncDecl> &func);
-
-        BuiltInType accept(Visitor &visitor) override {
-            return visitor.visit(*this );
-        }
-        BuiltInType accept(Visitor &visitor, int* p) override {
-            return accept(visitor);
-        }
-        BuiltInType accept(Visitor &visitor, std::vector<BuiltInType>* params_type,std::vector<std::string>* params_name) override {
-            return accept(visitor);
-        }
     };
 
+    // Whether a node of the given kind is a T, the replacement of dynamic_cast
+    template<typename T>
+    inline bool isKind(NodeKind kind) {
+        return kind == T::KIND;
+    }
+
+    template<>
+    inline bool isKind<Node>(NodeKind) {
+        return true;
+    }
+
+    template<>
+    inline bool isKind<Exp>(NodeKind kind) {
+        return kind >= NodeKind::Num && kind <= NodeKind::Call;
+    }
+
+    template<>
+    inline bool isKind<Statement>(NodeKind kind) {
+        return kind >= NodeKind::Call && kind <= NodeKind::Assign;
+    }
+
+    // The node as a T, nullptr if it is null or of another class
+    template<typename T, typename From>
+    inline T *cast(From *node) {
+        return node != nullptr && isKind<T>(node->kind) ? static_cast<T *>(node) : nullptr;
+    }
+
+    template<typename T, typename From>
+    inline std::shared_ptr<T> cast(const std::shared_ptr<From> &node) {
+        return node != nullptr && isKind<T>(node->kind) ? std::static_pointer_cast<T>(node) : nullptr;
+    }
+
+    // Calls visitor.visit(exp, args...) with exp as its own class, a switch instead of a virtual call
+    template<typename Visitor, typename... Args>
+    inline auto visitExp(Exp &exp, Visitor &visitor, Args &&... args)
+            -> decltype(visitor.visit(static_cast<Num &>(exp), std::forward<Args>(args)...)) {
+        switch (exp.kind) {
+            case NodeKind::Num: return visitor.visit(static_cast<Num &>(exp), std::forward<Args>(args)...);
+            case NodeKind::NumB: return visitor.visit(static_cast<NumB &>(exp), std::forward<Args>(args)...);
+            case NodeKind::String: return visitor.visit(static_cast<String &>(exp), std::forward<Args>(args)...);
+            case NodeKind::Bool: return visitor.visit(static_cast<Bool &>(exp), std::forward<Args>(args)...);
+            case NodeKind::ID: return visitor.visit(static_cast<ID &>(exp), std::forward<Args>(args)...);
+            case NodeKind::BinOp: return visitor.visit(static_cast<BinOp &>(exp), std::forward<Args>(args)...);
+            case NodeKind::RelOp: return visitor.visit(static_cast<RelOp &>(exp), std::forward<Args>(args)...);
+            case NodeKind::Not: return visitor.visit(static_cast<Not &>(exp), std::forward<Args>(args)...);
+            case NodeKind::And: return visitor.visit(static_cast<And &>(exp), std::forward<Args>(args)...);
+            case NodeKind::Or: return visitor.visit(static_cast<Or &>(exp), std::forward<Args>(args)...);
+            case NodeKind::Cast: return visitor.visit(static_cast<Cast &>(exp), std::forward<Args>(args)...);
+            case NodeKind::Call: return visitor.visit(static_cast<Call &>(exp), std::forward<Args>(args)...);
+            default: abort();
+        }
+    }
+
+    // The same for statements, a call is visited as a statement here
+    template<typename Visitor, typename... Args>
+    inline auto visitStatement(Statement &statement, Visitor &visitor, Args &&... args)
+            -> decltype(visitor.visit(static_cast<Break &>(statement), std::forward<Args>(args)...)) {
+        switch (statement.kind) {
+            case NodeKind::Call:
+                return visitor.visit(static_cast<Call &>(statement), std::forward<Args>(args)...);
+            case NodeKind::Statements:
+                return visitor.visit(static_cast<Statements &>(statement), std::forward<Args>(args)...);
+            case NodeKind::Break:
+                return visitor.visit(static_cast<Break &>(statement), std::forward<Args>(args)...);
+            case NodeKind::Continue:
+                return visitor.visit(static_cast<Continue &>(statement), std::forward<Args>(args)...);
+            case NodeKind::Return:
+                return visitor.visit(static_cast<Return &>(statement), std::forward<Args>(args)...);
+            case NodeKind::If:
+                return visitor.visit(static_cast<If &>(statement), std::forward<Args>(args)...);
+            case NodeKind::While:
+                return visitor.visit(static_cast<While &>(statement), std::forward<Args>(args)...);
+            case NodeKind::VarDecl:
+                return visitor.visit(static_cast<VarDecl &>(statement), std::forward<Args>(args)...);
+            case NodeKind::Assign:
+                return visitor.visit(static_cast<Assign &>(statement), std::forward<Args>(args)...);
+            default: abort();
+        }
+    }
 }
 
-
-
 #define YYSTYPE std::shared_ptr<ast::Node>
+#define YYLTYPE source::Offset
 
 #endif //NODES_HPP
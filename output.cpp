@@ -1,4 +1,5 @@
 #include "output.hpp"
+#include "Memory.hpp"
 #include <iostream>
 
 namespace output {
@@ -23,82 +24,82 @@ namespace output {
 
     /* Error handling functions */
 
-    void errorLex(int lineno) {
-        std::cout << "line " << lineno << ": lexical error\n";
-        exit(0);
+    CompileError::CompileError(source::Offset offset, const std::string &message)
+            : std::runtime_error(message), offset(offset) {}
+
+    std::string CompileError::format(const source::LineTable &lines) const {
+        if (offset == source::NOWHERE)
+            return what();
+        return "line " + std::to_string(lines.line(offset)) + ": " + what();
+    }
+
+    void errorLex(source::Offset offset) {
+        throw CompileError(offset, "lexical error");
     }
 
-    void errorSyn(int lineno) {
-        std::cout << "line " << lineno << ": syntax error\n";
-        exit(0);
+    void errorSyn(source::Offset offset) {
+        throw CompileError(offset, "syntax error");
     }
 
-    void errorUndef(int lineno, const std::string &id) {
-        std::cout << "line " << lineno << ":" << " variable " << id << " is not defined" << std::endl;
-        exit(0);
+    void errorUndef(source::Offset offset, const std::string &id) {
+        throw CompileError(offset, "variable " + id + " is not defined");
     }
 
-    void errorDefAsFunc(int lineno, const std::string &id) {
-        std::cout << "line " << lineno << ":" << " symbol " << id << " is a function" << std::endl;
-        exit(0);
+    void errorDefAsFunc(source::Offset offset, const std::string &id) {
+        throw CompileError(offset, "symbol " + id + " is a function");
     }
 
-    void errorDefAsVar(int lineno, const std::string &id) {
-        std::cout << "line " << lineno << ":" << " symbol " << id << " is a variable" << std::endl;
-        exit(0);
+    void errorDefAsVar(source::Offset offset, const std::string &id) {
+        throw CompileError(offset, "symbol " + id + " is a variable");
     }
 
-    void errorDef(int lineno, const std::string &id) {
-        std::cout << "line " << lineno << ":" << " symbol " << id << " is already defined" << std::endl;
-        exit(0);
+    void errorDef(source::Offset offset, const std::string &id) {
+        throw CompileError(offset, "symbol " + id + " is already defined");
     }
 
-    void errorUndefFunc(int lineno, const std::string &id) {
-        std::cout << "line " << lineno << ":" << " function " << id << " is not defined" << std::endl;
-        exit(0);
+    void errorUndefFunc(source::Offset offset, const std::string &id) {
+        throw CompileError(offset, "function " + id + " is not defined");
     }
 
-    void errorMismatch(int lineno) {
-        std::cout << "line " << lineno << ":" << " type mismatch" << std::endl;
-        exit(0);
+    void errorMismatch(source::Offset offset) {
+        throw CompileError(offset, "type mismatch");
     }
 
-    void errorPrototypeMismatch(int lineno, const std::string &id, std::vector<std::string> &paramTypes) {
-        std::cout << "line " << lineno << ": prototype mismatch, function " << id << " expects parameters (";
+    void errorPrototypeMismatch(source::Offset offset, const std::string &id, std::vector<std::string> &paramTypes) {
+        std::string message = "prototype mismatch, function " + id + " expects parameters (";
 
         for (int i = 0; i < paramTypes.size(); ++i) {
-            std::cout << paramTypes[i];
+            message += paramTypes[i];
             if (i != paramTypes.size() - 1)
-                std::cout << ",";
+                message += ",";
         }
 
-        std::cout << ")" << std::endl;
-        exit(0);
+        throw CompileError(offset, message + ")");
     }
 
-    void errorUnexpectedBreak(int lineno) {
-        std::cout << "line " << lineno << ":" << " unexpected break statement" << std::endl;
-        exit(0);
+    void errorUnexpectedBreak(source::Offset offset) {
+        throw CompileError(offset, "unexpected break statement");
     }
 
-    void errorUnexpectedContinue(int lineno) {
-        std::cout << "line " << lineno << ":" << " unexpected continue statement" << std::endl;
-        exit(0);
+    void errorUnexpectedContinue(source::Offset offset) {
+        throw CompileError(offset, "unexpected continue statement");
     }
 
     void errorMainMissing() {
-        std::cout << "Program has no 'void main()' function" << std::endl;
-        exit(0);
+        throw CompileError(source::NOWHERE, "Program has no 'void main()' function");
     }
 
-    void errorByteTooLarge(int lineno, const int value) {
-        std::cout << "line " << lineno << ": byte value " << value << " out of range" << std::endl;
-        exit(0);
+    void errorByteTooLarge(source::Offset offset, const int value) {
+        throw CompileError(offset, "byte value " + std::to_string(value) + " out of range");
     }
 
     /* ScopePrinter class */
 
-    ScopePrinter::ScopePrinter() : indentLevel(0) {}
+    ScopePrinter::ScopePrinter() : capturing(false), indentLevel(0) {}
+
+    std::ostream &ScopePrinter::stream() {
+        return capturing ? block : buffer;
+    }
 
     std::string ScopePrinter::indent() const {
         std::string result;
@@ -109,21 +110,25 @@ namespace output {
     }
 
     void ScopePrinter::beginScope() {
+        MEMORY_TAG(memory::OUTPUT);
         indentLevel++;
-        buffer << indent() << "---begin scope---" << std::endl;
+        stream() << indent() << "---begin scope---" << std::endl;
     }
 
     void ScopePrinter::endScope() {
-        buffer << indent() << "---end scope---" << std::endl;
+        MEMORY_TAG(memory::OUTPUT);
+        stream() << indent() << "---end scope---" << std::endl;
         indentLevel--;
     }
 
     void ScopePrinter::emitVar(const std::string &id, const ast::BuiltInType &type, int offset) {
-        buffer << indent() << id << " " << toString(type) << " " << offset << std::endl;
+        MEMORY_TAG(memory::OUTPUT);
+        stream() << indent() << id << " " << toString(type) << " " << offset << std::endl;
     }
 
     void ScopePrinter::emitFunc(const std::string &id, const ast::BuiltInType &returnType,
                                 const std::vector<ast::BuiltInType> &paramTypes) {
+        MEMORY_TAG(memory::OUTPUT);
         globalsBuffer << id << " " << "(";
 
         for (int i = 0; i < paramTypes.size(); ++i) {
@@ -135,7 +140,26 @@ namespace output {
         globalsBuffer << ")" << " -> " << toString(returnType) << std::endl;
     }
 
+    void ScopePrinter::beginCapture() {
+        block.str("");
+        capturing = true;
+    }
+
+    std::string ScopePrinter::endCapture() {
+        MEMORY_TAG(memory::OUTPUT);
+        capturing = false;
+        std::string text = block.str();
+        buffer << text;
+        return text;
+    }
+
+    void ScopePrinter::replay(const std::string &text) {
+        MEMORY_TAG(memory::OUTPUT);
+        stream() << text;
+    }
+
     std::ostream &operator<<(std::ostream &os, const ScopePrinter &printer) {
+        MEMORY_TAG(memory::OUTPUT);
         os << "---begin global scope---" << std::endl;
         os << printer.globalsBuffer.str();
         os << printer.buffer.str();
@@ -4,37 +4,54 @@
 #include <vector>
 #include <string>
 #include <sstream>
+#include <stdexcept>
 #include "visitor.hpp"
 #include "nodes.hpp"
+#include "Source.hpp"
 
 namespace output {
-    /* Error handling functions */
+    /* Thrown by the error functions, what() is the message the compiler prints without its line.
+     * Errors only keep the offset, the line is looked up once the scanner has recorded every
+     * line start, which the parser may be ahead of (see Pipeline.hpp).
+     */
+    class CompileError : public std::runtime_error {
+    public:
+        // source::NOWHERE for errors about the whole program
+        source::Offset offset;
+
+        CompileError(source::Offset offset, const std::string &message);
+
+        // The message as printed, "line 3: type mismatch"
+        std::string format(const source::LineTable &lines) const;
+    };
 
-    void errorLex(int lineno);
+    /* Error handling functions, each one throws CompileError */
 
-    void errorSyn(int lineno);
+    void errorLex(source::Offset offset);
 
-    void errorUndef(int lineno, const std::string &id);
+    void errorSyn(source::Offset offset);
 
-    void errorDefAsFunc(int lineno, const std::string &id);
+    void errorUndef(source::Offset offset, const std::string &id);
 
-    void errorUndefFunc(int lineno, const std::string &id);
+    void errorDefAsFunc(source::Offset offset, const std::string &id);
 
-    void errorDefAsVar(int lineno, const std::string &id);
+    void errorUndefFunc(source::Offset offset, const std::string &id);
 
-    void errorDef(int lineno, const std::string &id);
+    void errorDefAsVar(source::Offset offset, const std::string &id);
 
-    void errorPrototypeMismatch(int lineno, const std::string &id, std::vector<std::string> &paramTypes);
+    void errorDef(source::Offset offset, const std::string &id);
 
-    void errorMismatch(int lineno);
+    void errorPrototypeMismatch(source::Offset offset, const std::string &id, std::vector<std::string> &paramTypes);
 
-    void errorUnexpectedBreak(int lineno);
+    void errorMismatch(source::Offset offset);
 
-    void errorUnexpectedContinue(int lineno);
+    void errorUnexpectedBreak(source::Offset offset);
+
+    void errorUnexpectedContinue(source::Offset offset);
 
     void errorMainMissing();
 
-    void errorByteTooLarge(int lineno, int value);
+    void errorByteTooLarge(source::Offset offset, int value);
 
     /* ScopePrinter class
      * This class is used to print scopes in a human-readable format.
@@ -43,10 +60,14 @@ namespace output {
     private:
         std::stringstream globalsBuffer;
         std::stringstream buffer;
+        std::stringstream block;
+        bool capturing;
         int indentLevel;
 
         std::string indent() const;
 
+        std::ostream &stream();
+
     public:
         ScopePrinter();
 
@@ -59,6 +80,14 @@ namespace output {
         void emitFunc(const std::string &id, const ast::BuiltInType &returnType,
                       const std::vector<ast::BuiltInType> &paramTypes);
 
+        // Everything emitted between the two calls is also returned as one block
+        void beginCapture();
+
+        std::string endCapture();
+
+        // Appends a block returned by endCapture in an earlier run
+        void replay(const std::string &text);
+
         friend std::ostream &operator<<(std::ostream &os, const ScopePrinter &printer);
     };
 }
@@ -1,20 +1,99 @@
 %{
 #include "nodes.hpp"
 #include "output.hpp"
+#include "Stats.hpp"
+#include "Memory.hpp"
+#include "AstUtils.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
 
 // bison declarations
-extern int yylineno;
 extern int yylex();
+// Tokens go through stats::lex, which times the scanner for --stats
+#define yylex stats::lex
 
-void yyerror(const char*);
+void yyerror(const YYLTYPE *, const char *);
 
 // root of the AST, set by the parser and used by other parts of the compiler
 std::shared_ptr<ast::Node> program;
+// Called with every function as soon as it is reduced, see fanc::compileStream
+std::function<void(const std::shared_ptr<ast::FuncDecl> &)> function_parsed;
+
+/* The parser stacks live on the heap and grow as needed. Bison cannot relocate them itself
+ * because YYSTYPE is not trivially copyable, which used to fail a parse after 200 entries (a file
+ * of about 170 functions, or deep nesting). Keeping them out of yyparse's frame (YYINITDEPTH 1)
+ * also lets releaseParserStacks free the values left by a failed parse without recursing.
+ * The depth is bounded by YYMAXDEPTH (at build time) or fanc::Options::max_parse_depth.
+ */
+#define YYINITDEPTH 1
+#ifndef YYMAXDEPTH
+#define YYMAXDEPTH 10000000
+#endif
+static long parser_max_depth = YYMAXDEPTH;
+static void *heap_states = nullptr;
+static std::unique_ptr<YYSTYPE[]> heap_values;
+static std::unique_ptr<YYLTYPE[]> heap_locations;
+static long heap_size = 0;
+
+template<typename State, typename Size>
+static void growStacks(const char *message, State **states, Size states_bytes, YYSTYPE **values,
+                       YYLTYPE **locations, Size *size, const YYLTYPE &lookahead) {
+    if (*size >= parser_max_depth) {
+        yyerror(&lookahead, message);
+        return;
+    }
+    Size new_size = std::min<Size>(std::max<Size>(*size * 2, 256), parser_max_depth);
+    Size used = states_bytes / sizeof(State);
+    auto *new_states = (State *) malloc(new_size * sizeof(State));
+    if (new_states == nullptr) {
+        yyerror(&lookahead, message);
+        return;
+    }
+    memcpy(new_states, *states, states_bytes);
+    std::unique_ptr<YYSTYPE[]> new_values(new YYSTYPE[new_size]);
+    // The first entry never holds a value, in the push parser's malloc'd state it is not even constructed
+    std::move(*values + 1, *values + used, new_values.get() + 1);
+    std::unique_ptr<YYLTYPE[]> new_locations(new YYLTYPE[new_size]);
+    std::copy(*locations, *locations + used, new_locations.get());
+    free(heap_states);
+    heap_states = new_states;
+    heap_values = std::move(new_values);
+    heap_locations = std::move(new_locations);
+    heap_size = new_size;
+    *states = new_states;
+    *values = heap_values.get();
+    *locations = heap_locations.get();
+    *size = new_size;
+}
+
+#define yyoverflow(message, states, states_bytes, values, values_bytes, locations, locations_bytes, size) \
+    growStacks(message, states, states_bytes, values, locations, size, yylloc)
+// Bison only defines these when it manages the stacks, yypstate_new needs them as well
+#define YYMALLOC malloc
+#define YYFREE free
+
+/* A rule starts where its first symbol does, an empty one where the symbol before it does.
+ * Nodes built by the action take that offset (source::node_start), see Source.hpp.
+ */
+#define YYLLOC_DEFAULT(Current, Rhs, N) \
+    do { \
+        (Current) = YYRHSLOC(Rhs, (N) ? 1 : 0); \
+        source::node_start = (Current); \
+    } while (0)
 
 using namespace std;
 %}
 
 // Tokens
+// yyparse for whole buffers, yypush_parse to take tokens as a stream arrives (pushParse)
+%define api.push-pull both
+// The lookahead lives in the parser state, not in globals, so tokens can come from another thread
+%define api.pure full
+// Every symbol carries the offset of its first token, YYLTYPE is source::Offset (nodes.hpp)
+%locations
+
 %token ID
 %token NUM
 %token STRING
@@ -54,20 +133,20 @@ using namespace std;
 // Grammar Rules
 
 Program:
-    Funcs { program = std::dynamic_pointer_cast<ast::Funcs>($1); }
+    Funcs { program = ast::cast<ast::Funcs>($1); }
 ;
 
 Funcs:
     /* empty */
     {
-        $$ = std::make_shared<ast::Funcs>();
+        $$ = memory::make<ast::Funcs>();
     }
     | FuncDecl Funcs
     {
-        $$ = std::dynamic_pointer_cast<ast::Funcs>($2);
-        auto funcs_ptr = std::dynamic_pointer_cast<ast::Funcs>($$);
+        $$ = ast::cast<ast::Funcs>($2);
+        auto funcs_ptr = ast::cast<ast::Funcs>($$);
         if (funcs_ptr) {
-            funcs_ptr->push_front(std::dynamic_pointer_cast<ast::FuncDecl>($1));
+            funcs_ptr->push_front(ast::cast<ast::FuncDecl>($1));
         }
     }
 ;
@@ -75,19 +154,25 @@ Funcs:
 FuncDecl:
     RetType ID LPAREN Formals RPAREN LBRACE Statements RBRACE
     {
-        auto arg1 = std::dynamic_pointer_cast<ast::ID>($2);
-        auto arg2 = std::dynamic_pointer_cast<ast::Type>($1);
-        auto arg3 = std::dynamic_pointer_cast<ast::Formals>($4);
-        auto arg4 = std::dynamic_pointer_cast<ast::Statements>($7);
-        $$ = std::make_shared<ast::FuncDecl>(arg1, arg2, arg3, arg4);
+        auto arg1 = ast::cast<ast::ID>($2);
+        auto arg2 = ast::cast<ast::Type>($1);
+        auto arg3 = ast::cast<ast::Formals>($4);
+        auto arg4 = ast::cast<ast::Statements>($7);
+        auto func = memory::make<ast::FuncDecl>(arg1, arg2, arg3, arg4);
+        if (function_parsed)
+            function_parsed(func);
+        $$ = func;
     } |
     VOID ID LPAREN Formals RPAREN LBRACE Statements RBRACE
     {
-            auto arg1 = std::dynamic_pointer_cast<ast::ID>($2);
-            auto arg2 = std::make_shared<ast::Type>(ast::BuiltInType::VOID);
-            auto arg3 = std::dynamic_pointer_cast<ast::Formals>($4);
-            auto arg4 = std::dynamic_pointer_cast<ast::Statements>($7);
-            $$ = std::make_shared<ast::FuncDecl>(arg1, arg2, arg3, arg4);
+            auto arg1 = ast::cast<ast::ID>($2);
+            auto arg2 = memory::make<ast::Type>(ast::BuiltInType::VOID);
+            auto arg3 = ast::cast<ast::Formals>($4);
+            auto arg4 = ast::cast<ast::Statements>($7);
+            auto func = memory::make<ast::FuncDecl>(arg1, arg2, arg3, arg4);
+            if (function_parsed)
+                function_parsed(func);
+            $$ = func;
     }
 
 ;
@@ -95,26 +180,26 @@ FuncDecl:
 RetType:
     Type
     {
-        $$ = std::dynamic_pointer_cast<ast::Type>($1);
+        $$ = ast::cast<ast::Type>($1);
     }
 ;
 
 Formals:
-    /* epsilon */ { $$ = std::make_shared<ast::Formals>(); }
+    /* epsilon */ { $$ = memory::make<ast::Formals>(); }
     | FormalsList
     {
-        $$ = std::dynamic_pointer_cast<ast::Formals>($1);
+        $$ = ast::cast<ast::Formals>($1);
     }
 ;
 
 FormalsList:
       FormalDecl {
-          $$ = std::make_shared<ast::Formals>(std::dynamic_pointer_cast<ast::Formal>($1));
+          $$ = memory::make<ast::Formals>(ast::cast<ast::Formal>($1));
       }
     | FormalDecl COMMA FormalsList {
-            $$ = std::dynamic_pointer_cast<ast::Formals>($3);
-          auto pointer = std::dynamic_pointer_cast<ast::Formal>($1);
-          std::dynamic_pointer_cast<ast::Formals>($$)->push_front(pointer);
+            $$ = ast::cast<ast::Formals>($3);
+          auto pointer = ast::cast<ast::Formal>($1);
+          ast::cast<ast::Formals>($$)->push_front(pointer);
       }
     ;
 
@@ -122,21 +207,21 @@ FormalsList:
 FormalDecl:
     Type ID
     {
-        auto pointer1 = std::dynamic_pointer_cast<ast::Type>($1);
-        auto pointer2 = std::dynamic_pointer_cast<ast::ID>($2);
-        $$ = std::make_shared<ast::Formal>(pointer2, pointer1);
+        auto pointer1 = ast::cast<ast::Type>($1);
+        auto pointer2 = ast::cast<ast::ID>($2);
+        $$ = memory::make<ast::Formal>(pointer2, pointer1);
     }
     ;
 
 
 Statements:
-      Statement { $$ = std::make_shared<ast::Statements>(std::dynamic_pointer_cast<ast::Statement>($1)); }
+      Statement { $$ = memory::make<ast::Statements>(ast::cast<ast::Statement>($1)); }
     | Statements Statement
     {
-        $$ = std::dynamic_pointer_cast<ast::Statements>($1);
-        auto statements_ptr = std::dynamic_pointer_cast<ast::Statements>($$);
+        $$ = ast::cast<ast::Statements>($1);
+        auto statements_ptr = ast::cast<ast::Statements>($$);
         if (statements_ptr) {
-            statements_ptr->push_back(std::dynamic_pointer_cast<ast::Statement>($2));
+            statements_ptr->push_back(ast::cast<ast::Statement>($2));
         }
     }
 ;
@@ -144,166 +229,166 @@ Statements:
 Statement:
     LBRACE Statements RBRACE
     {
-        $$ = std::dynamic_pointer_cast<ast::Statements>($2);
-        std::dynamic_pointer_cast<ast::Statements>($$)->is_scope = true;
+        $$ = ast::cast<ast::Statements>($2);
+        ast::cast<ast::Statements>($$)->is_scope = true;
     }
     | Type ID SC
     {
-        auto arg1 = std::dynamic_pointer_cast<ast::ID>($2);
-        auto arg2 = std::dynamic_pointer_cast<ast::Type>($1);
-        $$ = std::make_shared<ast::VarDecl>(arg1, arg2);
+        auto arg1 = ast::cast<ast::ID>($2);
+        auto arg2 = ast::cast<ast::Type>($1);
+        $$ = memory::make<ast::VarDecl>(arg1, arg2);
     }
     | Type ID ASSIGN Exp SC
     {
-        auto arg1 = std::dynamic_pointer_cast<ast::ID>($2);
-        auto arg2 = std::dynamic_pointer_cast<ast::Type>($1);
-        auto arg3 = std::dynamic_pointer_cast<ast::Exp>($4);
-        $$ = std::make_shared<ast::VarDecl>(arg1, arg2, arg3);
+        auto arg1 = ast::cast<ast::ID>($2);
+        auto arg2 = ast::cast<ast::Type>($1);
+        auto arg3 = ast::cast<ast::Exp>($4);
+        $$ = memory::make<ast::VarDecl>(arg1, arg2, arg3);
     }
     | ID ASSIGN Exp SC
     {
-        auto arg1 = std::dynamic_pointer_cast<ast::ID>($1);
-        auto arg2 = std::dynamic_pointer_cast<ast::Exp>($3);
-        $$ = std::make_shared<ast::Assign>(arg1, arg2);
+        auto arg1 = ast::cast<ast::ID>($1);
+        auto arg2 = ast::cast<ast::Exp>($3);
+        $$ = memory::make<ast::Assign>(arg1, arg2);
     }
-    | Call SC { $$ = std::dynamic_pointer_cast<ast::Call>($1); }
-    | RETURN SC { $$ = std::make_shared<ast::Return>(); }
-    | RETURN Exp SC { $$ = std::make_shared<ast::Return>(std::dynamic_pointer_cast<ast::Exp>($2)); }
+    | Call SC { $$ = ast::cast<ast::Call>($1); }
+    | RETURN SC { $$ = memory::make<ast::Return>(); }
+    | RETURN Exp SC { $$ = memory::make<ast::Return>(ast::cast<ast::Exp>($2)); }
     | IF LPAREN Exp RPAREN Statement %prec IF
     {
-        auto arg1 = std::dynamic_pointer_cast<ast::Exp>($3);
-        auto arg2 = std::dynamic_pointer_cast<ast::Statement>($5);
-        $$ = std::make_shared<ast::If>(arg1, arg2);
+        auto arg1 = ast::cast<ast::Exp>($3);
+        auto arg2 = ast::cast<ast::Statement>($5);
+        $$ = memory::make<ast::If>(arg1, arg2);
     }
     | IF LPAREN Exp RPAREN Statement ELSE Statement
     {
-        auto arg1 = std::dynamic_pointer_cast<ast::Exp>($3);
-        auto arg2 = std::dynamic_pointer_cast<ast::Statement>($5);
-        auto arg3 = std::dynamic_pointer_cast<ast::Statement>($7);
-        $$ = std::make_shared<ast::If>(arg1, arg2, arg3);
+        auto arg1 = ast::cast<ast::Exp>($3);
+        auto arg2 = ast::cast<ast::Statement>($5);
+        auto arg3 = ast::cast<ast::Statement>($7);
+        $$ = memory::make<ast::If>(arg1, arg2, arg3);
     }
     | WHILE LPAREN Exp RPAREN Statement
     {
-        auto arg1 = std::dynamic_pointer_cast<ast::Exp>($3);
-        auto arg2 = std::dynamic_pointer_cast<ast::Statement>($5);
-        $$ = std::make_shared<ast::While>(arg1, arg2);
+        auto arg1 = ast::cast<ast::Exp>($3);
+        auto arg2 = ast::cast<ast::Statement>($5);
+        $$ = memory::make<ast::While>(arg1, arg2);
     }
-    | BREAK SC { $$ = std::make_shared<ast::Break>(); }
-    | CONTINUE SC { $$ = std::make_shared<ast::Continue>(); }
+    | BREAK SC { $$ = memory::make<ast::Break>(); }
+    | CONTINUE SC { $$ = memory::make<ast::Continue>(); }
 ;
 
 Call:
     ID LPAREN ExpList RPAREN
     {
-        auto arg1 = std::dynamic_pointer_cast<ast::ID>($1);
-        auto arg2 = std::dynamic_pointer_cast<ast::ExpList>($3);
-        $$ = std::make_shared<ast::Call>(arg1, arg2);
+        auto arg1 = ast::cast<ast::ID>($1);
+        auto arg2 = ast::cast<ast::ExpList>($3);
+        $$ = memory::make<ast::Call>(arg1, arg2);
     }
-    | ID LPAREN RPAREN { $$ = std::make_shared<ast::Call>(std::dynamic_pointer_cast<ast::ID>($1)); }
+    | ID LPAREN RPAREN { $$ = memory::make<ast::Call>(ast::cast<ast::ID>($1)); }
 ;
 
 ExpList:
-    Exp { $$ = std::make_shared<ast::ExpList>(std::dynamic_pointer_cast<ast::Exp>($1)); }
+    Exp { $$ = memory::make<ast::ExpList>(ast::cast<ast::Exp>($1)); }
     | Exp COMMA ExpList
     {
-        auto explist_ptr = std::dynamic_pointer_cast<ast::ExpList>($3);
-        explist_ptr->push_front(std::dynamic_pointer_cast<ast::Exp>($1));
+        auto explist_ptr = ast::cast<ast::ExpList>($3);
+        explist_ptr->push_front(ast::cast<ast::Exp>($1));
         $$ = explist_ptr;
     }
 ;
 
 Type:
-      INT { $$ = std::make_shared<ast::Type>(ast::BuiltInType::INT); }
-    | BYTE { $$ = std::make_shared<ast::Type>(ast::BuiltInType::BYTE); }
-    | BOOL { $$ = std::make_shared<ast::Type>(ast::BuiltInType::BOOL); }
+      INT { $$ = memory::make<ast::Type>(ast::BuiltInType::INT); }
+    | BYTE { $$ = memory::make<ast::Type>(ast::BuiltInType::BYTE); }
+    | BOOL { $$ = memory::make<ast::Type>(ast::BuiltInType::BOOL); }
 ;
 
 
 Exp_cast :
-    LPAREN Type RPAREN Exp {$$ = std::make_shared<ast::Cast>(std::dynamic_pointer_cast<ast::Exp>($4), std::dynamic_pointer_cast<ast::Type>($2));}
+    LPAREN Type RPAREN Exp {$$ = memory::make<ast::Cast>(ast::cast<ast::Exp>($4), ast::cast<ast::Type>($2));}
     ;
 
 Exp_t :
     LPAREN Exp RPAREN { $$ = $2; } |
     Exp AND Exp
     {
-            auto arg1 = std::dynamic_pointer_cast<ast::Exp>($1);
-            auto arg2 = std::dynamic_pointer_cast<ast::Exp>($3);
-            $$ = std::make_shared<ast::And>(arg1, arg2);
+            auto arg1 = ast::cast<ast::Exp>($1);
+            auto arg2 = ast::cast<ast::Exp>($3);
+            $$ = memory::make<ast::And>(arg1, arg2);
     }  |
     Exp OR Exp
     {
-            auto arg1 = std::dynamic_pointer_cast<ast::Exp>($1);
-            auto arg2 = std::dynamic_pointer_cast<ast::Exp>($3);
-            $$ = std::make_shared<ast::Or>(arg1, arg2);
+            auto arg1 = ast::cast<ast::Exp>($1);
+            auto arg2 = ast::cast<ast::Exp>($3);
+            $$ = memory::make<ast::Or>(arg1, arg2);
     }  |
     Exp BINOP_ADD Exp
     {
-        auto arg1 = std::dynamic_pointer_cast<ast::Exp>($1);
-        auto arg2 = std::dynamic_pointer_cast<ast::Exp>($3);
-        $$ = std::make_shared<ast::BinOp>(arg1, arg2, ast::BinOpType::ADD);
+        auto arg1 = ast::cast<ast::Exp>($1);
+        auto arg2 = ast::cast<ast::Exp>($3);
+        $$ = memory::make<ast::BinOp>(arg1, arg2, ast::BinOpType::ADD);
     }  |
     Exp BINOP_MUL Exp
     {
-        auto arg1 = std::dynamic_pointer_cast<ast::Exp>($1);
-        auto arg2 = std::dynamic_pointer_cast<ast::Exp>($3);
-        $$ = std::make_shared<ast::BinOp>(arg1, arg2, ast::BinOpType::MUL);
+        auto arg1 = ast::cast<ast::Exp>($1);
+        auto arg2 = ast::cast<ast::Exp>($3);
+        $$ = memory::make<ast::BinOp>(arg1, arg2, ast::BinOpType::MUL);
     }  |
     Exp BINOP_SUB Exp
     {
-        auto arg1 = std::dynamic_pointer_cast<ast::Exp>($1);
-        auto arg2 = std::dynamic_pointer_cast<ast::Exp>($3);
-        $$ = std::make_shared<ast::BinOp>(arg1, arg2, ast::BinOpType::SUB);
+        auto arg1 = ast::cast<ast::Exp>($1);
+        auto arg2 = ast::cast<ast::Exp>($3);
+        $$ = memory::make<ast::BinOp>(arg1, arg2, ast::BinOpType::SUB);
     }  |
     Exp BINOP_DIV Exp
     {
-        auto arg1 = std::dynamic_pointer_cast<ast::Exp>($1);
-        auto arg2 = std::dynamic_pointer_cast<ast::Exp>($3);
-        $$ = std::make_shared<ast::BinOp>(arg1, arg2, ast::BinOpType::DIV);
+        auto arg1 = ast::cast<ast::Exp>($1);
+        auto arg2 = ast::cast<ast::Exp>($3);
+        $$ = memory::make<ast::BinOp>(arg1, arg2, ast::BinOpType::DIV);
     }  |
     ID { $$ = $1;} |
-    Call { $$ = std::dynamic_pointer_cast<ast::Call>($1); } |
+    Call { $$ = ast::cast<ast::Call>($1); } |
     NUM { $$ = $1; } |
     NUM_B {$$ = $1;} |
     STRING {$$ = $1;} |
-    TRUE {$$ = std::make_shared<ast::Bool>(1);} |
-    FALSE {$$ = std::make_shared<ast::Bool>(0);} |
-    NOT Exp {$$ = std::make_shared<ast::Not>(std::dynamic_pointer_cast<ast::Exp>($2));}|
+    TRUE {$$ = memory::make<ast::Bool>(1);} |
+    FALSE {$$ = memory::make<ast::Bool>(0);} |
+    NOT Exp {$$ = memory::make<ast::Not>(ast::cast<ast::Exp>($2));}|
     Exp RELOP_EQ Exp
     {
-        auto arg1 = std::dynamic_pointer_cast<ast::Exp>($1);
-        auto arg2 = std::dynamic_pointer_cast<ast::Exp>($3);
-        $$ = std::make_shared<ast::RelOp>(arg1, arg2, ast::RelOpType::EQ);
+        auto arg1 = ast::cast<ast::Exp>($1);
+        auto arg2 = ast::cast<ast::Exp>($3);
+        $$ = memory::make<ast::RelOp>(arg1, arg2, ast::RelOpType::EQ);
     } |
     Exp RELOP_NEQ Exp
     {
-        auto arg1 = std::dynamic_pointer_cast<ast::Exp>($1);
-        auto arg2 = std::dynamic_pointer_cast<ast::Exp>($3);
-        $$ = std::make_shared<ast::RelOp>(arg1, arg2, ast::RelOpType::NE);
+        auto arg1 = ast::cast<ast::Exp>($1);
+        auto arg2 = ast::cast<ast::Exp>($3);
+        $$ = memory::make<ast::RelOp>(arg1, arg2, ast::RelOpType::NE);
     } |
     Exp RELOP_LE Exp
     {
-        auto arg1 = std::dynamic_pointer_cast<ast::Exp>($1);
-        auto arg2 = std::dynamic_pointer_cast<ast::Exp>($3);
-        $$ = std::make_shared<ast::RelOp>(arg1, arg2, ast::RelOpType::LT);
+        auto arg1 = ast::cast<ast::Exp>($1);
+        auto arg2 = ast::cast<ast::Exp>($3);
+        $$ = memory::make<ast::RelOp>(arg1, arg2, ast::RelOpType::LT);
     } |
     Exp RELOP_GE Exp
     {
-        auto arg1 = std::dynamic_pointer_cast<ast::Exp>($1);
-        auto arg2 = std::dynamic_pointer_cast<ast::Exp>($3);
-        $$ = std::make_shared<ast::RelOp>(arg1, arg2, ast::RelOpType::GT);
+        auto arg1 = ast::cast<ast::Exp>($1);
+        auto arg2 = ast::cast<ast::Exp>($3);
+        $$ = memory::make<ast::RelOp>(arg1, arg2, ast::RelOpType::GT);
     } |
     Exp RELOP_LEQ Exp
     {
-        auto arg1 = std::dynamic_pointer_cast<ast::Exp>($1);
-        auto arg2 = std::dynamic_pointer_cast<ast::Exp>($3);
-        $$ = std::make_shared<ast::RelOp>(arg1, arg2, ast::RelOpType::LE);
+        auto arg1 = ast::cast<ast::Exp>($1);
+        auto arg2 = ast::cast<ast::Exp>($3);
+        $$ = memory::make<ast::RelOp>(arg1, arg2, ast::RelOpType::LE);
     } |
     Exp RELOP_GEQ Exp
     {
-        auto arg1 = std::dynamic_pointer_cast<ast::Exp>($1);
-        auto arg2 = std::dynamic_pointer_cast<ast::Exp>($3);
-        $$ = std::make_shared<ast::RelOp>(arg1, arg2, ast::RelOpType::GE);
+        auto arg1 = ast::cast<ast::Exp>($1);
+        auto arg2 = ast::cast<ast::Exp>($3);
+        $$ = memory::make<ast::RelOp>(arg1, arg2, ast::RelOpType::GE);
     }
 ;
 Exp : Exp_cast | Exp_t ;
@@ -313,7 +398,47 @@ Exp : Exp_cast | Exp_t ;
 %%
 
 
-void yyerror(const char * message) {
-    output::errorSyn(yylineno);
-    exit(0);
+void yyerror(const YYLTYPE *location, const char *message) {
+    output::errorSyn(*location);
+}
+
+// Parses by pushing each token to the parser as soon as the scanner has it, like yyparse otherwise
+int pushParse() {
+    yypstate *state = yypstate_new();
+    if (state == nullptr) {
+        YYLTYPE nowhere = source::NOWHERE;
+        yyerror(&nowhere, "memory exhausted");
+        return 2;
+    }
+    int status;
+    try {
+        YYSTYPE value;
+        YYLTYPE location;
+        do {
+            int token = yylex(&value, &location);
+            status = yypush_parse(state, token, &value, &location);
+        } while (status == YYPUSH_MORE);
+    } catch (...) {
+        yypstate_delete(state);
+        throw;
+    }
+    yypstate_delete(state);
+    return status;
+}
+
+// Limits the parser stacks of the following parses, 0 restores YYMAXDEPTH
+void setParserMaxDepth(long depth) {
+    parser_max_depth = depth > 0 ? depth : YYMAXDEPTH;
+}
+
+// Frees the heap stacks of the last parse, with the values still left in them
+void releaseParserStacks() {
+    // A failed parse can leave a deep subtree behind, it must not be freed recursively
+    for (long i = 0; i < heap_size; i++)
+        ast::destroyTree(std::move(heap_values[i]));
+    heap_values.reset();
+    heap_locations.reset();
+    heap_size = 0;
+    free(heap_states);
+    heap_states = nullptr;
 }
\ No newline at end of file